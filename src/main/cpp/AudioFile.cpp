@@ -0,0 +1,218 @@
+// AudioFile.cpp
+#include "AudioFile.h"
+#include <algorithm>
+#include <cstring>
+#include "EngineLog.h"
+
+namespace audio {
+
+namespace {
+
+constexpr uint16_t kFormatPcm = 1;
+constexpr uint16_t kFormatFloat = 3;
+constexpr uint16_t kFormatExtensible = 0xFFFE;
+
+uint16_t le16(const uint8_t* p) { uint16_t v; std::memcpy(&v, p, 2); return v; }
+uint32_t le32(const uint8_t* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+
+bool hasSuffix(const std::string& s, const char* suffix) {
+    const size_t n = std::strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+} // namespace
+
+bool AudioFileReader::open(const std::string& path, const AudioFormat& rawFormat) {
+    close();
+    mFile = std::fopen(path.c_str(), "rb");
+    if (!mFile) {
+        LOGE("AudioFileReader: cannot open %s", path.c_str());
+        return false;
+    }
+    uint8_t riff[12];
+    const size_t probed = std::fread(riff, 1, sizeof(riff), mFile);
+    const bool wav = probed == sizeof(riff) &&
+                     std::memcmp(riff, "RIFF", 4) == 0 && std::memcmp(riff + 8, "WAVE", 4) == 0;
+    if (wav) {
+        if (parseWav(path)) return true;
+        close();
+        return false;
+    }
+
+    // Raw interleaved float32
+    if (rawFormat.channels < 1 || rawFormat.sampleRate < 1) {
+        LOGE("AudioFileReader: %s is not a WAV file and no raw format was given", path.c_str());
+        close();
+        return false;
+    }
+    mFormat = rawFormat;
+    mEncoding = Encoding::Float32;
+    mBytesPerFrame = 4 * mFormat.channels;
+    if (std::fseek(mFile, 0, SEEK_END) == 0) {
+        const long size = std::ftell(mFile);
+        if (size >= 0) mTotalFrames = size / mBytesPerFrame;
+        std::rewind(mFile);
+    } else {
+        // A pipe: the bytes looked at for a header are the first samples
+        mPending.assign(riff, riff + probed);
+    }
+    mFramesLeft = mTotalFrames;
+    return true;
+}
+
+bool AudioFileReader::parseWav(const std::string& path) {
+    uint16_t tag = 0, bits = 0;
+    bool haveFmt = false;
+    uint8_t hdr[8];
+    while (std::fread(hdr, 1, 8, mFile) == 8) {
+        const uint32_t size = le32(hdr + 4);
+        if (std::memcmp(hdr, "fmt ", 4) == 0) {
+            uint8_t fmt[40] = {};
+            const uint32_t n = std::min<uint32_t>(size, sizeof(fmt));
+            if (size < 16 || std::fread(fmt, 1, n, mFile) != n) break;
+            tag = le16(fmt);
+            mFormat.channels = le16(fmt + 2);
+            mFormat.sampleRate = static_cast<int32_t>(le32(fmt + 4));
+            bits = le16(fmt + 14);
+            // Extensible: the sub-format GUID starts with the format tag
+            if (tag == kFormatExtensible && n >= 26) tag = le16(fmt + 24);
+            if (size > n && std::fseek(mFile, long(size - n), SEEK_CUR) != 0) break;
+            haveFmt = true;
+        } else if (std::memcmp(hdr, "data", 4) == 0) {
+            if (!haveFmt) break;
+            if      (tag == kFormatPcm && bits == 16)   mEncoding = Encoding::Pcm16;
+            else if (tag == kFormatPcm && bits == 24)   mEncoding = Encoding::Pcm24;
+            else if (tag == kFormatPcm && bits == 32)   mEncoding = Encoding::Pcm32;
+            else if (tag == kFormatFloat && bits == 32) mEncoding = Encoding::Float32;
+            else if (tag == kFormatFloat && bits == 64) mEncoding = Encoding::Float64;
+            else {
+                LOGE("AudioFileReader: %s: unsupported WAV encoding (format %u, %u bits)",
+                     path.c_str(), unsigned(tag), unsigned(bits));
+                return false;
+            }
+            if (mFormat.channels < 1 || mFormat.sampleRate < 1) break;
+            mBytesPerFrame = mFormat.channels * (bits / 8);
+            // 0 and 0xFFFFFFFF both mean "until the end" in streamed files
+            mTotalFrames = (size == 0 || size == 0xFFFFFFFFu) ? -1 : int64_t(size) / mBytesPerFrame;
+            mFramesLeft = mTotalFrames;
+            return true;
+        } else if (std::fseek(mFile, long(size + (size & 1)), SEEK_CUR) != 0) {
+            break;
+        }
+    }
+    LOGE("AudioFileReader: %s: malformed WAV header", path.c_str());
+    return false;
+}
+
+void AudioFileReader::close() {
+    if (mFile) std::fclose(mFile);
+    mFile = nullptr;
+    mFormat = {};
+    mTotalFrames = -1;
+    mFramesLeft = -1;
+    mPending.clear();
+}
+
+int32_t AudioFileReader::read(float* out, int32_t frames) {
+    if (!mFile || frames <= 0) return mFile ? 0 : -1;
+    if (mFramesLeft >= 0) frames = static_cast<int32_t>(std::min<int64_t>(frames, mFramesLeft));
+    if (frames == 0) return 0;
+    const size_t want = static_cast<size_t>(frames) * mBytesPerFrame;
+    mBytes.resize(want);
+    const size_t pending = std::min(want, mPending.size());
+    std::memcpy(mBytes.data(), mPending.data(), pending);
+    mPending.erase(mPending.begin(), mPending.begin() + pending);
+    const size_t got = pending + std::fread(mBytes.data() + pending, 1, want - pending, mFile);
+    if (got < want && std::ferror(mFile)) return -1;
+    const int32_t n = static_cast<int32_t>(got / mBytesPerFrame);
+    if (mFramesLeft >= 0) mFramesLeft -= n;
+
+    const size_t count = static_cast<size_t>(n) * mFormat.channels;
+    const uint8_t* p = mBytes.data();
+    switch (mEncoding) {
+        case Encoding::Pcm16:
+            for (size_t i = 0; i < count; ++i) out[i] = int16_t(le16(p + 2 * i)) * (1.0f / 32768.0f);
+            break;
+        case Encoding::Pcm24:
+            for (size_t i = 0; i < count; ++i) {
+                const uint8_t* s = p + 3 * i;
+                const int32_t v = int32_t(uint32_t(s[0]) << 8 | uint32_t(s[1]) << 16 | uint32_t(s[2]) << 24) >> 8;
+                out[i] = float(v) * (1.0f / 8388608.0f);
+            }
+            break;
+        case Encoding::Pcm32:
+            for (size_t i = 0; i < count; ++i) out[i] = float(int32_t(le32(p + 4 * i))) * (1.0f / 2147483648.0f);
+            break;
+        case Encoding::Float32:
+            std::memcpy(out, p, count * sizeof(float));
+            break;
+        case Encoding::Float64:
+            for (size_t i = 0; i < count; ++i) {
+                double v;
+                std::memcpy(&v, p + 8 * i, sizeof(v));
+                out[i] = float(v);
+            }
+            break;
+    }
+    return n;
+}
+
+bool AudioFileWriter::open(const std::string& path, const AudioFormat& format) {
+    (void)close();
+    if (format.channels < 1 || format.sampleRate < 1) return false;
+    mFile = std::fopen(path.c_str(), "wb");
+    if (!mFile) {
+        LOGE("AudioFileWriter: cannot create %s", path.c_str());
+        return false;
+    }
+    mFormat = format;
+    mWav = !(hasSuffix(path, ".raw") || hasSuffix(path, ".f32"));
+    mFrames = 0;
+    if (mWav) {
+        // Sizes are filled in by close()
+        uint8_t hdr[44] = {};
+        const uint16_t tag = kFormatFloat, ch = uint16_t(format.channels), bits = 32, align = uint16_t(4 * ch);
+        const uint32_t rate = uint32_t(format.sampleRate), byteRate = rate * align, fmtSize = 16;
+        std::memcpy(hdr, "RIFF", 4);
+        std::memcpy(hdr + 8, "WAVEfmt ", 8);
+        std::memcpy(hdr + 16, &fmtSize, 4);
+        std::memcpy(hdr + 20, &tag, 2);
+        std::memcpy(hdr + 22, &ch, 2);
+        std::memcpy(hdr + 24, &rate, 4);
+        std::memcpy(hdr + 28, &byteRate, 4);
+        std::memcpy(hdr + 32, &align, 2);
+        std::memcpy(hdr + 34, &bits, 2);
+        std::memcpy(hdr + 36, "data", 4);
+        if (std::fwrite(hdr, 1, sizeof(hdr), mFile) != sizeof(hdr)) {
+            (void)close();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AudioFileWriter::write(const float* data, int32_t frames) {
+    if (!mFile) return false;
+    if (frames <= 0) return true;
+    const size_t n = static_cast<size_t>(frames) * mFormat.channels;
+    if (std::fwrite(data, sizeof(float), n, mFile) != n) return false;
+    mFrames += frames;
+    return true;
+}
+
+bool AudioFileWriter::close() {
+    if (!mFile) return true;
+    bool ok = true;
+    if (mWav) {
+        const uint64_t dataBytes = uint64_t(mFrames) * 4 * mFormat.channels;
+        const uint32_t data32 = uint32_t(std::min<uint64_t>(dataBytes, 0xFFFFFFFFu - 36));
+        const uint32_t riff32 = data32 + 36;
+        ok = std::fseek(mFile, 4, SEEK_SET) == 0 && std::fwrite(&riff32, 4, 1, mFile) == 1 &&
+             std::fseek(mFile, 40, SEEK_SET) == 0 && std::fwrite(&data32, 4, 1, mFile) == 1;
+    }
+    ok = (std::fclose(mFile) == 0) && ok;
+    mFile = nullptr;
+    return ok;
+}
+
+} // namespace audio
@@ -0,0 +1,77 @@
+// AudioFile.h
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * Streaming audio file I/O for host builds: WAV (16/24/32-bit PCM, 32/64-bit
+ * float, plain or WAVE_FORMAT_EXTENSIBLE) and headerless interleaved float32.
+ * Samples are always interleaved float; nothing holds more than the block
+ * being read or written, so files of any length take the same memory.
+ * Little-endian hosts only.
+ */
+namespace audio {
+
+struct AudioFormat {
+    int32_t channels = 0;
+    int32_t sampleRate = 0;
+};
+
+class AudioFileReader {
+public:
+    AudioFileReader() = default;
+    ~AudioFileReader() { close(); }
+    AudioFileReader(const AudioFileReader&) = delete;
+    AudioFileReader& operator=(const AudioFileReader&) = delete;
+
+    // A file without a RIFF/WAVE header is read as raw float32 in rawFormat
+    // (which then must be set); false, with the reason logged, otherwise.
+    bool open(const std::string& path, const AudioFormat& rawFormat = {});
+    void close();
+
+    // Up to 'frames' interleaved frames; 0 at the end, -1 on a read error
+    int32_t read(float* out, int32_t frames);
+
+    const AudioFormat& format() const { return mFormat; }
+    // -1 when the header leaves the length open (streamed WAV)
+    int64_t totalFrames() const { return mTotalFrames; }
+
+private:
+    enum class Encoding { Pcm16, Pcm24, Pcm32, Float32, Float64 };
+    bool parseWav(const std::string& path);
+
+    std::FILE* mFile = nullptr;
+    AudioFormat mFormat;
+    Encoding mEncoding = Encoding::Float32;
+    int32_t  mBytesPerFrame = 0;
+    int64_t  mTotalFrames = -1;
+    int64_t  mFramesLeft = -1;          // -1: until end of file
+    std::vector<uint8_t> mBytes;        // one block of encoded frames
+    std::vector<uint8_t> mPending;      // raw input from a pipe: bytes read while probing
+};
+
+class AudioFileWriter {
+public:
+    AudioFileWriter() = default;
+    ~AudioFileWriter() { (void)close(); }
+    AudioFileWriter(const AudioFileWriter&) = delete;
+    AudioFileWriter& operator=(const AudioFileWriter&) = delete;
+
+    // 32-bit float WAV, or raw float32 for a .raw / .f32 path. The WAV sizes
+    // are written by close() (clamped for files beyond 4 GiB).
+    bool open(const std::string& path, const AudioFormat& format);
+    bool write(const float* data, int32_t frames);
+    bool close();
+
+    int64_t framesWritten() const { return mFrames; }
+
+private:
+    std::FILE* mFile = nullptr;
+    AudioFormat mFormat;
+    bool    mWav = true;
+    int64_t mFrames = 0;
+};
+
+} // namespace audio
@@ -0,0 +1,51 @@
+// AudioPort.h
+#pragma once
+#include <cstdint>
+
+/**
+ * What FullDuplexEngine needs from the audio device, so the pipeline builds
+ * without Oboe. Oboe streams are wrapped by OboeAudioPort.h (Android); host
+ * builds use the adapters in HostAudioPort.h.
+ *
+ * Samples are interleaved float32 in both directions.
+ */
+namespace audio {
+
+// One direction of the device. The engine reads from the input stream in
+// threaded mode and only queries the format of the output stream (playback
+// is driven by the output stream's own callback, which calls pullTo()).
+class Stream {
+public:
+    virtual ~Stream() = default;
+
+    virtual int32_t channelCount() const = 0;
+    virtual int32_t sampleRate() const = 0;
+    virtual int32_t framesPerBurst() const = 0;
+
+    virtual bool requestStart() = 0;
+    virtual bool requestStop() = 0;
+
+    // Input streams: blocking read of up to 'frames' frames. Returns the
+    // frames read (0 when the timeout passed first) or -1 on error.
+    // Output streams return -1.
+    virtual int32_t read(float* data, int32_t frames, int64_t timeoutNanos) = 0;
+};
+
+// Receives one output buffer's worth of duplex audio in callback mode,
+// together with whatever input was available for it (possibly none).
+class DuplexCallback {
+public:
+    virtual ~DuplexCallback() = default;
+    virtual void onDuplex(const float* in, int32_t numIn, float* out, int32_t numOut) = 0;
+};
+
+// Runs a stream pair and calls a DuplexCallback from the output side
+// (oboe::FullDuplexStream on Android). start() starts both streams.
+class DuplexDriver {
+public:
+    virtual ~DuplexDriver() = default;
+    virtual bool start(DuplexCallback* callback) = 0;
+    virtual void stop() = 0;
+};
+
+} // namespace audio
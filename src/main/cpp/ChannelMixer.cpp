@@ -0,0 +1,246 @@
+// ChannelMixer.cpp
+#include "ChannelMixer.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__aarch64__) || (defined(__ARM_NEON) && defined(__arm__))
+#define CM_NEON 1
+#include <arm_neon.h>
+#elif defined(__SSE__) || defined(__x86_64__)
+#define CM_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace chmix {
+
+namespace {
+
+// Scalar loops for frames [from, frames); C is the channel count when known
+// at compile time, 0 for the runtime count.
+template <int C>
+inline void deinterleaveTail(const float* inter, int32_t from, int32_t frames, int32_t channels,
+                             float* const* planes) {
+    const int32_t ch = C > 0 ? C : channels;
+    for (int32_t c = 0; c < ch; ++c) {
+        float* dst = planes[c];
+        const float* src = inter + c;
+        for (int32_t i = from; i < frames; ++i) dst[i] = src[static_cast<size_t>(i) * ch];
+    }
+}
+
+template <int C>
+inline void interleaveTail(const float* const* planes, int32_t from, int32_t frames, int32_t channels,
+                           float* inter) {
+    const int32_t ch = C > 0 ? C : channels;
+    for (int32_t c = 0; c < ch; ++c) {
+        const float* src = planes[c];
+        float* dst = inter + c;
+        for (int32_t i = from; i < frames; ++i) dst[static_cast<size_t>(i) * ch] = src[i];
+    }
+}
+
+// Four frames per step; returns the first frame left for the scalar tail.
+template <int C>
+int32_t deinterleaveSimd(const float* inter, int32_t frames, float* const* planes) {
+    int32_t i = 0;
+#if defined(CM_NEON)
+    if (C == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            const float32x4x2_t v = vld2q_f32(inter + 2 * i);
+            vst1q_f32(planes[0] + i, v.val[0]);
+            vst1q_f32(planes[1] + i, v.val[1]);
+        }
+    } else if (C == 4) {
+        for (; i + 4 <= frames; i += 4) {
+            const float32x4x4_t v = vld4q_f32(inter + 4 * i);
+            vst1q_f32(planes[0] + i, v.val[0]);
+            vst1q_f32(planes[1] + i, v.val[1]);
+            vst1q_f32(planes[2] + i, v.val[2]);
+            vst1q_f32(planes[3] + i, v.val[3]);
+        }
+    }
+#elif defined(CM_SSE)
+    if (C == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            const __m128 a = _mm_loadu_ps(inter + 2 * i);       // L0 R0 L1 R1
+            const __m128 b = _mm_loadu_ps(inter + 2 * i + 4);   // L2 R2 L3 R3
+            _mm_storeu_ps(planes[0] + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(planes[1] + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+    } else if (C == 4) {
+        for (; i + 4 <= frames; i += 4) {
+            __m128 r0 = _mm_loadu_ps(inter + 4 * i);
+            __m128 r1 = _mm_loadu_ps(inter + 4 * i + 4);
+            __m128 r2 = _mm_loadu_ps(inter + 4 * i + 8);
+            __m128 r3 = _mm_loadu_ps(inter + 4 * i + 12);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(planes[0] + i, r0);
+            _mm_storeu_ps(planes[1] + i, r1);
+            _mm_storeu_ps(planes[2] + i, r2);
+            _mm_storeu_ps(planes[3] + i, r3);
+        }
+    }
+#else
+    (void)inter; (void)frames; (void)planes;
+#endif
+    return i;
+}
+
+template <int C>
+int32_t interleaveSimd(const float* const* planes, int32_t frames, float* inter) {
+    int32_t i = 0;
+#if defined(CM_NEON)
+    if (C == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            float32x4x2_t v;
+            v.val[0] = vld1q_f32(planes[0] + i);
+            v.val[1] = vld1q_f32(planes[1] + i);
+            vst2q_f32(inter + 2 * i, v);
+        }
+    } else if (C == 4) {
+        for (; i + 4 <= frames; i += 4) {
+            float32x4x4_t v;
+            v.val[0] = vld1q_f32(planes[0] + i);
+            v.val[1] = vld1q_f32(planes[1] + i);
+            v.val[2] = vld1q_f32(planes[2] + i);
+            v.val[3] = vld1q_f32(planes[3] + i);
+            vst4q_f32(inter + 4 * i, v);
+        }
+    }
+#elif defined(CM_SSE)
+    if (C == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            const __m128 l = _mm_loadu_ps(planes[0] + i);
+            const __m128 r = _mm_loadu_ps(planes[1] + i);
+            _mm_storeu_ps(inter + 2 * i,     _mm_unpacklo_ps(l, r));
+            _mm_storeu_ps(inter + 2 * i + 4, _mm_unpackhi_ps(l, r));
+        }
+    } else if (C == 4) {
+        for (; i + 4 <= frames; i += 4) {
+            __m128 c0 = _mm_loadu_ps(planes[0] + i);
+            __m128 c1 = _mm_loadu_ps(planes[1] + i);
+            __m128 c2 = _mm_loadu_ps(planes[2] + i);
+            __m128 c3 = _mm_loadu_ps(planes[3] + i);
+            _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+            _mm_storeu_ps(inter + 4 * i,      c0);
+            _mm_storeu_ps(inter + 4 * i + 4,  c1);
+            _mm_storeu_ps(inter + 4 * i + 8,  c2);
+            _mm_storeu_ps(inter + 4 * i + 12, c3);
+        }
+    }
+#else
+    (void)planes; (void)frames; (void)inter;
+#endif
+    return i;
+}
+
+} // namespace
+
+void deinterleave(const float* inter, int32_t frames, int32_t channels, float* const* planes) {
+    switch (channels) {
+        case 1:
+            std::memcpy(planes[0], inter, static_cast<size_t>(frames) * sizeof(float));
+            return;
+        case 2:
+            deinterleaveTail<2>(inter, deinterleaveSimd<2>(inter, frames, planes), frames, 2, planes);
+            return;
+        case 4:
+            deinterleaveTail<4>(inter, deinterleaveSimd<4>(inter, frames, planes), frames, 4, planes);
+            return;
+        default:
+            deinterleaveTail<0>(inter, 0, frames, channels, planes);
+            return;
+    }
+}
+
+void interleave(const float* const* planes, int32_t channels, int32_t frames, float* inter) {
+    switch (channels) {
+        case 1:
+            std::memcpy(inter, planes[0], static_cast<size_t>(frames) * sizeof(float));
+            return;
+        case 2:
+            interleaveTail<2>(planes, interleaveSimd<2>(planes, frames, inter), frames, 2, inter);
+            return;
+        case 4:
+            interleaveTail<4>(planes, interleaveSimd<4>(planes, frames, inter), frames, 4, inter);
+            return;
+        default:
+            interleaveTail<0>(planes, 0, frames, channels, inter);
+            return;
+    }
+}
+
+MixMatrix::MixMatrix(int32_t outChannels, int32_t inChannels)
+    : mOut(std::max(0, outChannels)), mIn(std::max(0, inChannels)),
+      mGains(static_cast<size_t>(mOut) * mIn, 0.0f) {
+    analyse();
+}
+
+MixMatrix MixMatrix::standard(int32_t inChannels, int32_t outChannels) {
+    MixMatrix m(outChannels, inChannels);
+    if (m.mIn == 0) return m;
+    for (int32_t r = 0; r < m.mOut; ++r) {
+        if (m.mIn < m.mOut) {
+            m.mGains[static_cast<size_t>(r) * m.mIn + r % m.mIn] = 1.0f;
+            continue;
+        }
+        const int32_t n = (m.mIn - r + m.mOut - 1) / m.mOut; // inputs r, r + out, ...
+        for (int32_t c = r; c < m.mIn; c += m.mOut) {
+            m.mGains[static_cast<size_t>(r) * m.mIn + c] = 1.0f / static_cast<float>(n);
+        }
+    }
+    m.analyse();
+    return m;
+}
+
+MixMatrix MixMatrix::identity(int32_t channels) {
+    return standard(channels, channels);
+}
+
+void MixMatrix::setGain(int32_t r, int32_t c, float g) {
+    if (r < 0 || r >= mOut || c < 0 || c >= mIn) return;
+    mGains[static_cast<size_t>(r) * mIn + c] = g;
+    analyse();
+}
+
+void MixMatrix::analyse() {
+    mPassFrom.assign(static_cast<size_t>(mOut), -1);
+    for (int32_t r = 0; r < mOut; ++r) {
+        int32_t from = -1;
+        bool pass = true;
+        for (int32_t c = 0; c < mIn && pass; ++c) {
+            const float g = gain(r, c);
+            if (g == 0.0f) continue;
+            if (g != 1.0f || from >= 0) pass = false;
+            else from = c;
+        }
+        if (pass) mPassFrom[r] = from; // stays -1 for an all-zero row
+    }
+}
+
+void MixMatrix::apply(const float* const* in, int32_t frames, float* const* scratch,
+                      const float** out) const {
+    for (int32_t r = 0; r < mOut; ++r) {
+        if (mPassFrom[r] >= 0) {
+            out[r] = in[mPassFrom[r]];
+            continue;
+        }
+        float* dst = scratch[r];
+        bool first = true;
+        for (int32_t c = 0; c < mIn; ++c) {
+            const float g = gain(r, c);
+            if (g == 0.0f) continue;
+            const float* src = in[c];
+            if (first) {
+                for (int32_t i = 0; i < frames; ++i) dst[i] = g * src[i];
+                first = false;
+            } else {
+                for (int32_t i = 0; i < frames; ++i) dst[i] += g * src[i];
+            }
+        }
+        if (first) std::memset(dst, 0, static_cast<size_t>(frames) * sizeof(float));
+        out[r] = dst;
+    }
+}
+
+} // namespace chmix
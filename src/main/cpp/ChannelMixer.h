@@ -0,0 +1,61 @@
+// ChannelMixer.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Channel layout helpers for the engine's device <-> DSP boundary.
+ *
+ * Device buffers are interleaved with any channel count; the DSP chain works
+ * on planar channels (one STFT channel, or two in stereo mode). In between:
+ *   deinterleave / interleave  planar <-> interleaved, with SIMD kernels for
+ *                              1, 2 and 4 channels (NEON vld/vst on arm,
+ *                              SSE shuffles on x86) and a scalar loop otherwise
+ *   MixMatrix                  out[r] = sum_c gain[r][c] * in[c], per frame;
+ *                              rows that pass one input through unchanged are
+ *                              returned as that input plane instead of copied
+ */
+namespace chmix {
+
+constexpr int32_t kMaxChannels = 16;
+
+// planes[c][i] = inter[i * channels + c]
+void deinterleave(const float* inter, int32_t frames, int32_t channels, float* const* planes);
+// inter[i * channels + c] = planes[c][i]; planes may alias (e.g. mono to all outputs)
+void interleave(const float* const* planes, int32_t channels, int32_t frames, float* inter);
+
+class MixMatrix {
+public:
+    MixMatrix() = default;
+    MixMatrix(int32_t outChannels, int32_t inChannels);   // all gains zero
+
+    // Default routing between channel counts. Folding down (in >= out),
+    // output r averages inputs r, r + out, r + 2*out...: everything to mono,
+    // a mic array ordered L, R, L, R... to stereo. Spreading up (in < out),
+    // output r takes input r % in: mono everywhere, stereo alternating L, R.
+    static MixMatrix standard(int32_t inChannels, int32_t outChannels);
+    static MixMatrix identity(int32_t channels);
+
+    int32_t outChannels() const { return mOut; }
+    int32_t inChannels()  const { return mIn; }
+    bool    empty() const { return mOut == 0; }
+    float   gain(int32_t r, int32_t c) const { return mGains[static_cast<size_t>(r) * mIn + c]; }
+    void    setGain(int32_t r, int32_t c, float g);
+
+    // Mixes 'frames' frames. Rows that are a single unity gain leave
+    // out[r] = in[c] untouched; every other row is written to scratch[r] and
+    // out[r] = scratch[r]. scratch[r] must hold 'frames' floats.
+    void apply(const float* const* in, int32_t frames, float* const* scratch,
+               const float** out) const;
+
+private:
+    void    analyse();
+
+    int32_t mOut = 0;
+    int32_t mIn = 0;
+    std::vector<float>   mGains;      // row-major, mOut x mIn
+    std::vector<int32_t> mPassFrom;   // per row: input passed through, or -1
+};
+
+} // namespace chmix
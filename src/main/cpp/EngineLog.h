@@ -0,0 +1,43 @@
+// EngineLog.h
+#pragma once
+
+/**
+ * LOGV/LOGD/LOGI/LOGW/LOGE for the engine sources.
+ *
+ * Android: the sample's logging_macros.h (logcat). Elsewhere: one line per
+ * call on stderr; LOGV and LOGD print only with ENGINE_LOG_VERBOSE defined
+ * (their arguments are still type-checked), and enginelog::setQuiet() drops
+ * LOGI for tools that run many engines.
+ */
+#if defined(__ANDROID__)
+#include <logging_macros.h> // same macro set used in the sample
+#else
+#include <atomic>
+#include <cstdio>
+
+namespace enginelog {
+inline std::atomic<bool> gQuiet{false};
+inline void setQuiet(bool quiet) { gQuiet.store(quiet, std::memory_order_relaxed); }
+inline bool quiet() { return gQuiet.load(std::memory_order_relaxed); }
+} // namespace enginelog
+
+// The lock keeps lines from different threads whole
+#define ENGINE_LOG_LINE(tag, ...)                  \
+    do {                                           \
+        flockfile(stderr);                         \
+        std::fprintf(stderr, tag " " __VA_ARGS__); \
+        std::fputc('\n', stderr);                  \
+        funlockfile(stderr);                       \
+    } while (0)
+
+#if defined(ENGINE_LOG_VERBOSE)
+#define LOGV(...) ENGINE_LOG_LINE("V", __VA_ARGS__)
+#define LOGD(...) ENGINE_LOG_LINE("D", __VA_ARGS__)
+#else
+#define LOGV(...) do { if (false) std::fprintf(stderr, __VA_ARGS__); } while (0)
+#define LOGD(...) do { if (false) std::fprintf(stderr, __VA_ARGS__); } while (0)
+#endif
+#define LOGI(...) do { if (!enginelog::quiet()) ENGINE_LOG_LINE("I", __VA_ARGS__); } while (0)
+#define LOGW(...) ENGINE_LOG_LINE("W", __VA_ARGS__)
+#define LOGE(...) ENGINE_LOG_LINE("E", __VA_ARGS__)
+#endif
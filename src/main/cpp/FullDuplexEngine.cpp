@@ -1,248 +1,645 @@
 #include "FullDuplexEngine.h"
-#include <logging_macros.h> // same macro set used in the sample
+#include "EngineLog.h"
+#include "QuantKernels.h"
+#include "StageTimer.h"
+#include "TraceSpan.h"
 #include <cinttypes>
+#include <cmath>
+#include <cstring>
 #include <atomic>
 #include <chrono>
-#ifdef __ANDROID__
-#include <sys/resource.h>
-#endif
+#include <cerrno>
+#include <ctime>
 
-// --- Small helpers for (de)interleaving ---
-static inline void deinterleaveStereo(const float* inter, int frames,
-                                      float* L, float* R) {
-    const float* p = inter;
-    for (int i = 0; i < frames; ++i) {
-        L[i] = *p++;
-        R[i] = *p++;
-    }
+// Carves 'channels' planes of 'frames' floats out of buf.
+static void assignPlanes(std::vector<float>& buf, std::vector<float*>& planes,
+                         int32_t channels, int32_t frames) {
+    buf.assign(static_cast<size_t>(channels) * frames, 0.0f);
+    planes.resize(channels);
+    for (int32_t c = 0; c < channels; ++c) planes[c] = buf.data() + static_cast<size_t>(c) * frames;
 }
-static inline void interleaveStereo(const float* L, const float* R, int frames,
-                                    float* inter) {
-    float* p = inter;
-    for (int i = 0; i < frames; ++i) {
-        *p++ = L[i];
-        *p++ = R[i];
-    }
+static inline int64_t monotonicNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Hop (at the STFT rate) that one burst of fpb device frames fills exactly,
+// or 0 if the burst does not map onto a usable hop for this geometry.
+static int32_t burstAlignedHop(int32_t fpb, int32_t decim, const StftProcessor::Config& cfg) {
+    constexpr int32_t kMinHop = 16;
+    if (fpb <= 0 || fpb % decim != 0) return 0;
+    const int32_t hop = fpb / decim;
+    if (hop < kMinHop || 2 * hop > cfg.frameSize) return 0;
+    return hop;
 }
+
 bool FullDuplexEngine::start() {
     if (!mIn || !mOut) return false;
-    const int32_t ch = mOut->getChannelCount();
-    const int32_t fpb = mOut->getFramesPerBurst();
-    const int32_t sr  = mOut->getSampleRate();
-    (void)sr; // not used here, but useful to log if you want
+    const int32_t inCh = mIn->channelCount();
+    const int32_t ch = mOut->channelCount();
+    const int32_t fpb = mOut->framesPerBurst();
+    const int32_t sr  = mOut->sampleRate();
+    tracing::initialize();
 
     // ~200 ms of capacity is a nice safety margin but still low-latency
     const int32_t capFrames = sr / 5; // e.g., 48000/5 = 9600
-    if (!mInRing.init(capFrames, ch))  return false;
-    if (!mOutRing.init(capFrames, ch)) return false;
+    if (inCh < 1 || inCh > chmix::kMaxChannels || ch < 1 || ch > chmix::kMaxChannels) {
+        LOGE("FullDuplexEngine.start(): unsupported channel counts in=%d out=%d", inCh, ch);
+        return false;
+    }
+    if (!mInRing.init(capFrames, inCh)) return false;
+    if (!mOutRing.init(capFrames, ch))  return false;
+
+    mTmpIn.resize(static_cast<size_t>(fpb) * inCh);
+    mTmpXfer.resize(static_cast<size_t>(fpb) * inCh);
 
-    mTmpIn.resize(static_cast<size_t>(fpb) * ch);
-    mTmpXfer.resize(static_cast<size_t>(fpb) * ch);
+    // STFT geometry for the selected rate (keeps the window mode)
+    const bool native = (mStftRate == StftRate::Native);
+    StftProcessor::Config stftCfg = native ? StftProcessor::Config::native48k()
+                                           : StftProcessor::Config::mid16k();
+    if (native) stftCfg.sampleRate = sr;
+    const int32_t decim = native ? 1 : 3;
+    const int32_t alignedHop = mBurstAlignedHop ? burstAlignedHop(fpb, decim, stftCfg) : 0;
+    if (alignedHop > 0) stftCfg.hopSize = alignedHop;
+    if (!mStft.configure(stftCfg)) {
+        LOGE("FullDuplexEngine.start(): invalid STFT config %d/%d/%d",
+             stftCfg.fftSize, stftCfg.frameSize, stftCfg.hopSize);
+        return false;
+    }
+    const int32_t stftCh = mStereoStft ? 2 : 1;
+    mStft.setChannelCount(stftCh);
+
+    // Routing: input channels -> STFT channels -> output channels
+    if (!mCustomDownmix) mDownmix = chmix::MixMatrix::standard(inCh, stftCh);
+    if (!mCustomUpmix)   mUpmix   = chmix::MixMatrix::standard(stftCh, ch);
+    if (mDownmix.inChannels() != inCh || mDownmix.outChannels() != stftCh ||
+        mUpmix.inChannels() != stftCh || mUpmix.outChannels() != ch) {
+        LOGE("FullDuplexEngine.start(): mix matrices %dx%d / %dx%d do not fit %d -> %d -> %d channels",
+             mDownmix.outChannels(), mDownmix.inChannels(), mUpmix.outChannels(), mUpmix.inChannels(),
+             inCh, stftCh, ch);
+        return false;
+    }
+
+    // Int8 kernel for per-hop models: best the CPU supports
+    quant::select(quant::detectBest());
+    LOGI("FullDuplexEngine.start(): int8 kernel %s", quant::kernelName(quant::selected()));
+    if (mMask.isLoaded()) {
+        (void)mMask.setQuantized(mMaskQuantized);
+    }
+    (void)mStft.removeSpectralProcessor(&mLogMel);
+    if (mLogMelEnabled) {
+        if (!mLogMel.prepare(mLogMelConfig, stftCfg.fftSize, stftCfg.sampleRate) ||
+            !mStft.addSpectralProcessor(&mLogMel)) {
+            LOGE("FullDuplexEngine.start(): cannot attach log-mel features (%d mels)", mLogMelConfig.numMels);
+            return false;
+        }
+    }
 
-    // Prime output ring with a few bursts of silence so the first callbacks do not underflow.
+    // Callback mode has no worker threads to feed
+    const bool callback = (mIoMode == IoMode::Callback);
+    const bool pipelined = mPipelined && !callback;
+    mPipelineActive = pipelined;
+
+    // Prime output ring with silence so the first callbacks do not underflow.
+    // Output arrives one hop at a time, so cover one hop (or the target depth,
+    // if larger); in threaded mode the latency controller then grows the depth
+    // on underflow and trims back what scheduling jitter never used. In callback
+    // mode input and output advance together, so only a hop that does not match
+    // the burst needs cover.
     {
-        const int kPrimeBursts = 20; // ~20 * 96 frames @48k ≈ 40 ms of audio
+        const int hopBursts = (stftCfg.hopSize * decim + fpb - 1) / fpb;
+        const int targetBursts = (targetLatencyFrames() + fpb - 1) / fpb;
+        const int kPrimeBursts = callback ? (alignedHop > 0 ? 0 : hopBursts)
+                                          : std::max(hopBursts, targetBursts);
         std::vector<float> zeros(static_cast<size_t>(fpb) * ch, 0.0f);
+        mPrimedFrames = 0;
         for (int i = 0; i < kPrimeBursts; ++i) {
-            // Ignore return; if the ring can't take more it will just stop filling.
-            (void)mOutRing.writeInterleaved(zeros.data(), fpb);
-        }
-    }
-// Record start time (optional future use: grace period for counters)
-    mStartTime = std::chrono::steady_clock::now();
-
-    // NEW: per-channel scratch
-    mL48.resize(fpb);
-    mR48.resize(fpb);
-    mL16.resize(fpb / 3);
-    mR16.resize(fpb / 3);
-    mL48b.resize(fpb * 3);
-    mR48b.resize(fpb * 3);
-    mTmpOut.resize(static_cast<size_t>(fpb) * 3 * ch);
-
-    // NEW (M3): mono buffers
-    mMono16.resize(fpb / 3);
-    mBlkMono16.resize(fpb / 3);
-    mUp48Mono.resize(fpb * 3);
-    // STFT hop buffers (one hop = 96 @16k)
-    mHopIn16.resize(96);
-    mHopOut16.resize(96);
-
-    mBlkL16.resize(fpb / 3);
-    mBlkR16.resize(fpb / 3);
-
-    const int32_t cap16 = (sr / 5) / 3; // 48k/5/3 ≈ 3200
-    if (!mMid16kL.init(cap16, 1)) return false;
-    if (!mMid16kR.init(cap16, 1)) return false;
-    if (!mMid16kMono.init(cap16, 1)) return false;  // NEW
-
-// Reset resamplers (not strictly necessary, but tidy)
-    mDownL.reset(); mDownR.reset();
-    mUpL.reset();   mUpR.reset();
-    mUpMono.reset(); // NEW
-    // Start streams so read()/callback are active
-    {
-        auto rIn = mIn->requestStart();
-        LOGI("FullDuplexEngine.start(): requestStart(input) -> %s", oboe::convertToText(rIn));
-        if (rIn != oboe::Result::OK) {
+            // If the ring can't take more it will just stop filling.
+            mPrimedFrames += mOutRing.writeInterleaved(zeros.data(), fpb);
+        }
+        LOGI("FullDuplexEngine.start(): hop %d%s, primed %d bursts",
+             stftCfg.hopSize, alignedHop > 0 ? " (burst-aligned)" : "", kPrimeBursts);
+
+        LatencyController::Config lc;
+        lc.targetFrames    = targetLatencyFrames();
+        lc.burstFrames     = fpb;
+        lc.windowFrames    = sr / 2;
+        lc.maxMarginFrames = 16 * fpb;
+        lc.maxTrimFrames   = 8 * fpb;
+        mLatency.configure(lc);
+        mAdaptiveLatency = !callback;
+        mTrimBuf.assign(static_cast<size_t>(lc.maxTrimFrames + kTrimCrossfadeFrames) * ch, 0.0f);
+        mSilentTrims.store(0);
+        mFadeInLeft = 0;
+    }
+    // Underflows are not counted for the first ~300 ms of playback. Counted
+    // in device frames rather than wall time, so simulated devices running
+    // on a virtual clock see the same grace period.
+    mWarmupFramesLeft = static_cast<int64_t>(sr) * 3 / 10;
+
+    // Planar scratch per channel. Up to kMaxBatchHops STFT hops can be
+    // drained per pass when catching up.
+    const int32_t hop = mStft.hopSize();
+    const int32_t maxBatch = StftProcessor::kMaxBatchHops * hop;
+    const int32_t up48Cap = native ? std::max(fpb, maxBatch) : std::max(fpb * 3, maxBatch * 3);
+    std::vector<float*> midPtr;
+    assignPlanes(mIn48, mIn48Ptr, inCh, fpb);
+    assignPlanes(mMix48, mMix48Ptr, stftCh, fpb);
+    assignPlanes(mMid, midPtr, stftCh, fpb / 3);
+    assignPlanes(mUp48, mUp48Ptr, stftCh, up48Cap);
+    assignPlanes(mOut48, mOut48Ptr, ch, up48Cap);
+    mMixedPtr.assign(stftCh, nullptr);
+    mOutMixedPtr.assign(ch, nullptr);
+    mTmpOut.resize(static_cast<size_t>(up48Cap) * ch);
+
+    // STFT hop buffers (up to kMaxBatchHops hops)
+    mHopIn16.resize(maxBatch);
+    mHopOut16.resize(maxBatch);
+    mHopIn16R.resize(maxBatch);
+    mHopOut16R.resize(maxBatch);
+
+    const int32_t capMid = native ? sr / 5 : (sr / 5) / 3; // 48k/5/3 ≈ 3200
+    if (!mMid16kL.init(capMid, 1)) return false;
+    if (!mMid16kR.init(capMid, 1)) return false;
+    if (!mMid16kMono.init(capMid, 1)) return false;
+
+    // Fresh resampler state, one per STFT channel each way
+    mDownBank.assign(stftCh, Resampler3x(Resampler3x::Mode::DownBy3));
+    mUpBank.assign(stftCh, Resampler3x(Resampler3x::Mode::UpBy3));
+
+#if ENGINE_STAGE_TIMING
+    stagetimer::configure(static_cast<int64_t>(fpb) * 1000000000LL / sr);
+#endif
+    mDbgLastCapture = {mCaptureNs.count(), mCaptureNs.sum()};
+    mDbgLastHandoff = {mHandoffNs.count(), mHandoffNs.sum()};
+    mDbgLastStft    = {mStftNs.count(), mStftNs.sum()};
+    mLastEnqueueNs.store(0);
+    if (pipelined && !mStftWakeInit) {
+        if (sem_init(&mStftWake, 0, 0) != 0) return false;
+        mStftWakeInit = true;
+    }
+    mCbTailFrames = 0;
+    mCbInputOwed = 0;
+    mCbThreadReady = false;
+    if (callback) {
+        // The driver starts input before output and reads input without
+        // blocking inside the output callback
+        if (!mDriver) {
+            LOGE("FullDuplexEngine.start(): callback mode needs a duplex driver");
+            return false;
+        }
+        if (!mDriver->start(&mPass)) {
+            LOGE("FullDuplexEngine.start(): duplex driver failed to start");
+            return false;
+        }
+        mDriverStarted = true;
+    } else {
+        // Start streams so read()/callback are active
+        if (!mIn->requestStart()) {
+            LOGE("FullDuplexEngine.start(): input stream failed to start");
             return false;
         }
-        auto rOut = mOut->requestStart();
-        LOGI("FullDuplexEngine.start(): requestStart(output) -> %s", oboe::convertToText(rOut));
-        if (rOut != oboe::Result::OK) {
+        if (!mOut->requestStart()) {
+            LOGE("FullDuplexEngine.start(): output stream failed to start");
             (void)mIn->requestStop(); // best-effort rollback
             return false;
         }
     }
 
     mRunning.store(true, std::memory_order_release);
-    mThread = std::thread(&FullDuplexEngine::ioThreadFunc, this);
+    if (pipelined) {
+        mStftThread = std::thread(&FullDuplexEngine::stftThreadFunc, this);
+    }
+    if (!callback) {
+        mThread = std::thread(&FullDuplexEngine::ioThreadFunc, this);
+    }
+    LOGI("FullDuplexEngine.start(): %s mode (depth %d hops), %d ch -> %s STFT -> %d ch @%d Hz (%d/%d), %s windows",
+         callback ? "callback" : pipelined ? "pipelined" : "single-thread", mPipelineDepthHops,
+         inCh, mStereoStft ? "stereo" : "mono", ch, stftCfg.sampleRate, stftCfg.frameSize, hop,
+         mStft.windowMode() == StftProcessor::WindowMode::LowDelay ? "low-delay" : "symmetric");
+    LOGI("FullDuplexEngine.start(): algorithmic latency %d frames (%.2f ms) @%d, STFT delay %d frames",
+         algorithmicLatencyFrames(), 1000.0 * algorithmicLatencyFrames() / sr, sr,
+         mStft.algorithmicDelayFrames());
     return true;
 }
 
+int32_t FullDuplexEngine::algorithmicLatencyFrames() const {
+    if (mStftRate == StftRate::Native) return mStft.algorithmicDelayFrames();
+    // 16k delay scaled to 48k, plus 2 frames: the box decimator averages
+    // frames 3m..3m+2 (centred on 3m+1) and the linear interpolator puts 16k
+    // sample m back on frame 3m + 3
+    return mStft.algorithmicDelayFrames() * 3 + 2;
+}
+
 void FullDuplexEngine::stop() {
-    if (mRunning.exchange(false)) {
+    const bool wasRunning = mRunning.exchange(false);
+    if (wasRunning) {
         if (mThread.joinable()) mThread.join();
+        if (mStftWakeInit) (void)sem_post(&mStftWake); // unblock the worker
+        if (mStftThread.joinable()) mStftThread.join();
+    }
+    if (mStftWakeInit) {
+        sem_destroy(&mStftWake);
+        mStftWakeInit = false;
     }
 
     // Stop streams (best effort)
-    if (mOut) {
-        auto r = mOut->requestStop();
-        if (r != oboe::Result::OK) {
-            LOGW("FullDuplexEngine.stop(): requestStop(output) -> %s", oboe::convertToText(r));
-        }
-    }
-    if (mIn) {
-        auto r = mIn->requestStop();
-        if (r != oboe::Result::OK) {
-            LOGW("FullDuplexEngine.stop(): requestStop(input) -> %s", oboe::convertToText(r));
-        }
+    if (mDriverStarted) {
+        mDriver->stop(); // both streams
+        mDriverStarted = false;
+        if (wasRunning) logStats();
+        return;
     }
+    if (mOut) (void)mOut->requestStop();
+    if (mIn) (void)mIn->requestStop();
 }
 
 void FullDuplexEngine::ioThreadFunc() {
-    const int32_t fpb = mOut->getFramesPerBurst();
-    #ifdef __ANDROID__
-    setpriority(PRIO_PROCESS, 0, -18);
-    #endif
+    const int32_t fpb = mOut->framesPerBurst();
+    {
+        rt::ThreadReport report;
+        (void)rt::setupCurrentThread(mThreadConfig, &report);
+        LOGI("FullDuplexEngine io thread: %s", report.describe().c_str());
+        tracing::setThreadName("fde.io");
+    }
     auto lastLog = std::chrono::steady_clock::now();
 
     while (mRunning.load(std::memory_order_acquire)) {
         // 1) BLOCKING READ from input
-        oboe::ResultWithValue<int32_t> res =
-                mIn->read(mTmpIn.data(), fpb, 10 * 1000 * 1000 /* 10ms timeout */);
-
-        if (!res) {
-            continue; // glitchgit
-        }
-
-        int32_t got = res.value();
-        if (got <= 0) continue;
+        const int32_t got = [&]() {
+            STAGE_TIMER(Read);
+            return mIn->read(mTmpIn.data(), fpb, 10 * 1000 * 1000 /* 10ms timeout */);
+        }();
+        if (got <= 0) continue; // timeout or glitch
 
         // 2) push to input ring
-        int32_t wrote = mInRing.writeInterleaved(mTmpIn.data(), got);
-        if (wrote < got) mOverflows.fetch_add(got - wrote);
+        {
+            TRACE_SPAN("inRing.write");
+            int32_t wrote = mInRing.writeInterleaved(mTmpIn.data(), got);
+            if (wrote < got) mOverflows.add(got - wrote);
+        }
 
-        // 3) 48k -> 16k -> (mono) -> 48k round-trip
+        // 3) 48k -> 16k (Resampled16k only) -> (mono), queued on the mid-rate ring(s)
         int32_t canXfer = std::min(mInRing.availableToRead(), mOutRing.availableToWrite());
         while (canXfer >= fpb) {
             // read one burst @48k interleaved
-            int32_t rd = mInRing.readInterleaved(mTmpXfer.data(), fpb);
-            if (rd == fpb) {
-                // deinterleave to L/R @48k
-                deinterleaveStereo(mTmpXfer.data(), fpb, mL48.data(), mR48.data());
-
-                // downsample by 3 -> 16k (expect fpb/3 frames)
-                const int out16L = mDownL.process(mL48.data(), fpb, mL16.data(), (int)mL16.size());
-                const int out16R = mDownR.process(mR48.data(), fpb, mR16.data(), (int)mR16.size());
-                const int out16  = std::min(out16L, out16R);
-
-                // --- Milestone 3: mix to mono @16k
-                for (int i = 0; i < out16; ++i) {
-                    mMono16[i] = 0.5f * (mL16[i] + mR16[i]);
-                }
-
-                // write mono to mono ring (decoupling point for future STFT/model)
-                int wM = mMid16kMono.writeInterleaved(mMono16.data(), out16);
-                if (wM < out16) {
-                    mOverflows.fetch_add(out16 - wM);
-                }
-
-// Feed STFT in 96-sample hops, pop 96 back each hop, upsample to 48k, duplicate to stereo
-                while (mMid16kMono.availableToRead() >= 96) {
-                    (void)mMid16kMono.readInterleaved(mHopIn16.data(), 96);
-
-                    // push 96 into STFT
-                    mStft.pushTimeDomain(mHopIn16.data(), 96);
-
-                    // pop exactly 96 out of STFT
-                    const int got16 = mStft.popTimeDomain(mHopOut16.data(), 96);
-                    if (got16 == 96) {
-                        // upsample 96 -> 288 @48k
-                        const int up = mUpMono.process(mHopOut16.data(), 96, mUp48Mono.data(), (int)mUp48Mono.size());
-                        const int upFrames = up; // allow full 288 frames from one hop
-
-                        // duplicate mono to stereo
-                        for (int i = 0; i < upFrames; ++i) {
-                            mL48b[i] = mUp48Mono[i];
-                            mR48b[i] = mUp48Mono[i];
-                        }
-
-                        // interleave and write to out ring
-                        interleaveStereo(mL48b.data(), mR48b.data(), upFrames, mTmpOut.data());
-                        int32_t wr = mOutRing.writeInterleaved(mTmpOut.data(), upFrames);
-                        if (wr < upFrames) mOverflows.fetch_add(upFrames - wr);
-                    }
-                }
+            int32_t rd;
+            {
+                TRACE_SPAN("inRing.read");
+                rd = mInRing.readInterleaved(mTmpXfer.data(), fpb);
             }
+            if (rd == fpb) captureBlock(mTmpXfer.data(), fpb);
             canXfer = std::min(mInRing.availableToRead(), mOutRing.availableToWrite());
         }
 
+        // 4) STFT stage: inline, or handed to the worker in pipelined mode
+        if (mPipelineActive) {
+            if (queued16() >= mStft.hopSize()) {
+                mLastEnqueueNs.store(monotonicNanos(), std::memory_order_release);
+                (void)sem_post(&mStftWake);
+            }
+        } else {
+            drainStftHops();
+        }
+
         // --- Periodic stats log every 1s ---
         auto now = std::chrono::steady_clock::now();
         if (now - lastLog > std::chrono::seconds(1)) {
             lastLog = now;
-            // STFT counters
-            uint64_t hops   = mStft.hopsProcessed();
-            uint64_t pushed = mStft.framesPushed();
-            uint64_t popped = mStft.framesPopped();
-
-            LOGD("Stats: InRing=%d OutRing=%d Overflows=%" PRId64 " Underflows=%" PRId64
-                         " | STFT hops +%llu (tot %llu), push +%llu, pop +%llu",
-                 mInRing.availableToRead(),
-                 mOutRing.availableToRead(),
-                 static_cast<int64_t>(mOverflows.load()),
-                 static_cast<int64_t>(mUnderflows.load()),
-                 (unsigned long long)(hops   - mDbgLastHops),
-                 (unsigned long long)hops,
-                 (unsigned long long)(pushed - mDbgLastPushed),
-                 (unsigned long long)(popped - mDbgLastPopped));
-
-            mDbgLastHops   = hops;
-            mDbgLastPushed = pushed;
-            mDbgLastPopped = popped;
+            logStats();
+        }
+    }
+}
+
+void FullDuplexEngine::captureBlock(const float* inter, int32_t frames) {
+    STAGE_TIMER(Capture);
+    metrics::ScopedNanos captureTime(mCaptureNs);
+    // deinterleave and route the input channels to the STFT channels @48k
+    chmix::deinterleave(inter, frames, mDownmix.inChannels(), mIn48Ptr.data());
+    mDownmix.apply(mIn48Ptr.data(), frames, mMix48Ptr.data(), mMixedPtr.data());
+
+    // downsample by 3 -> 16k (frames/3); Native mode
+    // queues the 48k channels as they are
+    const int32_t stftCh = mDownmix.outChannels();
+    const float* mid[2] = {mMixedPtr[0], mMixedPtr[stftCh - 1]};
+    int outMid = frames;
+    if (mStftRate == StftRate::Resampled16k) {
+        STAGE_TIMER(Downsample);
+        const int32_t cap = static_cast<int32_t>(mMid.size()) / stftCh;
+        for (int32_t c = 0; c < stftCh; ++c) {
+            float* dst = mMid.data() + static_cast<size_t>(c) * cap;
+            outMid = mDownBank[c].process(mid[c], frames, dst, cap);
+            mid[c] = dst;
+        }
+    }
+
+    // write to the mid-rate ring(s) (decoupling point for the STFT/model).
+    // In pipelined mode the rings are the handoff to the STFT worker,
+    // bounded to the configured depth.
+    int toWrite = outMid;
+    if (mPipelineActive) {
+        const int room = mPipelineDepthHops * mStft.hopSize() - queued16();
+        toWrite = std::max(0, std::min(outMid, room));
+    }
+    TRACE_SPAN("midRing.write");
+    int wM;
+    if (mStereoStft) {
+        // keep L/R in step: only write what both rings accept
+        toWrite = std::min({toWrite, mMid16kL.availableToWrite(), mMid16kR.availableToWrite()});
+        wM = mMid16kL.writeInterleaved(mid[0], toWrite);
+        (void)mMid16kR.writeInterleaved(mid[1], wM);
+    } else {
+        wM = mMid16kMono.writeInterleaved(mid[0], toWrite);
+    }
+    if (wM < outMid) {
+        mOverflows.add(outMid - wM);
+    }
+}
+
+void FullDuplexEngine::logStats() {
+    // STFT counters
+    uint64_t hops   = mStft.hopsProcessed();
+    uint64_t pushed = mStft.framesPushed();
+    uint64_t popped = mStft.framesPopped();
+
+    LOGD("Stats: InRing=%d OutRing=%d Overflows=%" PRId64 " Underflows=%" PRId64
+                 " | STFT hops +%llu (tot %llu, batches %llu), push +%llu, pop +%llu",
+         mInRing.availableToRead(),
+         mOutRing.availableToRead(),
+         mOverflows.value(),
+         mUnderflows.value(),
+         (unsigned long long)(hops   - mDbgLastHops),
+         (unsigned long long)hops,
+         (unsigned long long)mStft.batchesProcessed(),
+         (unsigned long long)(pushed - mDbgLastPushed),
+         (unsigned long long)(popped - mDbgLastPopped));
+
+    // Stage averages over this interval; maxima are cumulative (registry)
+    const StageMark capture{mCaptureNs.count(), mCaptureNs.sum()};
+    const StageMark handoff{mHandoffNs.count(), mHandoffNs.sum()};
+    const StageMark stft{mStftNs.count(), mStftNs.sum()};
+    auto avgUs = [](const StageMark& now, const StageMark& last) {
+        const uint64_t n = now.count - last.count;
+        return n ? double(now.sumNs - last.sumNs) / double(n) / 1000.0 : 0.0;
+    };
+    LOGD("Stages (avg/max us): capture %.1f/%.1f handoff %.1f/%.1f stft %.1f/%.1f | queued16=%d",
+         avgUs(capture, mDbgLastCapture), double(mCaptureNs.max()) / 1000.0,
+         avgUs(handoff, mDbgLastHandoff), double(mHandoffNs.max()) / 1000.0,
+         avgUs(stft, mDbgLastStft), double(mStftNs.max()) / 1000.0,
+         queued16());
+
+    // Processing cost per second of audio (capture + STFT stages, both
+    // resamplers included in Resampled16k mode), comparable across rates
+    const int64_t stageNs = (capture.sumNs - mDbgLastCapture.sumNs) + (stft.sumNs - mDbgLastStft.sumNs);
+    const double audioSec = double(popped - mDbgLastPopped) / double(mStft.config().sampleRate);
+    if (audioSec > 0.0) {
+        LOGD("CPU: %.2f ms per s of audio @%d Hz STFT, latency %d frames",
+             double(stageNs) / 1e6 / audioSec,
+             mStft.config().sampleRate, algorithmicLatencyFrames());
+    }
+    mDbgLastCapture = capture;
+    mDbgLastHandoff = handoff;
+    mDbgLastStft    = stft;
+
+    if (mAdaptiveLatency) {
+        LOGD("Latency: target %d buffered %d margin %d frames, achieved %d frames"
+             " | trims %llu (%llu frames, %llu silent), padded %llu frames",
+             mLatency.targetFrames(), mLatency.bufferedFrames(), mLatency.marginFrames(),
+             achievedLatencyFrames(),
+             (unsigned long long)mLatency.trims(),
+             (unsigned long long)mLatency.trimmedFrames(),
+             (unsigned long long)mSilentTrims.load(std::memory_order_relaxed),
+             (unsigned long long)mLatency.paddedFrames());
+    }
+
+    if (mMask.isLoaded()) {
+        const uint64_t run = mMask.hopsRun();
+        LOGD("Mask model: run %llu bypassed %llu overruns %llu, avg/max %.1f/%.1f us",
+             (unsigned long long)run,
+             (unsigned long long)mMask.hopsBypassed(),
+             (unsigned long long)mMask.overruns(),
+             run ? double(mMask.totalHopNs()) / double(run) / 1000.0 : 0.0,
+             double(mMask.maxHopNs()) / 1000.0);
+    }
+
+#if ENGINE_STAGE_TIMING
+    const std::string stageTimes = stagetimer::report();
+    if (!stageTimes.empty()) LOGD("Stage timing:\n%s", stageTimes.c_str());
+#endif
+
+    mDbgLastHops   = hops;
+    mDbgLastPushed = pushed;
+    mDbgLastPopped = popped;
+}
+
+void FullDuplexEngine::processDuplex(const float* in, int32_t numIn, float* out, int32_t numOut) {
+    const int32_t fpb = mOut->framesPerBurst();
+
+    // The callback thread belongs to the audio service; only FTZ is ours to set
+    if (!mCbThreadReady) {
+        if (mThreadConfig.flushDenormals) (void)rt::flushDenormals();
+        mCbThreadReady = true;
+    }
+
+    captureCallbackInput(in, numIn);
+
+    // The driver hands each callback at most its own length of input, so the
+    // frames a short read left on the device would wait there until overwritten.
+    // Read them back now, without blocking, up to what the device can hold.
+    mCbInputOwed = std::max(0, std::min(mCbInputOwed + numOut - numIn, kMaxOwedBursts * fpb));
+    while (mCbInputOwed > 0) {
+        const int32_t got = mIn->read(mTmpIn.data(), std::min(mCbInputOwed, fpb), 0);
+        if (got <= 0) break;
+        captureCallbackInput(mTmpIn.data(), got);
+        mCbInputOwed -= got;
+    }
+
+    drainStftHops();
+
+    // Same-thread carry: whatever the hops produced beyond this buffer stays queued
+    (void)pullTo(out, numOut);
+}
+
+void FullDuplexEngine::captureCallbackInput(const float* in, int32_t numIn) {
+    const int32_t ch = mIn->channelCount(); // input side; the output side is pullTo's
+    const int32_t fpb = mOut->framesPerBurst();
+    const int32_t decim = (mStftRate == StftRate::Native) ? 1 : 3;
+
+    // Capture in blocks of at most one burst. The decimator takes whole groups
+    // of 3, so up to 2 frames wait at the front of mTmpXfer for the next call.
+    while (numIn > 0) {
+        const int32_t take = std::min(numIn, fpb - mCbTailFrames);
+        std::memcpy(mTmpXfer.data() + static_cast<size_t>(mCbTailFrames) * ch, in,
+                    static_cast<size_t>(take) * ch * sizeof(float));
+        in += static_cast<size_t>(take) * ch;
+        numIn -= take;
+        const int32_t avail = mCbTailFrames + take;
+        const int32_t usable = avail - avail % decim;
+        if (usable > 0) captureBlock(mTmpXfer.data(), usable);
+        mCbTailFrames = avail - usable;
+        if (mCbTailFrames > 0) {
+            std::memmove(mTmpXfer.data(), mTmpXfer.data() + static_cast<size_t>(usable) * ch,
+                         static_cast<size_t>(mCbTailFrames) * ch * sizeof(float));
+        }
+    }
+}
+
+// Feed STFT all whole hops pending (batched after a stall), pop the same amount
+// back, upsample to 48k unless the STFT runs natively, and route the STFT
+// channels to the output channels through the upmix. Runs on the io thread, or
+// on the STFT worker in pipelined mode (then the only producer of mOutRing).
+void FullDuplexEngine::drainStftHops() {
+    STAGE_TIMER(Stft);
+    metrics::ScopedNanos stftTime(mStftNs);
+    const int hop = mStft.hopSize();
+    const bool native = (mStftRate == StftRate::Native);
+    int hops = std::min(queued16() / hop, StftProcessor::kMaxBatchHops);
+    while (hops > 0) {
+        const int n16 = hops * hop;
+        int got16;
+        if (mStereoStft) {
+            (void)mMid16kL.readInterleaved(mHopIn16.data(), n16);
+            (void)mMid16kR.readInterleaved(mHopIn16R.data(), n16);
+
+            // push n16 L/R frames into the packed stereo STFT, pop the same back
+            mStft.pushTimeDomainStereo(mHopIn16.data(), mHopIn16R.data(), n16);
+            got16 = mStft.popTimeDomainStereo(mHopOut16.data(), mHopOut16R.data(), n16);
+        } else {
+            (void)mMid16kMono.readInterleaved(mHopIn16.data(), n16);
+
+            // push n16 into STFT (several hops go through the batch path)
+            mStft.pushTimeDomain(mHopIn16.data(), n16);
+
+            // pop exactly n16 out of STFT
+            got16 = mStft.popTimeDomain(mHopOut16.data(), n16);
+        }
+        if (got16 == n16) {
+            const float* stftOut[2] = {mHopOut16.data(), mHopOut16R.data()};
+            int upFrames = n16;
+            if (!native) {
+                STAGE_TIMER(Upsample);
+                // upsample each STFT channel n16 -> 3*n16 @48k
+                const int32_t cap = static_cast<int32_t>(mUp48.size()) / mUpmix.inChannels();
+                for (int32_t c = 0; c < mUpmix.inChannels(); ++c) {
+                    upFrames = mUpBank[c].process(stftOut[c], n16, mUp48Ptr[c], cap);
+                    stftOut[c] = mUp48Ptr[c];
+                }
+            }
+
+            // route to the output channels (pass-through rows are not copied),
+            // interleave and write to out ring
+            mUpmix.apply(stftOut, upFrames, mOut48Ptr.data(), mOutMixedPtr.data());
+            chmix::interleave(mOutMixedPtr.data(), mUpmix.outChannels(), upFrames, mTmpOut.data());
+            TRACE_SPAN("outRing.write");
+            int32_t wr = mOutRing.writeInterleaved(mTmpOut.data(), upFrames);
+            if (wr < upFrames) mOverflows.add(upFrames - wr);
         }
+        hops = std::min(queued16() / hop, StftProcessor::kMaxBatchHops);
+    }
+}
+
+void FullDuplexEngine::stftThreadFunc() {
+    {
+        rt::ThreadReport report;
+        (void)rt::setupCurrentThread(mThreadConfig, &report);
+        LOGI("FullDuplexEngine STFT worker: %s", report.describe().c_str());
+        tracing::setThreadName("fde.stft");
+    }
+    while (mRunning.load(std::memory_order_acquire)) {
+        timespec deadline{};
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += 10 * 1000 * 1000; // 10ms, so stop() is never missed
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        if (sem_timedwait(&mStftWake, &deadline) != 0) continue; // ETIMEDOUT / EINTR
+
+        const int64_t woke = monotonicNanos();
+        const int64_t enq = mLastEnqueueNs.load(std::memory_order_acquire);
+        if (enq > 0) mHandoffNs.record(woke - enq);
+
+        drainStftHops();
+    }
+}
+
+int32_t FullDuplexEngine::trimOutput(float* out, int32_t drop, int32_t numFrames) {
+    TRACE_SPAN("trim");
+    const int32_t ch = mOut->channelCount();
+    const int32_t xf = std::min(kTrimCrossfadeFrames, numFrames);
+    drop = std::min(drop, static_cast<int32_t>(mTrimBuf.size() / ch) - xf);
+    const int32_t got = mOutRing.readInterleaved(mTrimBuf.data(), drop + xf);
+    if (got <= drop) return 0; // frames are gone either way; the caller reads on
+
+    // Silent stretch (below -60 dBFS): drop it and continue from what follows.
+    // Otherwise fade the oldest frames out against the same number after the gap.
+    constexpr float kSilence = 1e-3f;
+    float peak = 0.0f;
+    for (int32_t i = 0; i < got * ch; ++i) peak = std::max(peak, std::fabs(mTrimBuf[i]));
+    const int32_t n = got - drop;
+    const float* tail = mTrimBuf.data() + static_cast<size_t>(drop) * ch;
+    if (peak < kSilence) {
+        std::memcpy(out, tail, static_cast<size_t>(n) * ch * sizeof(float));
+        mSilentTrims.fetch_add(1, std::memory_order_relaxed);
+        return n;
+    }
+    for (int32_t i = 0; i < n; ++i) {
+        const float g = (static_cast<float>(i) + 0.5f) / static_cast<float>(n);
+        for (int32_t c = 0; c < ch; ++c) {
+            const size_t k = static_cast<size_t>(i) * ch + c;
+            out[k] = mTrimBuf[k] * (1.0f - g) + tail[k] * g;
+        }
+    }
+    return n;
+}
+
+void FullDuplexEngine::fadeInOutput(float* out, int32_t numFrames) {
+    const int32_t ch = mOut->channelCount();
+    for (int32_t i = 0; i < numFrames && mFadeInLeft > 0; ++i, --mFadeInLeft) {
+        const float g = (static_cast<float>(kTrimCrossfadeFrames - mFadeInLeft) + 0.5f) /
+                        static_cast<float>(kTrimCrossfadeFrames);
+        for (int32_t c = 0; c < ch; ++c) out[static_cast<size_t>(i) * ch + c] *= g;
     }
 }
 
 int32_t FullDuplexEngine::pullTo(float* out, int32_t numFrames) {
+    TRACE_SPAN("outRing.read");
     int32_t total = 0;
+    const bool warming = mWarmupFramesLeft > 0;
+    if (warming) mWarmupFramesLeft -= numFrames;
+    const int32_t fill = mOutRing.availableToRead();
+    mOutRingFill.record(fill);
+    tracing::counter("outRing.fill", fill);
+    if (mAdaptiveLatency) {
+        const int32_t drop = mLatency.onPull(fill, numFrames);
+        if (drop > 0) total = trimOutput(out, drop, numFrames);
+        if (drop < 0) {
+            // Raised target: silence now, the ring deepens by as much
+            total = -drop;
+            std::memset(out, 0, static_cast<size_t>(total) * mOut->channelCount() * sizeof(float));
+            mFadeInLeft = kTrimCrossfadeFrames;
+        }
+        mAchievedLatency.set(achievedLatencyFrames());
+    }
+    const int32_t readFrom = total;
     while (total < numFrames) {
-        int32_t got = mOutRing.readInterleaved(out + (static_cast<size_t>(total) * mOut->getChannelCount()),
+        int32_t got = mOutRing.readInterleaved(out + (static_cast<size_t>(total) * mOut->channelCount()),
                                                numFrames - total);
         if (got <= 0) break;
         total += got;
     }
+    if (mFadeInLeft > 0 && total > readFrom) {
+        fadeInOutput(out + static_cast<size_t>(readFrom) * mOut->channelCount(), total - readFrom);
+    }
     if (total < numFrames) {
         // Underflow: zero-fill the rest so we never hand garbage to the device
-        const int32_t ch = mOut->getChannelCount();
+        const int32_t ch = mOut->channelCount();
         std::memset(out + static_cast<size_t>(total) * ch, 0,
                     static_cast<size_t>(numFrames - total) * ch * sizeof(float));
-        // During warm-up (first ~300 ms after start), do not count underflows
-        auto now = std::chrono::steady_clock::now();
-        bool warming = (now - mStartTime) < std::chrono::milliseconds(300);
+        // During warm-up (first ~300 ms of playback), do not count underflows
         if (!warming) {
-            mUnderflows.fetch_add((numFrames - total));
+            mUnderflows.add(numFrames - total);
+            mUnderflowBurst.record(numFrames - total);
         }
     }
     return numFrames; // we always fill the buffer handed to the callback
@@ -1,81 +1,309 @@
 #pragma once
+#include <algorithm>
 #include <memory>
+#include <string>
 #include <thread>
 #include <atomic>
 #include <vector>
-#include <oboe/Oboe.h>
+#include "AudioPort.h"
 #include "RingBuffer.h"
 #include "Resampler3x.h"
 #include <chrono>
+#include <semaphore.h>
 #include "StftProcessor.h"
+#include "NeuralMaskProcessor.h"
+#include "LogMelProcessor.h"
+#include "RtThread.h"
+#include "LatencyController.h"
+#include "ChannelMixer.h"
+#include "Metrics.h"
 
 class FullDuplexEngine {
 public:
     FullDuplexEngine() = default;
     ~FullDuplexEngine() { stop(); }
 
-    void setSharedInputStream(const std::shared_ptr<oboe::AudioStream>& in)  { mIn = in; }
-    void setSharedOutputStream(const std::shared_ptr<oboe::AudioStream>& out){ mOut = out; }
+    // The device, through audio::Stream (OboeStreamPort on Android, the
+    // adapters of HostAudioPort.h elsewhere)
+    void setSharedInputStream(const std::shared_ptr<audio::Stream>& in)  { mIn = in; }
+    void setSharedOutputStream(const std::shared_ptr<audio::Stream>& out){ mOut = out; }
 
     bool start();
     void stop();
 
-    // Called from Oboe playback callback to pull audio for output
+    // Pipelined mode (call before start()): the STFT, spectral processors and
+    // upsampler run on a dedicated worker thread. The io thread hands 16 kHz
+    // mono over through mMid16kMono and the worker feeds mOutRing, so capture
+    // and processing overlap. depthHops bounds how many hops may be queued for
+    // the worker; excess input is dropped and counted as overflow.
+    void setPipelined(bool enabled, int depthHops = 4) {
+        mPipelined = enabled;
+        mPipelineDepthHops = std::max(1, depthHops);
+    }
+    bool isPipelined() const { return mPipelined; }
+
+    // Scheduling, affinity, denormal and stack setup for the io thread and the
+    // STFT worker (call before start()). Defaults: SCHED_FIFO, falling back to
+    // SCHED_RR, then nice -18; the policy obtained is logged per thread.
+    void setThreadConfig(const rt::ThreadConfig& cfg) { mThreadConfig = cfg; }
+    const rt::ThreadConfig& threadConfig() const { return mThreadConfig; }
+
+    // How audio moves between the device and the DSP chain (call before start()).
+    // Threaded: an io thread does blocking input reads into mInRing and the
+    //           playback callback pulls from mOutRing (pullTo).
+    // Callback: everything runs inside the output data callback, called by
+    //           the audio::DuplexDriver set with setDuplexDriver() (on Android
+    //           OboeDuplexDriver, an oboe::FullDuplexStream): no io thread and
+    //           no input ring; mOutRing only carries the part of a hop that
+    //           does not fit the current buffer, on the same thread.
+    //           Pipelined mode is ignored.
+    enum class IoMode { Threaded, Callback };
+    void setIoMode(IoMode mode) { mIoMode = mode; }
+    IoMode ioMode() const { return mIoMode; }
+
+    // Callback mode: drives both streams; start() fails without one.
+    void setDuplexDriver(const std::shared_ptr<audio::DuplexDriver>& driver) { mDriver = driver; }
+
+    // Rate the STFT runs at (call before start()).
+    // Resampled16k: decimate 48k -> 16k, 512-point STFT (hop 96), interpolate back.
+    // Native:       STFT directly at the device rate (2048-point FFT over a
+    //               1536-sample frame, hop 288), no time-domain resampling and the
+    //               full band; spectral processors that declare maxFrequencyHz()
+    //               only get (and cost) the bins they need.
+    enum class StftRate { Resampled16k, Native };
+    void setStftRate(StftRate rate) { mStftRate = rate; }
+    StftRate stftRate() const { return mStftRate; }
+
+    // Derive the STFT hop from the device burst (call before start()): hop =
+    // burst/3 at 16 kHz, hop = burst natively, when that divides evenly and
+    // leaves at least 50% overlap; otherwise the default hop is kept. Each
+    // burst then completes exactly one hop, output leaves in burst-sized
+    // pieces and the output ring needs far less priming. On by default.
+    void setBurstAlignedHop(bool enabled) { mBurstAlignedHop = enabled; }
+
+    // End-to-end algorithmic latency of the processing path in device frames
+    // (STFT delay, plus the resampler pair in Resampled16k mode). Excludes the
+    // ring buffer priming and device buffers. Valid after start().
+    int32_t algorithmicLatencyFrames() const;
+    // Silence queued ahead of the first output at start(). In callback mode
+    // it is never trimmed, so the end-to-end delay is this plus the above.
+    int32_t primedFrames() const { return mPrimedFrames; }
+
+    // Low-delay STFT windows (asymmetric analysis/synthesis). Call before start().
+    void setLowLatencyStft(bool enabled) {
+        mStft.setWindowMode(enabled ? StftProcessor::WindowMode::LowDelay
+                                    : StftProcessor::WindowMode::Symmetric);
+    }
+
+    // True-stereo STFT (L/R packed into one complex FFT) instead of the mono
+    // downmix duplicated to both outputs. Call before start().
+    void setStereoStft(bool enabled) { mStereoStft = enabled; }
+
+    // Channel routing around the STFT (call before start()). Input and output
+    // streams may have any channel counts, independent of each other. The
+    // downmix takes the input channels to the STFT channels (1, or 2 with
+    // setStereoStft) and the upmix takes those to the output channels.
+    // Defaults are chmix::MixMatrix::standard(); a matrix whose shape does
+    // not match the streams at start() makes start() fail.
+    void setDownmixMatrix(const chmix::MixMatrix& m) { mDownmix = m; mCustomDownmix = true; }
+    void setUpmixMatrix(const chmix::MixMatrix& m)   { mUpmix = m; mCustomUpmix = true; }
+
+    // Attach a spectral effect to the STFT (call before start()).
+    bool addSpectralProcessor(SpectralProcessor* p) { return mStft.addSpectralProcessor(p); }
+    bool removeSpectralProcessor(SpectralProcessor* p) { return mStft.removeSpectralProcessor(p); }
+
+    // Load a mask-estimation model (NeuralNet weight file) and run it on every
+    // STFT hop with a hard per-hop budget (0 = none). With 'quantized' the
+    // matrices run on the int8 kernel picked at start(). Call before start().
+    bool loadMaskModel(const std::string& path, int32_t budgetMicros = 2000,
+                       bool quantized = true) {
+        if (!mMask.load(path)) return false;
+        mMask.setBudgetMicros(budgetMicros);
+        mMaskQuantized = quantized;
+        (void)mStft.removeSpectralProcessor(&mMask);
+        return mStft.addSpectralProcessor(&mMask);
+    }
+
+    // Log-mel features of every STFT hop (after the mask, if one is loaded),
+    // one frame of numMels floats per hop in logMelFeatures()->features().
+    // The filterbank is built for the STFT geometry at start(). Call before
+    // start(); logMelFeatures() is nullptr while disabled.
+    void setLogMelFeatures(bool enabled, const LogMelProcessor::Config& cfg = LogMelProcessor::Config()) {
+        mLogMelEnabled = enabled;
+        mLogMelConfig = cfg;
+    }
+    LogMelProcessor* logMelFeatures() { return mLogMelEnabled ? &mLogMel : nullptr; }
+
+    // Output depth in threaded mode. The output ring starts with the least
+    // priming that covers one hop and a LatencyController adapts from there:
+    // underflows raise the kept depth, depth that stays unused is removed, by
+    // dropping frames when they are silent or with a short crossfade otherwise.
+    // The target is the depth never trimmed below (0 = as low as the measured
+    // jitter allows); it may be changed while running. Lowering it lets the
+    // trimming go further; raising it plays the missing depth as silence once
+    // and fades back in.
+    void setTargetLatencyFrames(int32_t frames) {
+        frames = std::max(0, frames);
+        mTargetLatencyFrames.store(frames, std::memory_order_relaxed);
+        mLatency.setTargetFrames(frames);
+    }
+    int32_t targetLatencyFrames() const { return mTargetLatencyFrames.load(std::memory_order_relaxed); }
+    // Mean output ring depth at the playback callback over the last window
+    int32_t bufferedLatencyFrames() const { return mLatency.bufferedFrames(); }
+    // Algorithmic latency plus the buffered depth (device buffers excluded)
+    int32_t achievedLatencyFrames() const { return algorithmicLatencyFrames() + bufferedLatencyFrames(); }
+
+    // Called from the playback callback to pull audio for output (threaded mode)
     int32_t pullTo(float* out, int32_t numFrames);
 
 private:
+    // Callback mode: what the duplex driver calls, running this engine's chain
+    class CallbackPass : public audio::DuplexCallback {
+    public:
+        explicit CallbackPass(FullDuplexEngine& engine) : mEngine(engine) {}
+        void onDuplex(const float* in, int32_t numIn, float* out, int32_t numOut) override {
+            mEngine.processDuplex(in, numIn, out, numOut);
+        }
+    private:
+        FullDuplexEngine& mEngine;
+    };
+
     void ioThreadFunc();
+    void stftThreadFunc();
+
+    // One block of interleaved device input (<= framesPerBurst, a multiple of
+    // the decimation factor): deinterleave, downsample, mix, queue for the STFT.
+    void captureBlock(const float* inter, int32_t frames);
+
+    // Callback mode: capture numIn frames (plus any input earlier short reads
+    // left on the device), run the STFT, fill numOut frames.
+    void processDuplex(const float* in, int32_t numIn, float* out, int32_t numOut);
+    void captureCallbackInput(const float* in, int32_t numIn);
+
+    // Periodic stats (io thread), and the summary at stop()
+    void logStats();
+
+    // Removes 'drop' frames from the front of mOutRing and writes the first
+    // frames of this callback to out; returns how many were written.
+    int32_t trimOutput(float* out, int32_t drop, int32_t numFrames);
+    // Ramps the first mFadeInLeft frames of out up from silence
+    void fadeInOutput(float* out, int32_t numFrames);
+
+    // STFT + upsample + mOutRing write for every whole hop queued at the STFT rate.
+    void drainStftHops();
 
-    std::shared_ptr<oboe::AudioStream> mIn;
-    std::shared_ptr<oboe::AudioStream> mOut;
+    // Frames queued for the STFT (mono ring, or the L/R pair in stereo mode)
+    int32_t queued16() const {
+        return mStereoStft ? std::min(mMid16kL.availableToRead(), mMid16kR.availableToRead())
+                           : mMid16kMono.availableToRead();
+    }
 
-    RingBuffer mInRing;      // 48k stereo input queue
-    RingBuffer mOutRing;     // 48k stereo output queue
+    std::shared_ptr<audio::Stream> mIn;
+    std::shared_ptr<audio::Stream> mOut;
 
-    // NEW: mid-rate mono rings per channel (16 kHz)
+    RingBuffer mInRing;      // 48k input queue, input channel count
+    RingBuffer mOutRing;     // 48k output queue, output channel count
+
+    // Mid-rate mono rings per channel (16 kHz, or the device rate in
+    // Native mode); STFT input in stereo mode
     RingBuffer mMid16kL;
     RingBuffer mMid16kR;
 
-    // NEW: resamplers
-    Resampler3x mDownL{Resampler3x::Mode::DownBy3};
-    Resampler3x mDownR{Resampler3x::Mode::DownBy3};
-    Resampler3x mUpL  {Resampler3x::Mode::UpBy3};
-    Resampler3x mUpR  {Resampler3x::Mode::UpBy3};
-
-    // NEW step 3: mono 16 kHz ring and buffers
+    // Mono 16 kHz ring (device rate in Native mode)
     RingBuffer mMid16kMono;        // 16 kHz mono queue
 
-    std::vector<float> mMono16;    // mixed L/R -> mono @16k for current chunk (size fpb/3)
-    std::vector<float> mBlkMono16; // temp pull from mono ring @16k (size fpb/3)
-    std::vector<float> mUp48Mono;  // upsampled mono @48k (size fpb)
-    Resampler3x mUpMono{Resampler3x::Mode::UpBy3};
+    // Channel routing and one resampler per STFT channel each way
+    chmix::MixMatrix mDownmix;     // input channels -> STFT channels
+    chmix::MixMatrix mUpmix;       // STFT channels -> output channels
+    bool mCustomDownmix = false;
+    bool mCustomUpmix = false;
+    std::vector<Resampler3x> mDownBank;
+    std::vector<Resampler3x> mUpBank;
 
     std::thread mThread;
     std::atomic<bool> mRunning{false};
 
+    rt::ThreadConfig mThreadConfig;
+    IoMode mIoMode = IoMode::Threaded;
+    bool   mCbThreadReady = false;  // callback mode: FTZ set on the callback thread
+    std::shared_ptr<audio::DuplexDriver> mDriver;
+    CallbackPass mPass{*this};
+    bool   mDriverStarted = false;
+    int32_t mCbTailFrames = 0;   // input frames (< decimation factor) held for the next callback
+    int32_t mCbInputOwed = 0;    // input frames short callbacks did not get, read back when available
+    static constexpr int32_t kMaxOwedBursts = 8;  // beyond a device buffer they are lost anyway
+
+    // Pipelined mode: STFT worker thread woken by the io thread
+    bool mPipelined = false;       // as requested; kept across starts
+    bool mPipelineActive = false;  // this run: mPipelined outside callback mode
+    int  mPipelineDepthHops = 4;
+    std::thread mStftThread;
+    sem_t mStftWake{};
+    bool  mStftWakeInit = false;
+    std::atomic<int64_t> mLastEnqueueNs{0};
+
     // Scratch buffers sized to framesPerBurst * channels (resized on start)
     std::vector<float> mTmpIn;      // interleaved @48k, size fpb*ch
     std::vector<float> mTmpXfer;    // interleaved @48k, size fpb*ch
-    std::vector<float> mL48, mR48;  // deinterleaved @48k, size fpb
-    std::vector<float> mL16, mR16;  // @16k, size fpb/3
-    std::vector<float> mL48b, mR48b;// upsampled back to @48k, size fpb
-    std::vector<float> mTmpOut;     // interleaved @48k, size fpb*ch
-    // NEW: steady 16k chunk buffers (no allocs in loop)
-    std::vector<float> mBlkL16; // reused 16k chunk (left or mono)
-    std::vector<float> mBlkR16; // reused 16k chunk (right)
-
-    // STFT processor @16k mono
+    std::vector<float> mTmpOut;     // interleaved @48k, size up48Cap*outCh
+    // Planar scratch, one plane per channel; the pointer arrays index into them
+    std::vector<float> mIn48;       // input channels @48k, fpb each
+    std::vector<float> mMix48;      // downmixed STFT channels @48k, fpb each
+    std::vector<float> mMid;        // STFT channels @16k, fpb/3 each
+    std::vector<float> mUp48;       // STFT channels back @48k, up48Cap each
+    std::vector<float> mOut48;      // upmixed output channels @48k, up48Cap each
+    std::vector<float*>       mIn48Ptr, mMix48Ptr, mUp48Ptr, mOut48Ptr;
+    std::vector<const float*> mMixedPtr, mOutMixedPtr;
+
+    // STFT processor @16k (or @device rate in Native mode)
     StftProcessor mStft;
-// 16k hop buffers (exactly one hop = 96)
-    std::vector<float> mHopIn16;   // size 96
-    std::vector<float> mHopOut16;  // size 96
+    StftRate      mStftRate = StftRate::Resampled16k;
+    bool          mBurstAlignedHop = true;
+// hop buffers at the STFT rate (one hop = 96 @16k / 288 native, or burst-aligned)
+    std::vector<float> mHopIn16;   // size hop * kMaxBatchHops (mono or left)
+    std::vector<float> mHopOut16;  // size hop * kMaxBatchHops
+    std::vector<float> mHopIn16R;  // right channel, stereo STFT only
+    std::vector<float> mHopOut16R;
+    bool mStereoStft = false;
+    NeuralMaskProcessor mMask;     // attached only once a model is loaded
+    bool mMaskQuantized = true;
+    LogMelProcessor mLogMel;       // attached at start() when enabled, last in the chain
+    LogMelProcessor::Config mLogMelConfig;
+    bool mLogMelEnabled = false;
+
+    // Output depth control (threaded mode)
+    static constexpr int32_t kTrimCrossfadeFrames = 64;
+    LatencyController  mLatency;
+    bool               mAdaptiveLatency = false;
+    std::atomic<int32_t> mTargetLatencyFrames{0};  // set from the UI thread while running
+    int32_t            mPrimedFrames = 0;
+    std::vector<float> mTrimBuf;    // (maxTrimFrames + kTrimCrossfadeFrames) * ch
+    std::atomic<uint64_t> mSilentTrims{0};
+    int32_t            mFadeInLeft = 0; // ring audio resuming after padded silence
 
-    // For simple stats (optional)
-    std::atomic<int64_t> mUnderflows{0};
-    std::atomic<int64_t> mOverflows{0};
+    // Process-wide metrics (cumulative across engine restarts), updated on
+    // the audio threads; the stats log and dumpMetrics read them
+    metrics::Counter&   mUnderflows = metrics::registry().counter("engine.underflow_frames");
+    metrics::Counter&   mOverflows  = metrics::registry().counter("engine.overflow_frames");
+    metrics::Histogram& mUnderflowBurst = metrics::registry().histogram(
+            "engine.underflow_burst_frames", {1, 16, 48, 96, 192, 480, 960});
+    metrics::Histogram& mOutRingFill = metrics::registry().histogram(
+            "engine.out_ring_fill_frames", {0, 96, 192, 384, 768, 1536, 3072, 6144});
+    // Stage times in ns: capture per block (deinterleave, downsample, mix,
+    // enqueue), enqueue -> STFT worker wake-up (pipelined only), and one STFT
+    // drain (STFT, upsample, out ring write)
+    metrics::Histogram& mCaptureNs = metrics::registry().histogram(
+            "engine.capture_ns", {2000, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000});
+    metrics::Histogram& mHandoffNs = metrics::registry().histogram(
+            "engine.handoff_ns", {2000, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000});
+    metrics::Histogram& mStftNs = metrics::registry().histogram(
+            "engine.stft_ns", {2000, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000});
+    metrics::Gauge&     mAchievedLatency = metrics::registry().gauge("engine.achieved_latency_frames");
     // Debug: STFT counters snapshot for logging
     uint64_t mDbgLastHops{0};
     uint64_t mDbgLastPushed{0};
     uint64_t mDbgLastPopped{0};
-    std::chrono::steady_clock::time_point mStartTime{};
+    struct StageMark { uint64_t count = 0; int64_t sumNs = 0; };
+    StageMark mDbgLastCapture, mDbgLastHandoff, mDbgLastStft;
+    int64_t  mWarmupFramesLeft{0};  // playback frames before underflows count
 };
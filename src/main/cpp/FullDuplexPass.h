@@ -17,8 +17,21 @@
 #ifndef SAMPLES_FULLDUPLEXPASS_H
 #define SAMPLES_FULLDUPLEXPASS_H
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <oboe/Oboe.h>
+
 class FullDuplexPass : public oboe::FullDuplexStream {
 public:
+    // oboe::FullDuplexStream reads up to one output callback of input frames
+    // into a scratch buffer it sizes from the output stream (capacity x
+    // output channels), so the input must not have more channels than the
+    // output. Callers check this before start().
+    static bool inputFitsScratch(const oboe::AudioStream& in, const oboe::AudioStream& out) {
+        return in.getChannelCount() <= out.getChannelCount();
+    }
+
     virtual oboe::DataCallbackResult
     onBothStreamsReady(
             const void *inputData,
@@ -26,15 +39,28 @@ public:
             void *outputData,
             int   numOutputFrames) {
         // Copy the input samples to the output with a little arbitrary gain change.
+        assertInputFits(numInputFrames, numOutputFrames);
 
         // This code assumes the data format for both streams is Float.
         const float *inputFloats = static_cast<const float *>(inputData);
         float *outputFloats = static_cast<float *>(outputData);
 
-        // It also assumes the channel count for each stream is the same.
-        int32_t samplesPerFrame = getOutputStream()->getChannelCount();
+        // Channels are copied one to one; input frames are read with their own count.
+        int32_t inChannels = getInputStream()->getChannelCount();
+        int32_t outChannels = getOutputStream()->getChannelCount();
+        int32_t samplesPerFrame = std::min(inChannels, outChannels);
         int32_t numInputSamples = numInputFrames * samplesPerFrame;
         int32_t numOutputSamples = numOutputFrames * samplesPerFrame;
+        if (inChannels != outChannels) {
+            for (int32_t i = 0; i < numOutputFrames; i++) {
+                for (int32_t c = 0; c < outChannels; c++) {
+                    outputFloats[i * outChannels + c] =
+                            (i < numInputFrames && c < inChannels) ? inputFloats[i * inChannels + c] * 0.95f
+                                                                   : 0.0f;
+                }
+            }
+            return oboe::DataCallbackResult::Continue;
+        }
 
         // It is possible that there may be fewer input than output samples.
         int32_t samplesToProcess = std::min(numInputSamples, numOutputSamples);
@@ -50,5 +76,14 @@ public:
 
         return oboe::DataCallbackResult::Continue;
     }
+
+protected:
+    // The scratch buffer bound above, for every onBothStreamsReady()
+    void assertInputFits(int numInputFrames, int numOutputFrames) {
+        assert(inputFitsScratch(*getInputStream(), *getOutputStream()));
+        assert(numInputFrames <= numOutputFrames);
+        (void)numInputFrames;
+        (void)numOutputFrames;
+    }
 };
 #endif //SAMPLES_FULLDUPLEXPASS_H
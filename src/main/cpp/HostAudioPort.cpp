@@ -0,0 +1,52 @@
+// HostAudioPort.cpp
+#include "HostAudioPort.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace audio {
+
+MemoryInputStream::MemoryInputStream(std::vector<float> samples, int32_t channels, int32_t sampleRate,
+                                     int32_t framesPerBurst, bool realTime)
+        : mSamples(std::move(samples)), mChannels(std::max(1, channels)),
+          mSampleRate(std::max(1, sampleRate)), mFramesPerBurst(std::max(1, framesPerBurst)),
+          mRealTime(realTime), mTotalFrames(static_cast<int64_t>(mSamples.size()) / mChannels) {}
+
+bool MemoryInputStream::requestStart() {
+    mStart = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool MemoryInputStream::requestStop() {
+    return true;
+}
+
+int32_t MemoryInputStream::read(float* data, int32_t frames, int64_t timeoutNanos) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(timeoutNanos);
+    const int64_t pos = mPos.load(std::memory_order_relaxed);
+    int64_t n = std::min<int64_t>(frames, mTotalFrames - pos);
+    if (n <= 0) {
+        std::this_thread::sleep_until(deadline);
+        return 0;
+    }
+    if (mRealTime) {
+        // A burst becomes readable once the device clock passes its end
+        const int64_t first = std::min<int64_t>(n, mFramesPerBurst);
+        const auto due = mStart + std::chrono::nanoseconds((pos + first) * 1000000000LL / mSampleRate);
+        if (due > deadline) {
+            std::this_thread::sleep_until(deadline);
+            return 0;
+        }
+        std::this_thread::sleep_until(due);
+        // Late reader: hand over every whole burst captured by now
+        const int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - mStart).count();
+        const int64_t captured = elapsed * mSampleRate / 1000000000LL - pos;
+        n = std::max(first, std::min(n, captured / mFramesPerBurst * mFramesPerBurst));
+    }
+    std::memcpy(data, mSamples.data() + pos * mChannels, static_cast<size_t>(n) * mChannels * sizeof(float));
+    mPos.store(pos + n, std::memory_order_release);
+    return static_cast<int32_t>(n);
+}
+
+} // namespace audio
@@ -0,0 +1,91 @@
+// HostAudioPort.h
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include "AudioPort.h"
+
+/**
+ * audio::Stream / audio::DuplexDriver adapters for host builds, where there
+ * is no audio device: enough to run FullDuplexEngine in either io mode from
+ * a buffer, e.g. a decoded file.
+ */
+namespace audio {
+
+// Input stream that delivers a fixed interleaved buffer once. With realTime
+// the reads are paced by the steady clock from requestStart(), as a device
+// would deliver them; otherwise each read returns at once. After the end,
+// reads wait out their timeout and return 0, like a stalled device.
+class MemoryInputStream : public Stream {
+public:
+    MemoryInputStream(std::vector<float> samples, int32_t channels, int32_t sampleRate,
+                      int32_t framesPerBurst, bool realTime = true);
+
+    int32_t channelCount() const override { return mChannels; }
+    int32_t sampleRate() const override { return mSampleRate; }
+    int32_t framesPerBurst() const override { return mFramesPerBurst; }
+
+    bool requestStart() override;
+    bool requestStop() override;
+    int32_t read(float* data, int32_t frames, int64_t timeoutNanos) override;
+
+    int64_t totalFrames() const { return mTotalFrames; }
+    int64_t framesRead() const { return mPos.load(std::memory_order_acquire); }
+    bool    finished() const { return framesRead() >= mTotalFrames; }
+
+private:
+    std::vector<float> mSamples;
+    int32_t mChannels;
+    int32_t mSampleRate;
+    int32_t mFramesPerBurst;
+    bool    mRealTime;
+    int64_t mTotalFrames;
+    std::atomic<int64_t> mPos{0};
+    std::chrono::steady_clock::time_point mStart{};
+};
+
+// Output side with a format and nothing else: the caller plays the device
+// by calling FullDuplexEngine::pullTo() (threaded mode) or
+// ManualDuplexDriver::process() (callback mode) itself.
+class NullOutputStream : public Stream {
+public:
+    NullOutputStream(int32_t channels, int32_t sampleRate, int32_t framesPerBurst)
+            : mChannels(channels), mSampleRate(sampleRate), mFramesPerBurst(framesPerBurst) {}
+
+    int32_t channelCount() const override { return mChannels; }
+    int32_t sampleRate() const override { return mSampleRate; }
+    int32_t framesPerBurst() const override { return mFramesPerBurst; }
+
+    bool requestStart() override { return true; }
+    bool requestStop() override { return true; }
+    int32_t read(float*, int32_t, int64_t) override { return -1; }
+
+private:
+    int32_t mChannels;
+    int32_t mSampleRate;
+    int32_t mFramesPerBurst;
+};
+
+// Callback mode without a device: process() hands one output buffer and the
+// input captured for it to the callback, on the caller's thread.
+class ManualDuplexDriver : public DuplexDriver {
+public:
+    bool start(DuplexCallback* callback) override {
+        mCallback.store(callback, std::memory_order_release);
+        return callback != nullptr;
+    }
+    void stop() override { mCallback.store(nullptr, std::memory_order_release); }
+
+    // False (and out untouched) while not started
+    bool process(const float* in, int32_t numIn, float* out, int32_t numOut) {
+        DuplexCallback* cb = mCallback.load(std::memory_order_acquire);
+        if (cb == nullptr) return false;
+        cb->onDuplex(in, numIn, out, numOut);
+        return true;
+    }
+
+private:
+    std::atomic<DuplexCallback*> mCallback{nullptr};
+};
+
+} // namespace audio
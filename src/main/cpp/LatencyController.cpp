@@ -0,0 +1,85 @@
+// LatencyController.cpp
+#include "LatencyController.h"
+#include <climits>
+
+void LatencyController::configure(const Config& cfg) {
+    mCfg = cfg;
+    mCfg.burstFrames  = std::max(1, cfg.burstFrames);
+    mCfg.windowFrames = std::max(mCfg.burstFrames, cfg.windowFrames);
+    setTargetFrames(cfg.targetFrames);
+    reset();
+}
+
+void LatencyController::restartWindow() {
+    mWinConsumed  = 0;
+    mWinMinFill   = INT32_MAX;
+    mWinFillSum   = 0;
+    mWinCalls     = 0;
+    mWinMaxPull   = 0;
+    mWinUnderflow = false;
+}
+
+void LatencyController::reset() {
+    restartWindow();
+    mCleanWindows = 0;
+    mAppliedTarget = targetFrames(); // the priming at start covers it
+    mGrowLeft = 0;
+    mMargin.store(0, std::memory_order_relaxed);
+    mBuffered.store(0, std::memory_order_relaxed);
+    mTrims.store(0, std::memory_order_relaxed);
+    mTrimmedFrames.store(0, std::memory_order_relaxed);
+    mPaddedFrames.store(0, std::memory_order_relaxed);
+}
+
+int32_t LatencyController::onPull(int32_t fill, int32_t numFrames) {
+    // A raised target: play silence until the ring holds it
+    const int32_t target = targetFrames();
+    if (target > mAppliedTarget) mGrowLeft = std::max(mGrowLeft, target - fill);
+    mAppliedTarget = target;
+    if (mGrowLeft > 0) {
+        const int32_t pad = std::min(mGrowLeft, numFrames);
+        mGrowLeft -= pad;
+        mPaddedFrames.fetch_add(static_cast<uint64_t>(pad), std::memory_order_relaxed);
+        restartWindow(); // the fill seen so far predates the new depth
+        return -pad;
+    }
+
+    mWinMinFill = std::min(mWinMinFill, fill);
+    mWinFillSum += fill;
+    ++mWinCalls;
+    mWinMaxPull = std::max(mWinMaxPull, numFrames);
+    mWinConsumed += numFrames;
+    if (fill < numFrames) mWinUnderflow = true;
+    if (mWinConsumed < mCfg.windowFrames) return 0;
+
+    // End of window: adapt the margin, then trim whatever was never needed
+    const int32_t burst = mCfg.burstFrames;
+    int32_t margin = mMargin.load(std::memory_order_relaxed);
+    if (mWinUnderflow) {
+        margin = std::min(mCfg.maxMarginFrames, margin + burst);
+        mCleanWindows = 0;
+    } else if (++mCleanWindows >= mCfg.cleanWindowsToShrink) {
+        margin = std::max(0, margin - burst);
+        mCleanWindows = 0;
+    }
+    mMargin.store(margin, std::memory_order_relaxed);
+    mBuffered.store(static_cast<int32_t>(mWinFillSum / std::max(1, mWinCalls)), std::memory_order_relaxed);
+
+    int32_t trim = 0;
+    if (!mWinUnderflow) {
+        const int32_t keep = std::max(targetFrames(), mWinMaxPull + margin);
+        // Half a burst of hysteresis so the depth does not oscillate
+        if (mWinMinFill > keep + burst / 2) {
+            trim = std::min(mWinMinFill - keep, mCfg.maxTrimFrames);
+            // Only what is readable now beyond this callback's own frames
+            trim = std::max(0, std::min(trim, fill - numFrames));
+        }
+    }
+    if (trim > 0) {
+        mTrims.fetch_add(1, std::memory_order_relaxed);
+        mTrimmedFrames.fetch_add(static_cast<uint64_t>(trim), std::memory_order_relaxed);
+    }
+
+    restartWindow();
+    return trim;
+}
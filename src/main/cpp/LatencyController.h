@@ -0,0 +1,77 @@
+// LatencyController.h
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Output depth controller for the consumer side of mOutRing.
+ *
+ * Called once per output callback with the ring fill seen before reading.
+ * Over each window (about half a second of callbacks) it tracks the lowest
+ * and mean fill and whether the callback ran short:
+ *   - an underflow raises the safety margin by one burst (the frames that
+ *     arrive late then stay buffered instead of being trimmed back);
+ *   - cleanWindowsToShrink windows without underflow lower it by one burst;
+ *   - when the lowest fill of a window still exceeds what the callback needs
+ *     plus the margin (and at least the target), the excess is handed back
+ *     to the caller to remove, up to maxTrimFrames at a time.
+ * The caller decides how to remove frames (drop silence or crossfade).
+ *
+ * Raising the target while streaming deepens the ring: the shortfall
+ * (target minus the current fill) is handed back as silence to play instead
+ * of reading, over as many callbacks as it takes, while the producer keeps
+ * writing. Lowering it takes effect through the trimming above.
+ *
+ * onPull() runs on the audio thread; the atomics are for readers elsewhere.
+ */
+class LatencyController {
+public:
+    struct Config {
+        int32_t targetFrames = 0;         // never trim the lowest fill below this (see setTargetFrames)
+        int32_t burstFrames = 96;
+        int32_t windowFrames = 24000;     // frames consumed per decision window
+        int32_t maxMarginFrames = 16 * 96;
+        int32_t maxTrimFrames = 8 * 96;
+        int32_t cleanWindowsToShrink = 8;
+    };
+
+    void configure(const Config& cfg);
+    void reset();
+
+    // fill = frames readable before this callback reads numFrames. Returns
+    // > 0: frames to remove from the front of the ring now;
+    // < 0: frames of silence to play before reading (at most numFrames).
+    int32_t onPull(int32_t fill, int32_t numFrames);
+
+    // May be changed while streaming
+    void    setTargetFrames(int32_t frames) { mTarget.store(std::max(0, frames), std::memory_order_relaxed); }
+    int32_t targetFrames()   const { return mTarget.load(std::memory_order_relaxed); }
+    int32_t marginFrames()   const { return mMargin.load(std::memory_order_relaxed); }
+    // Mean ring fill at the consumer over the last complete window
+    int32_t bufferedFrames() const { return mBuffered.load(std::memory_order_relaxed); }
+    uint64_t trims()         const { return mTrims.load(std::memory_order_relaxed); }
+    uint64_t trimmedFrames() const { return mTrimmedFrames.load(std::memory_order_relaxed); }
+    uint64_t paddedFrames()  const { return mPaddedFrames.load(std::memory_order_relaxed); }
+
+private:
+    Config  mCfg;
+    // Current window
+    int32_t mWinConsumed = 0;
+    int32_t mWinMinFill = 0;
+    int64_t mWinFillSum = 0;
+    int32_t mWinCalls = 0;
+    int32_t mWinMaxPull = 0;
+    bool    mWinUnderflow = false;
+    int32_t mCleanWindows = 0;
+    int32_t mAppliedTarget = 0;   // target the depth was last grown to
+    int32_t mGrowLeft = 0;        // silence still to play for a raised target
+    void    restartWindow();
+
+    std::atomic<int32_t>  mTarget{0};
+    std::atomic<int32_t>  mMargin{0};
+    std::atomic<int32_t>  mBuffered{0};
+    std::atomic<uint64_t> mTrims{0};
+    std::atomic<uint64_t> mTrimmedFrames{0};
+    std::atomic<uint64_t> mPaddedFrames{0};
+};
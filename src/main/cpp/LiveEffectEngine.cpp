@@ -15,15 +15,15 @@
  */
 
 
-#include <cassert>
+#include <algorithm>
 #include <logging_macros.h>
 #include <cstring>
 #include "LiveEffectEngine.h"
 #include "FullDuplexEngine.h"
+#include "StageTimer.h"
 
 
 LiveEffectEngine::LiveEffectEngine() {
-    assert(mOutputChannelCount == mInputChannelCount);
 }
 
 void LiveEffectEngine::setRecordingDeviceId(int32_t deviceId) {
@@ -44,6 +44,55 @@ bool LiveEffectEngine::setAudioApi(oboe::AudioApi api) {
     return true;
 }
 
+bool LiveEffectEngine::setCallbackMode(bool enabled) {
+    if (enabled == mCallbackMode) return true;
+    if (enabled && mInputChannelCount > mOutputChannelCount) {
+        LOGE("Callback mode needs no more input than output channels (in=%d out=%d)",
+             mInputChannelCount, mOutputChannelCount);
+        return false;
+    }
+    mCallbackMode = enabled;
+    if (!mIsEffectOn) return true;
+    closeStreams();
+    const bool success = openStreams() == oboe::Result::OK;
+    mIsEffectOn = success;
+    return success;
+}
+
+void LiveEffectEngine::setTargetLatencyMillis(float millis) {
+    mTargetLatencyMillis = std::max(0.0f, millis);
+    if (mDuplexStream && mSampleRate > 0) {
+        mDuplexStream->setTargetLatencyFrames(
+                static_cast<int32_t>(mTargetLatencyMillis * mSampleRate / 1000.0f));
+    }
+}
+
+double LiveEffectEngine::getAchievedLatencyMillis() const {
+    if (!mDuplexStream || mSampleRate <= 0) return -1.0;
+    return 1000.0 * mDuplexStream->achievedLatencyFrames() / mSampleRate;
+}
+
+bool LiveEffectEngine::setChannelCounts(int32_t inputChannels, int32_t outputChannels) {
+    if (inputChannels < 1 || inputChannels > chmix::kMaxChannels ||
+        outputChannels < 1 || outputChannels > chmix::kMaxChannels) {
+        LOGE("Unsupported channel counts in=%d out=%d", inputChannels, outputChannels);
+        return false;
+    }
+    if (mCallbackMode && inputChannels > outputChannels) {
+        LOGE("Callback mode needs no more input than output channels (in=%d out=%d)",
+             inputChannels, outputChannels);
+        return false;
+    }
+    if (inputChannels == mInputChannelCount && outputChannels == mOutputChannelCount) return true;
+    mInputChannelCount = inputChannels;
+    mOutputChannelCount = outputChannels;
+    if (!mIsEffectOn) return true;
+    closeStreams();
+    const bool success = openStreams() == oboe::Result::OK;
+    mIsEffectOn = success;
+    return success;
+}
+
 bool LiveEffectEngine::setEffectOn(bool isOn) {
     bool success = true;
     if (isOn != mIsEffectOn) {
@@ -75,6 +124,7 @@ void LiveEffectEngine::closeStreams() {
     closeStream(mPlayStream);
     closeStream(mRecordingStream);
     mDuplexStream.reset();
+    mDuplexDriver.reset();
 }
 
 oboe::Result  LiveEffectEngine::openStreams() {
@@ -112,28 +162,29 @@ oboe::Result  LiveEffectEngine::openStreams() {
          mRecordingStream->getBufferCapacityInFrames());
     warnIfNotLowLatency(mRecordingStream);
 
-    // Defensive check: avoid duplex if channel counts do not match
-    if (mRecordingStream->getChannelCount() != mPlayStream->getChannelCount()) {
-        LOGE("I/O channel mismatch: in=%d, out=%d. Closing streams.",
-             mRecordingStream->getChannelCount(), mPlayStream->getChannelCount());
-        closeStream(mRecordingStream);
-        closeStream(mPlayStream);
-        return oboe::Result::ErrorInvalidFormat;
-    }
-
     LOGI("Input: ch=%d mask=%#x devId=%d",
          mRecordingStream->getChannelCount(),
          (int)mRecordingStream->getChannelMask(),
          mRecordingStream->getDeviceId());
 
     mDuplexStream = std::make_unique<FullDuplexEngine>();
-    mDuplexStream->setSharedInputStream(mRecordingStream);
-    mDuplexStream->setSharedOutputStream(mPlayStream);
+    mDuplexStream->setSharedInputStream(std::make_shared<OboeStreamPort>(mRecordingStream));
+    mDuplexStream->setSharedOutputStream(std::make_shared<OboeStreamPort>(mPlayStream));
+    mDuplexDriver = std::make_shared<OboeDuplexDriver>(mRecordingStream, mPlayStream);
+    mDuplexStream->setDuplexDriver(mDuplexDriver);
+    mDuplexStream->setIoMode(mCallbackMode ? FullDuplexEngine::IoMode::Callback
+                                           : FullDuplexEngine::IoMode::Threaded);
+    mDuplexStream->setTargetLatencyFrames(
+            static_cast<int32_t>(mTargetLatencyMillis * mSampleRate / 1000.0f));
+    if (!mMaskModelPath.empty() && !mDuplexStream->loadMaskModel(mMaskModelPath)) {
+        LOGW("Mask model %s not loaded, running without it", mMaskModelPath.c_str());
+    }
     if (!mDuplexStream->start()) {
         LOGE("FullDuplexEngine failed to start");
         closeStream(mRecordingStream);
         closeStream(mPlayStream);
         mDuplexStream.reset();
+        mDuplexDriver.reset();
         return oboe::Result::ErrorInternal;
     }
     return result;
@@ -152,9 +203,9 @@ oboe::AudioStreamBuilder *LiveEffectEngine::setupRecordingStreamParameters(
     // This sample uses blocking read() because we don't specify a callback
     builder->setDeviceId(mRecordingDeviceId)
         ->setDirection(oboe::Direction::Input)
-        // Match the output stream exactly: 48 kHz mono
+        // 48 kHz like the output; the channel count may differ from it
         ->setSampleRate(48000)
-        ->setChannelCount(2)
+        ->setChannelCount(mInputChannelCount)
         // Request an input preset appropriate for raw speech capture
         ->setInputPreset(oboe::InputPreset::Unprocessed);
     return setupCommonStreamParameters(builder);
@@ -172,9 +223,9 @@ oboe::AudioStreamBuilder *LiveEffectEngine::setupPlaybackStreamParameters(
         ->setErrorCallback(this)
         ->setDeviceId(mPlaybackDeviceId)
         ->setDirection(oboe::Direction::Output)
-        // Force low-latency friendly params: 48 kHz mono
+        // Force low-latency friendly params: 48 kHz
         ->setSampleRate(48000)
-        ->setChannelCount(2);
+        ->setChannelCount(mOutputChannelCount);
 
     return setupCommonStreamParameters(builder);
 }
@@ -235,8 +286,8 @@ void LiveEffectEngine::warnIfNotLowLatency(std::shared_ptr<oboe::AudioStream> &s
 }
 
 /**
- * Handles playback stream's audio request. In this sample, we simply block-read
- * from the record stream for the required samples.
+ * Handles playback stream's audio request. Threaded mode pulls what the io
+ * thread produced; callback mode reads the input and runs the whole chain here.
  *
  * @param oboeStream: the playback stream that requesting additional samples
  * @param audioData:  the buffer to load audio samples for playback stream
@@ -244,18 +295,22 @@ void LiveEffectEngine::warnIfNotLowLatency(std::shared_ptr<oboe::AudioStream> &s
  * @return: DataCallbackResult::Continue.
  */
 oboe::DataCallbackResult LiveEffectEngine::onAudioReady(
-        oboe::AudioStream* /*oboeStream*/, void* audioData, int32_t numFrames) {
+        oboe::AudioStream* oboeStream, void* audioData, int32_t numFrames) {
+    STAGE_TIMER(Callback);
+    metrics::ScopedNanos callbackTime(mCallbackNs);
     // Fill the output buffer by pulling from our FullDuplexEngine (blocking read under the hood).
-    if (mDuplexStream) {
+    if (mDuplexStream && mDuplexStream->ioMode() == FullDuplexEngine::IoMode::Callback) {
+        mDuplexDriver->onAudioReady(oboeStream, audioData, numFrames);
+    } else if (mDuplexStream) {
         mDuplexStream->pullTo(static_cast<float*>(audioData), numFrames);
     } else {
         // Safety: if not available, output silence
-        std::memset(audioData, 0, sizeof(float) * numFrames * mOutputChannelCount);
+        std::memset(audioData, 0, sizeof(float) * numFrames * oboeStream->getChannelCount());
     }
 
     // Simple test processing: apply a 0.9 gain to the output
     float* out = static_cast<float*>(audioData);
-    const int n = numFrames * mOutputChannelCount; // 2 if stereo, 1 if mono
+    const int n = numFrames * oboeStream->getChannelCount(); // as opened, not as requested
     for (int i = 0; i < n; ++i) {
         out[i] *= 0.9f;
     }
@@ -21,8 +21,9 @@
 #include <oboe/Oboe.h>
 #include <string>
 #include <thread>
-#include "FullDuplexPass.h"
+#include "OboeAudioPort.h"
 #include "FullDuplexEngine.h"
+#include "Metrics.h"
 
 class LiveEffectEngine : public oboe::AudioStreamCallback {
 public:
@@ -49,6 +50,41 @@ public:
     void onErrorBeforeClose(oboe::AudioStream *oboeStream, oboe::Result error) override;
     void onErrorAfterClose(oboe::AudioStream *oboeStream, oboe::Result error) override;
 
+    /**
+     * Mask model (NeuralNet weight file, NNWM preferred) loaded whenever the
+     * effect is switched on. Empty path disables it. Takes effect on the next start.
+     */
+    void setMaskModelPath(const std::string& path) { mMaskModelPath = path; }
+
+    /**
+     * Run the DSP inside the output callback (FullDuplexPass) instead of on
+     * the io thread. Restarts the streams if the effect is on. Refused while
+     * the input has more channels than the output (FullDuplexPass).
+     * @return true if it succeeds
+     */
+    bool setCallbackMode(bool enabled);
+
+    /**
+     * Channel counts requested for the recording and playback streams; they
+     * may differ (e.g. a 4-mic array into stereo), except that callback mode
+     * needs no more input than output channels. Restarts the streams if the
+     * effect is on.
+     * @return true if it succeeds
+     */
+    bool setChannelCounts(int32_t inputChannels, int32_t outputChannels);
+
+    /**
+     * Output depth the latency controller never trims below (0 = as low as
+     * the measured jitter allows). Applies immediately when running.
+     */
+    void setTargetLatencyMillis(float millis);
+
+    /**
+     * Algorithmic latency plus the mean buffered output depth, in ms.
+     * @return -1 if the effect is off
+     */
+    double getAchievedLatencyMillis() const;
+
     bool setAudioApi(oboe::AudioApi);
     bool isAAudioRecommended(void);
 
@@ -59,10 +95,17 @@ private:
     const oboe::AudioFormat mFormat = oboe::AudioFormat::Float; // for easier processing
     oboe::AudioApi    mAudioApi = oboe::AudioApi::AAudio;
     int32_t           mSampleRate = oboe::kUnspecified;
-    const int32_t     mInputChannelCount = oboe::ChannelCount::Stereo;
-    const int32_t     mOutputChannelCount = oboe::ChannelCount::Stereo;
+    int32_t           mInputChannelCount = oboe::ChannelCount::Stereo;
+    int32_t           mOutputChannelCount = oboe::ChannelCount::Stereo;
+
+    std::string       mMaskModelPath;
+    bool              mCallbackMode = false;
+    float             mTargetLatencyMillis = 0.0f;
 
     std::unique_ptr<FullDuplexEngine> mDuplexStream;
+    std::shared_ptr<OboeDuplexDriver> mDuplexDriver;  // callback mode
+    metrics::Histogram& mCallbackNs = metrics::registry().histogram(
+            "engine.callback_ns", {100000, 250000, 500000, 1000000, 2000000, 4000000, 8000000});
     std::shared_ptr<oboe::AudioStream> mRecordingStream;
     std::shared_ptr<oboe::AudioStream> mPlayStream;
 
@@ -0,0 +1,118 @@
+// LogMelProcessor.cpp
+#include "LogMelProcessor.h"
+#include "FastMath.h"
+#include <cmath>
+#include <algorithm>
+
+static inline float hzToMel(float hz)  { return 2595.0f * std::log10(1.0f + hz / 700.0f); }
+static inline float melToHz(float mel) { return 700.0f * (std::pow(10.0f, mel / 2595.0f) - 1.0f); }
+
+bool LogMelProcessor::prepare(const Config& config, int32_t fftSize, int32_t sampleRate) {
+    if (config.numMels <= 0 || fftSize <= 0 || sampleRate <= 0) return false;
+    const float nyquist = 0.5f * float(sampleRate);
+    const float fMax = (config.fMaxHz > 0.0f) ? std::min(config.fMaxHz, nyquist) : nyquist;
+    if (config.fMinHz < 0.0f || config.fMinHz >= fMax) return false;
+
+    mCfg        = config;
+    mFftSize    = fftSize;
+    mSampleRate = sampleRate;
+    mMaxHz      = (config.fMaxHz > 0.0f) ? fMax : 0.0f;
+
+    // HTK mel scale, numMels triangles with centres evenly spaced in mel
+    const int32_t M = config.numMels;
+    const int32_t bins = fftSize / 2 + 1;
+    const float binHz = float(sampleRate) / float(fftSize);
+    const float melLo = hzToMel(config.fMinHz);
+    const float melHi = hzToMel(fMax);
+    std::vector<float> edges(M + 2);
+    for (int32_t i = 0; i < M + 2; ++i) {
+        edges[i] = melToHz(melLo + (melHi - melLo) * float(i) / float(M + 1));
+    }
+
+    mBandStart.assign(M, 0);
+    mBandLen.assign(M, 0);
+    mBandOffset.assign(M, 0);
+    mWeights.clear();
+    for (int32_t m = 0; m < M; ++m) {
+        const float lo = edges[m], mid = edges[m + 1], hi = edges[m + 2];
+        const int32_t first = std::max<int32_t>(0, static_cast<int32_t>(std::ceil(lo / binHz)));
+        const int32_t last  = std::min<int32_t>(bins - 1, static_cast<int32_t>(std::floor(hi / binHz)));
+        mBandStart[m]  = first;
+        mBandOffset[m] = static_cast<int32_t>(mWeights.size());
+        for (int32_t k = first; k <= last; ++k) {
+            const float f = float(k) * binHz;
+            const float w = (f <= mid) ? (f - lo) / std::max(mid - lo, 1e-6f)
+                                       : (hi - f) / std::max(hi - mid, 1e-6f);
+            mWeights.push_back(std::max(0.0f, w));
+        }
+        mBandLen[m] = static_cast<int32_t>(mWeights.size()) - mBandOffset[m];
+    }
+
+    mPowerMix.assign(bins, 0.0f);
+    mMel.assign(M, 0.0f);
+    mMean.assign(M, 0.0f);
+    mVar.assign(M, 1.0f);
+    mStatsPrimed = false;
+    mProduced = 0;
+    mDropped  = 0;
+    return mFeatures.init(config.ringFrames, M);
+}
+
+void LogMelProcessor::resetNormalization() {
+    std::fill(mMean.begin(), mMean.end(), 0.0f);
+    std::fill(mVar.begin(), mVar.end(), 1.0f);
+    mStatsPrimed = false;
+}
+
+void LogMelProcessor::processHop(SpectralFrame& frame, const SpectralHopInfo& info) {
+    if (info.fftSize != mFftSize || mMel.empty()) return; // not prepared for this geometry
+
+    // Power spectrum, shared with any other reader of this hop
+    const int32_t nb = frame.numBins();
+    const float* power = frame.powerView(0);
+    if (power == nullptr) return;
+    if (frame.numChannels() == 2) {
+        const float* powerR = frame.powerView(1);
+        float* mix = mPowerMix.data();
+        for (int32_t k = 0; k < nb; ++k) mix[k] = 0.5f * (power[k] + powerR[k]);
+        power = mix;
+    }
+
+    // Sparse filterbank: one short dense dot product per band
+    const int32_t M = mCfg.numMels;
+    const float* w = mWeights.data();
+    for (int32_t m = 0; m < M; ++m) {
+        const int32_t start = mBandStart[m];
+        const int32_t len = std::min(mBandLen[m], nb - start);
+        const float* p  = power + start;
+        const float* wm = w + mBandOffset[m];
+        float acc = 0.0f;
+        for (int32_t k = 0; k < len; ++k) acc += wm[k] * p[k];
+        mMel[m] = acc;
+    }
+
+    // Log compression
+    const float logFloor = mCfg.logFloor;
+    for (int32_t m = 0; m < M; ++m) mMel[m] = fastmath::logApprox(mMel[m] + logFloor);
+
+    // Running mean/variance normalization (EMA)
+    if (mCfg.normalize) {
+        if (!mStatsPrimed) {
+            std::copy(mMel.begin(), mMel.end(), mMean.begin());
+            mStatsPrimed = true;
+        }
+        const float a = mCfg.normAlpha;
+        for (int32_t m = 0; m < M; ++m) {
+            const float d = mMel[m] - mMean[m];
+            mMean[m] += a * d;
+            mVar[m]  += a * (d * d - mVar[m]);
+            mMel[m]   = d / std::sqrt(mVar[m] + 1e-6f);
+        }
+    }
+
+    if (mFeatures.writeInterleaved(mMel.data(), 1) == 1) {
+        ++mProduced;
+    } else {
+        ++mDropped;
+    }
+}
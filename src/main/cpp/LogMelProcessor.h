@@ -0,0 +1,73 @@
+// LogMelProcessor.h
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "SpectralProcessor.h"
+#include "RingBuffer.h"
+
+/**
+ * Log-mel feature stage hanging off the STFT (read-only spectral processor).
+ *
+ * Per hop: power spectrum (the frame's memoized powerView(), averaged over
+ * channels in stereo) -> sparse triangular mel filterbank -> ln(energy + floor)
+ * -> optional running mean/variance normalization -> one frame of numMels
+ * floats written to features(). The filterbank stores only the non-zero
+ * span of each band (start bin + contiguous weights), so a band is a short
+ * dense dot product that the compiler vectorizes.
+ *
+ * features() is an SPSC ring (channels = numMels, one frame per hop); the
+ * consumer may run on another thread. Frames that do not fit are dropped and
+ * counted in droppedFrames().
+ */
+class LogMelProcessor : public SpectralProcessor {
+public:
+    struct Config {
+        int32_t numMels     = 40;
+        float   fMinHz      = 20.0f;
+        float   fMaxHz      = 0.0f;     // 0 = Nyquist
+        float   logFloor    = 1e-10f;   // added to the mel energy before the log
+        bool    normalize   = false;    // running mean/variance normalization
+        float   normAlpha   = 0.01f;    // EMA coefficient per hop (~100 hop memory)
+        int32_t ringFrames  = 256;      // feature ring capacity in hops
+    };
+
+    // Builds the filterbank for this STFT geometry and allocates all buffers.
+    // Call before the processor is attached/streaming. Returns false on a bad config.
+    bool prepare(const Config& config, int32_t fftSize, int32_t sampleRate);
+
+    int32_t numMels() const { return mCfg.numMels; }
+    RingBuffer& features() { return mFeatures; }
+    uint64_t framesProduced() const { return mProduced; }
+    uint64_t droppedFrames() const { return mDropped; }
+
+    // Restarts the running normalization statistics.
+    void resetNormalization();
+
+    // SpectralProcessor
+    float maxFrequencyHz() const override { return mMaxHz; }
+    bool  modifiesSpectrum() const override { return false; }
+    void  processHop(SpectralFrame& frame, const SpectralHopInfo& info) override;
+
+private:
+    Config  mCfg;
+    int32_t mFftSize = 0;
+    int32_t mSampleRate = 0;
+    float   mMaxHz = 0.0f;
+
+    // Sparse filterbank: band m covers bins [mBandStart[m], mBandStart[m] + mBandLen[m])
+    // with weights at mWeights[mBandOffset[m] ...]
+    std::vector<int32_t> mBandStart;
+    std::vector<int32_t> mBandLen;
+    std::vector<int32_t> mBandOffset;
+    std::vector<float>   mWeights;
+
+    std::vector<float> mPowerMix;  // channel-averaged power (stereo only)
+    std::vector<float> mMel;       // one output frame
+    std::vector<float> mMean;
+    std::vector<float> mVar;
+    bool               mStatsPrimed = false;
+
+    RingBuffer mFeatures;
+    uint64_t   mProduced = 0;
+    uint64_t   mDropped  = 0;
+};
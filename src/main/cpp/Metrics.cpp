@@ -0,0 +1,184 @@
+// Metrics.cpp
+#include "Metrics.h"
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace metrics {
+
+namespace {
+
+std::atomic<int32_t> gNextShard{0};
+
+// Low byte first, so the layout is little endian whatever the host
+template <typename T>
+void put(uint8_t*& p, T v) {
+    typename std::make_unsigned<T>::type u;
+    std::memcpy(&u, &v, sizeof(T));
+    for (size_t i = 0; i < sizeof(T); ++i) p[i] = static_cast<uint8_t>(u >> (8 * i));
+    p += sizeof(T);
+}
+
+// Name bytes as stored: at most 255
+size_t storedNameLength(const std::string& name) {
+    return std::min<size_t>(name.size(), 255);
+}
+
+} // namespace
+
+int32_t shardIndex() {
+    thread_local int32_t idx = gNextShard.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return idx;
+}
+
+int64_t Counter::value() const {
+    int64_t v = 0;
+    for (const Shard& s : mShards) v += s.value.load(std::memory_order_relaxed);
+    return v;
+}
+
+int64_t Gauge::max() const {
+    int64_t m = INT64_MIN;
+    for (const Shard& s : mMax) m = std::max(m, s.value.load(std::memory_order_relaxed));
+    return m == INT64_MIN ? 0 : m;
+}
+
+Histogram::Histogram(const std::vector<int64_t>& bounds) {
+    mNumBounds = static_cast<int32_t>(std::min<size_t>(bounds.size(), kMaxBuckets));
+    std::copy(bounds.begin(), bounds.begin() + mNumBounds, mBounds);
+    std::sort(mBounds, mBounds + mNumBounds);
+}
+
+HistogramSnapshot Histogram::snapshot() const {
+    HistogramSnapshot snap;
+    snap.bounds.assign(mBounds, mBounds + mNumBounds);
+    snap.counts.assign(static_cast<size_t>(mNumBounds) + 1, 0);
+    int64_t mx = INT64_MIN;
+    for (const Shard& s : mShards) {
+        for (int32_t b = 0; b <= mNumBounds; ++b) {
+            const uint64_t n = s.counts[b].load(std::memory_order_relaxed);
+            snap.counts[b] += n;
+            snap.count += n;
+        }
+        snap.sum += s.sum.load(std::memory_order_relaxed);
+        mx = std::max(mx, s.max.load(std::memory_order_relaxed));
+    }
+    snap.max = (mx == INT64_MIN) ? 0 : mx;
+    return snap;
+}
+
+uint64_t Histogram::count() const {
+    uint64_t n = 0;
+    for (const Shard& s : mShards) {
+        for (int32_t b = 0; b <= mNumBounds; ++b) n += s.counts[b].load(std::memory_order_relaxed);
+    }
+    return n;
+}
+
+int64_t Histogram::sum() const {
+    int64_t v = 0;
+    for (const Shard& s : mShards) v += s.sum.load(std::memory_order_relaxed);
+    return v;
+}
+
+int64_t Histogram::max() const {
+    int64_t m = INT64_MIN;
+    for (const Shard& s : mShards) m = std::max(m, s.max.load(std::memory_order_relaxed));
+    return m == INT64_MIN ? 0 : m;
+}
+
+Registry& Registry::instance() {
+    // Never destroyed: metric references held by statics stay valid at exit
+    static Registry* r = new Registry();
+    return *r;
+}
+
+Registry::Entry* Registry::find(const std::string& name, Type type) {
+    for (auto& e : mEntries) {
+        if (e->name == name && e->type == type) return e.get();
+    }
+    return nullptr;
+}
+
+Counter& Registry::counter(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (Entry* e = find(name, Type::Counter)) return *e->c;
+    auto e = std::make_unique<Entry>();
+    e->name = name;
+    e->type = Type::Counter;
+    e->c = std::make_unique<Counter>();
+    mEntries.push_back(std::move(e));
+    return *mEntries.back()->c;
+}
+
+Gauge& Registry::gauge(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (Entry* e = find(name, Type::Gauge)) return *e->g;
+    auto e = std::make_unique<Entry>();
+    e->name = name;
+    e->type = Type::Gauge;
+    e->g = std::make_unique<Gauge>();
+    mEntries.push_back(std::move(e));
+    return *mEntries.back()->g;
+}
+
+Histogram& Registry::histogram(const std::string& name, const std::vector<int64_t>& bounds) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (Entry* e = find(name, Type::Histogram)) return *e->h;
+    auto e = std::make_unique<Entry>();
+    e->name = name;
+    e->type = Type::Histogram;
+    e->h = std::make_unique<Histogram>(bounds);
+    mEntries.push_back(std::move(e));
+    return *mEntries.back()->h;
+}
+
+int64_t Registry::serialize(uint8_t* out, size_t capacity) const {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    size_t need = 4 * sizeof(uint32_t);
+    for (const auto& e : mEntries) {
+        need += 4 + storedNameLength(e->name);
+        switch (e->type) {
+            case Type::Counter:   need += 8; break;
+            case Type::Gauge:     need += 16; break;
+            case Type::Histogram: need += 24 + static_cast<size_t>(e->h->numBounds()) * 16 + 8; break;
+        }
+    }
+    if (out == nullptr || capacity < need) return -static_cast<int64_t>(need);
+
+    uint8_t* p = out;
+    put<uint32_t>(p, kMagic);
+    put<uint32_t>(p, kVersion);
+    put<uint32_t>(p, static_cast<uint32_t>(mEntries.size()));
+    put<uint32_t>(p, static_cast<uint32_t>(need));
+    for (const auto& e : mEntries) {
+        const size_t nameLen = storedNameLength(e->name);
+        put<uint8_t>(p, static_cast<uint8_t>(e->type));
+        put<uint8_t>(p, static_cast<uint8_t>(nameLen));
+        put<uint16_t>(p, static_cast<uint16_t>(e->type == Type::Histogram ? e->h->numBounds() : 0));
+        std::memcpy(p, e->name.data(), nameLen);
+        p += nameLen;
+        switch (e->type) {
+            case Type::Counter:
+                put<int64_t>(p, e->c->value());
+                break;
+            case Type::Gauge:
+                put<int64_t>(p, e->g->value());
+                put<int64_t>(p, e->g->max());
+                break;
+            case Type::Histogram: {
+                const HistogramSnapshot s = e->h->snapshot();
+                put<uint64_t>(p, s.count);
+                put<int64_t>(p, s.sum);
+                put<int64_t>(p, s.max);
+                for (int64_t b : s.bounds) put<int64_t>(p, b);
+                for (uint64_t n : s.counts) put<uint64_t>(p, n);
+                break;
+            }
+        }
+    }
+    return static_cast<int64_t>(p - out);
+}
+
+} // namespace metrics
@@ -0,0 +1,170 @@
+// Metrics.h
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <time.h>
+#include <vector>
+
+/**
+ * Process-wide metrics for the audio threads.
+ *
+ * Counters, gauges and fixed-bucket histograms are registered by name once,
+ * off the audio path, and then updated from any thread with relaxed atomics
+ * only: no locks, no allocation, no CAS loops. Every metric keeps kShards
+ * cache-line-sized shards, not one per thread: threads are dealt shards in
+ * turn, in the order of their first update anywhere (shardIndex), and keep
+ * that shard. The io thread, the STFT worker and the playback callback are
+ * normally among the first kShards and get a line each; later threads (a
+ * restarted engine's, tools') share. Readers sum the shards
+ * (Registry::serialize, the snapshots) on whatever thread asks.
+ *
+ * Maxima are updated with a plain load/store on the shard, so they are exact
+ * while one thread writes it and only approximate when threads share one.
+ *
+ * serialize() layout (little endian on every host, unaligned, sizes in bytes):
+ *   header   u32 magic 'MTRC', u32 version, u32 metric count, u32 total bytes
+ *   metric   u8 type (1 counter, 2 gauge, 3 histogram), u8 name length,
+ *            u16 bucket count (histograms, else 0), name (no terminator), then
+ *     counter    i64 value
+ *     gauge      i64 value, i64 max
+ *     histogram  u64 count, i64 sum, i64 max, i64 upper bounds[buckets],
+ *                u64 counts[buckets + 1] (the last one is above every bound)
+ */
+namespace metrics {
+
+constexpr uint32_t kMagic   = 0x4352544D; // "MTRC"
+constexpr uint32_t kVersion = 1;
+constexpr int32_t  kShards  = 4;
+constexpr int32_t  kMaxBuckets = 16;
+
+enum class Type : uint8_t { Counter = 1, Gauge = 2, Histogram = 3 };
+
+// Shard the calling thread writes to: dealt round robin on its first update, then fixed
+int32_t shardIndex();
+
+class Counter {
+public:
+    void add(int64_t v = 1) {
+        mShards[shardIndex()].value.fetch_add(v, std::memory_order_relaxed);
+    }
+    int64_t value() const;
+
+private:
+    struct alignas(64) Shard { std::atomic<int64_t> value{0}; };
+    Shard mShards[kShards];
+};
+
+class Gauge {
+public:
+    void set(int64_t v) {
+        mValue.store(v, std::memory_order_relaxed);
+        std::atomic<int64_t>& m = mMax[shardIndex()].value;
+        if (v > m.load(std::memory_order_relaxed)) m.store(v, std::memory_order_relaxed);
+    }
+    int64_t value() const { return mValue.load(std::memory_order_relaxed); }
+    int64_t max() const;
+
+private:
+    struct alignas(64) Shard { std::atomic<int64_t> value{INT64_MIN}; };
+    alignas(64) std::atomic<int64_t> mValue{0};
+    Shard mMax[kShards];
+};
+
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    int64_t  sum = 0;
+    int64_t  max = 0;
+    std::vector<int64_t>  bounds;
+    std::vector<uint64_t> counts;   // bounds.size() + 1
+    double mean() const { return count ? double(sum) / double(count) : 0.0; }
+};
+
+class Histogram {
+public:
+    // Upper bounds (inclusive) in ascending order, at most kMaxBuckets
+    explicit Histogram(const std::vector<int64_t>& bounds);
+
+    void record(int64_t v) {
+        int32_t b = 0;
+        while (b < mNumBounds && v > mBounds[b]) ++b;
+        Shard& s = mShards[shardIndex()];
+        s.counts[b].fetch_add(1, std::memory_order_relaxed);
+        s.sum.fetch_add(v, std::memory_order_relaxed);
+        if (v > s.max.load(std::memory_order_relaxed)) s.max.store(v, std::memory_order_relaxed);
+    }
+    int32_t numBounds() const { return mNumBounds; }
+    HistogramSnapshot snapshot() const;
+    // Totals alone, without allocating (fine on the audio threads)
+    uint64_t count() const;
+    int64_t  sum() const;
+    int64_t  max() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> counts[kMaxBuckets + 1];
+        std::atomic<int64_t>  sum{0};
+        std::atomic<int64_t>  max{INT64_MIN};
+        Shard() { for (auto& c : counts) c.store(0, std::memory_order_relaxed); }
+    };
+    int32_t mNumBounds = 0;
+    int64_t mBounds[kMaxBuckets] = {};
+    Shard   mShards[kShards];
+};
+
+class Registry {
+public:
+    static Registry& instance();
+
+    // Returns the metric of that name, creating it on first use. Addresses
+    // stay valid for the life of the process. A histogram registered again
+    // keeps its original bounds. Not for the audio path (takes a lock).
+    Counter&   counter(const std::string& name);
+    Gauge&     gauge(const std::string& name);
+    Histogram& histogram(const std::string& name, const std::vector<int64_t>& bounds);
+
+    // Writes every metric (layout above). Returns the bytes written, or the
+    // negated size needed if 'capacity' is too small (nothing is written).
+    int64_t serialize(uint8_t* out, size_t capacity) const;
+
+private:
+    struct Entry {
+        std::string name;
+        Type type;
+        std::unique_ptr<Counter>   c;
+        std::unique_ptr<Gauge>     g;
+        std::unique_ptr<Histogram> h;
+    };
+    Entry* find(const std::string& name, Type type);
+
+    mutable std::mutex mLock;
+    std::vector<std::unique_ptr<Entry>> mEntries;
+};
+
+inline Registry& registry() { return Registry::instance(); }
+
+// Records how long a scope ran, in CLOCK_MONOTONIC nanoseconds, into a
+// histogram. The engine's always-on stage stats use it; the opt-in
+// per-stage breakdown is StageTimer.h.
+class ScopedNanos {
+public:
+    explicit ScopedNanos(Histogram& h) : mHist(h), mStart(now()) {}
+    ~ScopedNanos() { mHist.record(now() - mStart); }
+    ScopedNanos(const ScopedNanos&) = delete;
+    ScopedNanos& operator=(const ScopedNanos&) = delete;
+
+    static int64_t now() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+    }
+
+private:
+    Histogram& mHist;
+    int64_t    mStart;
+};
+
+} // namespace metrics
@@ -0,0 +1,101 @@
+// NeuralMaskProcessor.cpp
+#include "NeuralMaskProcessor.h"
+#include "EngineLog.h"
+#include <algorithm>
+#include <chrono>
+
+static inline int64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool NeuralMaskProcessor::load(const std::string& path) {
+    const size_t rssBefore = weights::residentBytes();
+    const int64_t t0 = nowNanos();
+    if (!mNet.load(path)) return false;
+    const int64_t loadNs = nowNanos() - t0;
+    mInput.assign(mNet.inputSize(), 0.0f);
+    reset();
+    const size_t rssAfter = weights::residentBytes();
+    LOGI("NeuralMaskProcessor: %s: %d layers, %d -> %d bins, weights %zu B, arena %zu B",
+         path.c_str(), mNet.numLayers(), mNet.inputSize(), mNet.outputSize(),
+         mNet.weightBytes(), mNet.arenaBytes());
+    LOGI("NeuralMaskProcessor: %s in %.3f ms, RSS %+lld KB",
+         mNet.isMapped() ? "mapped" : "parsed and copied", double(loadNs) / 1e6,
+         (long long)(rssAfter - rssBefore) / 1024);
+    return true;
+}
+
+bool NeuralMaskProcessor::setQuantized(bool enabled) {
+    if (!enabled) {
+        mNet.dropQuantized();
+        return true;
+    }
+    if (!mNet.quantize(quant::selected())) return false;
+    LOGI("NeuralMaskProcessor: int8 %s, %zu B", quant::kernelName(quant::selected()),
+         mNet.quantizedBytes());
+    return true;
+}
+
+void NeuralMaskProcessor::reset() {
+    mNet.resetState();
+    mCooldown = 0;
+    mRun.store(0);
+    mBypassed.store(0);
+    mOverruns.store(0);
+    mMaxNs.store(0);
+    mTotalNs.store(0);
+}
+
+void NeuralMaskProcessor::processHop(SpectralFrame& frame, const SpectralHopInfo& info) {
+    (void)info;
+    const int32_t nIn  = mNet.inputSize();
+    const int32_t nOut = mNet.outputSize();
+    if (!mNet.isLoaded() || frame.numBins() < std::max(nIn, nOut)) {
+        mBypassed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (mCooldown > 0) {
+        --mCooldown;
+        mBypassed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const int64_t t0 = nowNanos();
+
+    // Features: log-power (memoized on the frame), channel-averaged
+    const float* lp = frame.logPowerView(0);
+    if (frame.numChannels() == 2) {
+        const float* lpR = frame.logPowerView(1);
+        for (int32_t k = 0; k < nIn; ++k) mInput[k] = 0.5f * (lp[k] + lpR[k]);
+    } else {
+        std::copy_n(lp, nIn, mInput.begin());
+    }
+
+    // Layer by layer so an overrun is caught before the next layer starts
+    const float* y = mInput.data();
+    for (int32_t i = 0; i < mNet.numLayers(); ++i) {
+        y = mNet.runLayers(y, i, i + 1);
+        if (mBudgetNs > 0 && nowNanos() - t0 > mBudgetNs) {
+            mOverruns.fetch_add(1, std::memory_order_relaxed);
+            mBypassed.fetch_add(1, std::memory_order_relaxed);
+            mCooldown = kCooldownHops;
+            return;
+        }
+    }
+
+    // Apply the mask to every channel (frame is in Cartesian layout)
+    for (int32_t c = 0; c < frame.numChannels(); ++c) {
+        float* re = frame.re(c);
+        float* im = frame.im(c);
+        for (int32_t k = 0; k < nOut; ++k) {
+            re[k] *= y[k];
+            im[k] *= y[k];
+        }
+    }
+
+    const uint64_t ns = static_cast<uint64_t>(nowNanos() - t0);
+    mRun.fetch_add(1, std::memory_order_relaxed);
+    mTotalNs.fetch_add(ns, std::memory_order_relaxed);
+    if (ns > mMaxNs.load(std::memory_order_relaxed)) mMaxNs.store(ns, std::memory_order_relaxed);
+}
@@ -0,0 +1,59 @@
+// NeuralMaskProcessor.h
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "SpectralProcessor.h"
+#include "NeuralNet.h"
+
+/**
+ * Streaming mask estimation at the STFT: once per hop the network maps the
+ * log-power of the first inputSize() bins (channel average in stereo) to a
+ * gain per bin for the first outputSize() bins, applied to every channel.
+ *
+ * Hard time budget: the elapsed time is checked after every layer. When the
+ * budget is exceeded the hop is bypassed (spectrum left untouched) and the
+ * model is skipped for kCooldownHops hops so the audio thread catches up.
+ * Recurrent state keeps whatever the layers that did run wrote.
+ */
+class NeuralMaskProcessor : public SpectralProcessor {
+public:
+    static constexpr int kCooldownHops = 8;
+
+    // Loads the weights (see NeuralNet: NNW1 copied, NNWM mapped in place) and
+    // allocates every buffer. Logs load time and RSS growth. Call before streaming.
+    bool load(const std::string& path);
+    bool isLoaded() const { return mNet.isLoaded(); }
+    const NeuralNet& net() const { return mNet; }
+
+    // Switches the matrices between float and int8 (packed for quant::selected()).
+    bool setQuantized(bool enabled);
+
+    // 0 disables the budget.
+    void setBudgetMicros(int32_t us) { mBudgetNs = static_cast<int64_t>(us) * 1000; }
+
+    void reset();
+
+    uint64_t hopsRun()      const { return mRun.load(std::memory_order_relaxed); }
+    uint64_t hopsBypassed() const { return mBypassed.load(std::memory_order_relaxed); }
+    uint64_t overruns()     const { return mOverruns.load(std::memory_order_relaxed); }
+    uint64_t maxHopNs()     const { return mMaxNs.load(std::memory_order_relaxed); }
+    uint64_t totalHopNs()   const { return mTotalNs.load(std::memory_order_relaxed); }
+
+    // SpectralProcessor
+    void processHop(SpectralFrame& frame, const SpectralHopInfo& info) override;
+
+private:
+    NeuralNet          mNet;
+    std::vector<float> mInput;   // inputSize() log-power features
+    int64_t            mBudgetNs = 0;
+    int32_t            mCooldown = 0;
+
+    // Read by the stats log on another thread
+    std::atomic<uint64_t> mRun{0};
+    std::atomic<uint64_t> mBypassed{0};
+    std::atomic<uint64_t> mOverruns{0};
+    std::atomic<uint64_t> mMaxNs{0};
+    std::atomic<uint64_t> mTotalNs{0};
+};
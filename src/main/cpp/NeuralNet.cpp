@@ -0,0 +1,462 @@
+// NeuralNet.cpp
+#include "NeuralNet.h"
+#include "EngineLog.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+static size_t paramCount(const NeuralNet::Layer& l) {
+    const size_t in = static_cast<size_t>(l.in), out = static_cast<size_t>(l.out);
+    switch (l.type) {
+        case NeuralNet::LayerType::Dense:  return out * in + out;
+        case NeuralNet::LayerType::Gru:    return 3 * out * in + 3 * out * out + 6 * out;
+        case NeuralNet::LayerType::Conv1d: return out * in * static_cast<size_t>(l.kernel) + out;
+    }
+    return 0;
+}
+
+bool NeuralNet::load(const std::string& path) {
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (f == nullptr) {
+        LOGE("NeuralNet.load(): cannot open %s", path.c_str());
+        return false;
+    }
+    char magic[4] = {};
+    if (std::fread(magic, 1, 4, f) == 4 && std::memcmp(magic, weights::kMagic, 4) == 0) {
+        std::fclose(f);
+        return loadMapped(path);
+    }
+    std::rewind(f);
+
+    std::vector<uint8_t> bytes;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) bytes.insert(bytes.end(), buf, buf + n);
+    std::fclose(f);
+
+    size_t pos = 0;
+    auto readU32 = [&](uint32_t& v) {
+        if (pos + 4 > bytes.size()) return false;
+        std::memcpy(&v, bytes.data() + pos, 4);
+        pos += 4;
+        return true;
+    };
+
+    uint32_t numLayers = 0, inputSize = 0;
+    if (bytes.size() < 4 || std::memcmp(bytes.data(), "NNW1", 4) != 0) {
+        LOGE("NeuralNet.load(): %s: bad magic", path.c_str());
+        return false;
+    }
+    pos = 4;
+    if (!readU32(numLayers) || !readU32(inputSize) || numLayers == 0 || numLayers > 64) {
+        LOGE("NeuralNet.load(): %s: bad header", path.c_str());
+        return false;
+    }
+
+    std::vector<Layer> layers(numLayers);
+    std::vector<float> weights;
+    int32_t prevOut = static_cast<int32_t>(inputSize);
+    for (uint32_t i = 0; i < numLayers; ++i) {
+        uint32_t type, act, out, kernel;
+        if (!readU32(type) || !readU32(act) || !readU32(out) || !readU32(kernel)
+            || type > 2 || act > 3 || out == 0 || (type == 2 && kernel == 0)) {
+            LOGE("NeuralNet.load(): %s: bad layer %u", path.c_str(), i);
+            return false;
+        }
+        Layer& l = layers[i];
+        l.type   = static_cast<LayerType>(type);
+        l.act    = static_cast<Activation>(act);
+        l.in     = prevOut;
+        l.out    = static_cast<int32_t>(out);
+        l.kernel = static_cast<int32_t>(kernel);
+        const size_t count = paramCount(l);
+        if (pos + count * sizeof(float) > bytes.size()) {
+            LOGE("NeuralNet.load(): %s: truncated at layer %u", path.c_str(), i);
+            return false;
+        }
+        const size_t base = weights.size();
+        weights.resize(base + count);
+        std::memcpy(weights.data() + base, bytes.data() + pos, count * sizeof(float));
+        pos += count * sizeof(float);
+        prevOut = l.out;
+    }
+    return build(static_cast<int32_t>(inputSize), std::move(layers), std::move(weights));
+}
+
+bool NeuralNet::build(int32_t inputSize, std::vector<Layer> layers, std::vector<float> weights) {
+    size_t offset = 0;
+    int32_t prevOut = inputSize;
+    for (Layer& l : layers) {
+        if (l.in != prevOut || l.out <= 0) return false;
+        l.weightOffset = offset;
+        offset += paramCount(l);
+        prevOut = l.out;
+    }
+    if (offset != weights.size()) return false;
+    mInputSize  = inputSize;
+    mLayers     = std::move(layers);
+    mWeights    = std::move(weights);
+    mParams     = mWeights.data();
+    mParamCount = mWeights.size();
+    mMapped.reset();
+    mMappedMatrices.clear();
+    dropQuantized();
+    return planMemory();
+}
+
+bool NeuralNet::loadMapped(const std::string& path, bool verifyPayload) {
+    using namespace weights;
+    std::shared_ptr<const MappedFile> file = MappedFile::openShared(path);
+    if (!file) return false;
+    const uint8_t* base = file->data();
+    const size_t size = file->size();
+
+    ContainerHeader hdr;
+    if (size < sizeof(hdr)) {
+        LOGE("NeuralNet.loadMapped(): %s: too small", path.c_str());
+        return false;
+    }
+    std::memcpy(&hdr, base, sizeof(hdr));
+    if (std::memcmp(hdr.magic, kMagic, 4) != 0 || hdr.version != kVersion) {
+        LOGE("NeuralNet.loadMapped(): %s: bad magic or version %u", path.c_str(), hdr.version);
+        return false;
+    }
+    const uint64_t tableEnd = uint64_t(hdr.headerBytes) + uint64_t(hdr.numLayers) * sizeof(ContainerLayer);
+    if (hdr.fileBytes != size || hdr.headerBytes < sizeof(hdr) || hdr.numLayers == 0
+        || hdr.numLayers > 64 || hdr.inputSize == 0 || tableEnd > size || hdr.packing > 2) {
+        LOGE("NeuralNet.loadMapped(): %s: bad header", path.c_str());
+        return false;
+    }
+    if (checksum(base + hdr.headerBytes, tableEnd - hdr.headerBytes) != hdr.tableChecksum) {
+        LOGE("NeuralNet.loadMapped(): %s: layer table checksum mismatch", path.c_str());
+        return false;
+    }
+    if (verifyPayload && checksum(base + tableEnd, size - tableEnd) != hdr.payloadChecksum) {
+        LOGE("NeuralNet.loadMapped(): %s: payload checksum mismatch", path.c_str());
+        return false;
+    }
+
+    auto inFile = [&](uint64_t offset, uint64_t bytes, uint64_t align) {
+        return offset % align == 0 && offset >= tableEnd && offset <= size && bytes <= size - offset;
+    };
+    std::vector<Layer> layers(hdr.numLayers);
+    std::vector<ContainerMatrix> matrices;
+    int32_t prevOut = static_cast<int32_t>(hdr.inputSize);
+    for (uint32_t i = 0; i < hdr.numLayers; ++i) {
+        ContainerLayer cl;
+        std::memcpy(&cl, base + hdr.headerBytes + i * sizeof(ContainerLayer), sizeof(cl));
+        Layer& l = layers[i];
+        l.type   = static_cast<LayerType>(cl.type);
+        l.act    = static_cast<Activation>(cl.act);
+        l.in     = static_cast<int32_t>(cl.in);
+        l.out    = static_cast<int32_t>(cl.out);
+        l.kernel = static_cast<int32_t>(cl.kernel);
+        const uint32_t expectMatrices = (hdr.packing == 0) ? 0
+                                      : (cl.type == 0) ? 1 : (cl.type == 1) ? 2 : 0;
+        bool ok = cl.type <= 2 && cl.act <= 3 && cl.out > 0 && cl.out <= (1u << 20)
+                  && l.in == prevOut && (cl.type != 2 || (cl.kernel > 0 && cl.kernel <= 64))
+                  && cl.numMatrices == expectMatrices
+                  && inFile(cl.paramsOffset, paramCount(l) * sizeof(float), sizeof(float));
+        for (uint32_t m = 0; ok && m < cl.numMatrices; ++m) {
+            const ContainerMatrix& cm = cl.matrices[m];
+            const uint32_t rows = (cl.type == 1) ? 3 * cl.out : cl.out;
+            const uint32_t cols = (m == 0) ? cl.in : cl.out;
+            ok = cm.rows == rows && cm.cols == cols
+                 && cm.rowsPadded == (rows + 3) / 4 * 4 && cm.colsPadded == (cols + 31) / 32 * 32
+                 && inFile(cm.dataOffset, uint64_t(cm.rowsPadded) * cm.colsPadded, 1)
+                 && inFile(cm.scalesOffset, uint64_t(cm.rowsPadded) * sizeof(float), sizeof(float));
+            if (ok) matrices.push_back(cm);
+        }
+        if (!ok) {
+            LOGE("NeuralNet.loadMapped(): %s: bad layer %u", path.c_str(), i);
+            return false;
+        }
+        l.weightOffset = cl.paramsOffset / sizeof(float);
+        prevOut = l.out;
+    }
+
+    mInputSize  = static_cast<int32_t>(hdr.inputSize);
+    mLayers     = std::move(layers);
+    mWeights.clear();
+    mWeights.shrink_to_fit();
+    mParams     = reinterpret_cast<const float*>(base);
+    mParamCount = 0;
+    for (const Layer& l : mLayers) mParamCount += paramCount(l);
+    mMapped         = std::move(file);
+    mMappedPacking  = static_cast<quant::Packing>(hdr.packing);
+    mMappedMatrices = std::move(matrices);
+    dropQuantized();
+    return planMemory();
+}
+
+bool NeuralNet::save(const std::string& path, quant::Packing packing) const {
+    using namespace weights;
+    if (mLayers.empty()) return false;
+    const quant::Kernel packFor = (packing == quant::Packing::Tile4x4) ? quant::Kernel::NeonDot
+                                                                       : quant::Kernel::Scalar;
+    // Lay out every section, quantizing as we go
+    std::vector<ContainerLayer> table(mLayers.size());
+    std::vector<quant::QMatrix> qs;
+    uint64_t off = alignUp(sizeof(ContainerHeader) + table.size() * sizeof(ContainerLayer));
+    for (size_t i = 0; i < mLayers.size(); ++i) {
+        const Layer& l = mLayers[i];
+        ContainerLayer& cl = table[i];
+        std::memset(&cl, 0, sizeof(cl));
+        cl.type   = static_cast<uint32_t>(l.type);
+        cl.act    = static_cast<uint32_t>(l.act);
+        cl.in     = static_cast<uint32_t>(l.in);
+        cl.out    = static_cast<uint32_t>(l.out);
+        cl.kernel = static_cast<uint32_t>(l.kernel);
+        cl.paramsOffset = off;
+        off = alignUp(off + paramCount(l) * sizeof(float));
+        const float* W = mParams + l.weightOffset;
+        cl.numMatrices = (l.type == LayerType::Dense) ? 1 : (l.type == LayerType::Gru) ? 2 : 0;
+        for (uint32_t m = 0; m < cl.numMatrices; ++m) {
+            const int32_t rows = (l.type == LayerType::Gru) ? 3 * l.out : l.out;
+            const int32_t cols = (m == 0) ? l.in : l.out;
+            qs.emplace_back();
+            quant::quantize(m == 0 ? W : W + static_cast<size_t>(3 * l.out) * l.in, rows, cols,
+                            qs.back(), packFor);
+            ContainerMatrix& cm = cl.matrices[m];
+            cm.rows       = static_cast<uint32_t>(rows);
+            cm.cols       = static_cast<uint32_t>(cols);
+            cm.rowsPadded = static_cast<uint32_t>(qs.back().rowsPadded);
+            cm.colsPadded = static_cast<uint32_t>(qs.back().colsPadded);
+            cm.dataOffset = off;
+            off = alignUp(off + qs.back().packedBytes());
+            cm.scalesOffset = off;
+            off = alignUp(off + cm.rowsPadded * sizeof(float));
+        }
+    }
+
+    std::vector<uint8_t> bytes(off, 0);
+    size_t q = 0;
+    for (size_t i = 0; i < mLayers.size(); ++i) {
+        const ContainerLayer& cl = table[i];
+        std::memcpy(bytes.data() + cl.paramsOffset, mParams + mLayers[i].weightOffset,
+                    paramCount(mLayers[i]) * sizeof(float));
+        for (uint32_t m = 0; m < cl.numMatrices; ++m, ++q) {
+            std::memcpy(bytes.data() + cl.matrices[m].dataOffset, qs[q].weights(), qs[q].packedBytes());
+            std::memcpy(bytes.data() + cl.matrices[m].scalesOffset, qs[q].rowScales(),
+                        cl.matrices[m].rowsPadded * sizeof(float));
+        }
+    }
+    const size_t tableBytes = table.size() * sizeof(ContainerLayer);
+    std::memcpy(bytes.data() + sizeof(ContainerHeader), table.data(), tableBytes);
+    const uint64_t tableEnd = sizeof(ContainerHeader) + tableBytes;
+
+    ContainerHeader hdr;
+    std::memset(&hdr, 0, sizeof(hdr));
+    std::memcpy(hdr.magic, kMagic, 4);
+    hdr.version         = kVersion;
+    hdr.headerBytes     = sizeof(ContainerHeader);
+    hdr.numLayers       = static_cast<uint32_t>(mLayers.size());
+    hdr.inputSize       = static_cast<uint32_t>(mInputSize);
+    hdr.packing         = static_cast<uint32_t>(packing);
+    hdr.fileBytes       = off;
+    hdr.tableChecksum   = checksum(bytes.data() + sizeof(ContainerHeader), tableBytes);
+    hdr.payloadChecksum = checksum(bytes.data() + tableEnd, off - tableEnd);
+    std::memcpy(bytes.data(), &hdr, sizeof(hdr));
+
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (f == nullptr) {
+        LOGE("NeuralNet.save(): cannot open %s", path.c_str());
+        return false;
+    }
+    const bool ok = std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    return (std::fclose(f) == 0) && ok;
+}
+
+bool NeuralNet::planMemory() {
+    // Two ping-pong activation buffers sized for the widest vector, one gate
+    // scratch for the widest GRU, then each layer's persistent state.
+    mActSize = static_cast<size_t>(mInputSize);
+    size_t scratch = 0;
+    for (const Layer& l : mLayers) {
+        mActSize = std::max(mActSize, static_cast<size_t>(l.out));
+        if (l.type == LayerType::Gru) scratch = std::max(scratch, static_cast<size_t>(6 * l.out));
+    }
+    mScratchOffset = 2 * mActSize;
+    size_t stateOffset = mScratchOffset + scratch;
+    for (Layer& l : mLayers) {
+        l.stateSize = (l.type == LayerType::Gru)    ? l.out
+                    : (l.type == LayerType::Conv1d) ? (l.kernel - 1) * l.in
+                    : 0;
+        l.stateOffset = stateOffset;
+        stateOffset += static_cast<size_t>(l.stateSize);
+    }
+    mArena.assign(stateOffset, 0.0f);
+    mCur = 0;
+    return true;
+}
+
+bool NeuralNet::quantize(quant::Kernel k) {
+    if (mLayers.empty()) return false;
+    mQ.clear();
+    mQIndex.assign(mLayers.size(), -1);
+    size_t actLen = 0;
+    // Mapped matrices already packed this way are used in place
+    const bool inPlace = mMapped && !mMappedMatrices.empty() && quant::packingOf(k) == mMappedPacking;
+    auto add = [&](const float* W, int32_t rows, int32_t cols) {
+        mQ.emplace_back();
+        if (inPlace) {
+            const weights::ContainerMatrix& cm = mMappedMatrices[mQ.size() - 1];
+            quant::wrap(reinterpret_cast<const int8_t*>(mMapped->data() + cm.dataOffset),
+                        reinterpret_cast<const float*>(mMapped->data() + cm.scalesOffset),
+                        rows, cols, mMappedPacking, k, mQ.back());
+        } else {
+            quant::quantize(W, rows, cols, mQ.back(), k);
+        }
+        actLen = std::max(actLen, static_cast<size_t>(mQ.back().colsPadded));
+    };
+    for (size_t i = 0; i < mLayers.size(); ++i) {
+        const Layer& l = mLayers[i];
+        const float* W = mParams + l.weightOffset;
+        if (l.type == LayerType::Dense) {
+            mQIndex[i] = static_cast<int32_t>(mQ.size());
+            add(W, l.out, l.in);
+        } else if (l.type == LayerType::Gru) {
+            mQIndex[i] = static_cast<int32_t>(mQ.size());
+            add(W, 3 * l.out, l.in);
+            add(W + static_cast<size_t>(3 * l.out) * l.in, 3 * l.out, l.out);
+        }
+    }
+    if (mQ.empty()) {
+        dropQuantized();
+        return false;
+    }
+    mQAct.assign(actLen, 0);
+    return true;
+}
+
+void NeuralNet::dropQuantized() {
+    mQ.clear();
+    mQIndex.clear();
+    mQAct.clear();
+}
+
+size_t NeuralNet::quantizedBytes() const {
+    size_t bytes = 0;
+    for (const quant::QMatrix& q : mQ) bytes += q.packedBytes() + q.rowsPadded * sizeof(float);
+    return bytes;
+}
+
+void NeuralNet::resetState() {
+    for (const Layer& l : mLayers) {
+        std::fill_n(mArena.begin() + l.stateOffset, l.stateSize, 0.0f);
+    }
+}
+
+const float* NeuralNet::runLayers(const float* input, int32_t first, int32_t last) {
+    const float* x = (first == 0) ? input : act(mCur);
+    int32_t dst = (first == 0) ? 0 : 1 - mCur;
+    for (int32_t i = first; i < last; ++i) {
+        const Layer& l = mLayers[i];
+        float* y = act(dst);
+        switch (l.type) {
+            case LayerType::Dense:  dense(l, x, y);  break;
+            case LayerType::Gru:    gru(l, x, y);    break;
+            case LayerType::Conv1d: conv1d(l, x, y); break;
+        }
+        activate(l.act, y, l.out);
+        mCur = dst;
+        x = y;
+        dst = 1 - dst;
+    }
+    return x;
+}
+
+void NeuralNet::dense(const Layer& l, const float* x, float* y) {
+    const float* W = mParams + l.weightOffset;
+    const float* b = W + static_cast<size_t>(l.out) * l.in;
+    const int32_t qi = mQ.empty() ? -1 : mQIndex[&l - mLayers.data()];
+    if (qi >= 0) {
+        const quant::QMatrix& A = mQ[qi];
+        const float xs = quant::quantizeVector(x, l.in, mQAct.data(), A.colsPadded);
+        quant::gemvInt8(A, mQAct.data(), xs, b, y);
+        return;
+    }
+    for (int32_t o = 0; o < l.out; ++o) {
+        const float* w = W + static_cast<size_t>(o) * l.in;
+        float acc = 0.0f;
+        for (int32_t i = 0; i < l.in; ++i) acc += w[i] * x[i];
+        y[o] = acc + b[o];
+    }
+}
+
+static inline float sigmoid(float v) { return 1.0f / (1.0f + std::exp(-v)); }
+
+void NeuralNet::gru(const Layer& l, const float* x, float* y) {
+    const int32_t H = l.out;
+    const float* Wih = mParams + l.weightOffset;
+    const float* Whh = Wih + static_cast<size_t>(3 * H) * l.in;
+    const float* bih = Whh + static_cast<size_t>(3 * H) * H;
+    const float* bhh = bih + 3 * H;
+    float* h  = mArena.data() + l.stateOffset;
+    float* gi = mArena.data() + mScratchOffset;
+    float* gh = gi + 3 * H;
+
+    const int32_t qi = mQ.empty() ? -1 : mQIndex[&l - mLayers.data()];
+    if (qi >= 0) {
+        const quant::QMatrix& Ai = mQ[qi];
+        const quant::QMatrix& Ah = mQ[qi + 1];
+        const float xs = quant::quantizeVector(x, l.in, mQAct.data(), Ai.colsPadded);
+        quant::gemvInt8(Ai, mQAct.data(), xs, bih, gi);
+        const float hs = quant::quantizeVector(h, H, mQAct.data(), Ah.colsPadded);
+        quant::gemvInt8(Ah, mQAct.data(), hs, bhh, gh);
+    } else {
+        for (int32_t g = 0; g < 3 * H; ++g) {
+            const float* wi = Wih + static_cast<size_t>(g) * l.in;
+            float acc = 0.0f;
+            for (int32_t i = 0; i < l.in; ++i) acc += wi[i] * x[i];
+            gi[g] = acc + bih[g];
+            const float* wh = Whh + static_cast<size_t>(g) * H;
+            float acch = 0.0f;
+            for (int32_t j = 0; j < H; ++j) acch += wh[j] * h[j];
+            gh[g] = acch + bhh[g];
+        }
+    }
+    for (int32_t j = 0; j < H; ++j) {
+        const float r = sigmoid(gi[j] + gh[j]);
+        const float z = sigmoid(gi[H + j] + gh[H + j]);
+        const float n = std::tanh(gi[2 * H + j] + r * gh[2 * H + j]);
+        h[j] = (1.0f - z) * n + z * h[j];
+        y[j] = h[j];
+    }
+}
+
+void NeuralNet::conv1d(const Layer& l, const float* x, float* y) {
+    const int32_t K = l.kernel;
+    const float* W = mParams + l.weightOffset;
+    const float* b = W + static_cast<size_t>(l.out) * l.in * K;
+    float* hist = mArena.data() + l.stateOffset; // (K-1) past inputs, oldest first
+    for (int32_t o = 0; o < l.out; ++o) {
+        float acc = 0.0f;
+        for (int32_t c = 0; c < l.in; ++c) {
+            const float* w = W + (static_cast<size_t>(o) * l.in + c) * K;
+            for (int32_t k = 0; k < K - 1; ++k) acc += w[k] * hist[static_cast<size_t>(k) * l.in + c];
+            acc += w[K - 1] * x[c];
+        }
+        y[o] = acc + b[o];
+    }
+    if (K > 1) {
+        std::memmove(hist, hist + l.in, static_cast<size_t>(K - 2) * l.in * sizeof(float));
+        std::memcpy(hist + static_cast<size_t>(K - 2) * l.in, x, static_cast<size_t>(l.in) * sizeof(float));
+    }
+}
+
+void NeuralNet::activate(Activation a, float* y, int32_t n) {
+    switch (a) {
+        case Activation::None: break;
+        case Activation::Relu:
+            for (int32_t i = 0; i < n; ++i) y[i] = y[i] > 0.0f ? y[i] : 0.0f;
+            break;
+        case Activation::Sigmoid:
+            for (int32_t i = 0; i < n; ++i) y[i] = sigmoid(y[i]);
+            break;
+        case Activation::Tanh:
+            for (int32_t i = 0; i < n; ++i) y[i] = std::tanh(y[i]);
+            break;
+    }
+}
@@ -0,0 +1,126 @@
+// NeuralNet.h
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <string>
+#include "QuantKernels.h"
+#include "WeightContainer.h"
+
+/**
+ * Minimal streaming CPU inference for small per-hop networks (one input
+ * vector per STFT hop, one output vector back).
+ *
+ * Layers: Dense, GRU (PyTorch gate order r, z, n) and causal Conv1d over
+ * hops. Recurrent / convolution state persists across step() calls.
+ *
+ * Memory plan: load() computes the size of every activation, state and
+ * scratch buffer and allocates them as one arena; step() only reads weights
+ * and writes into that arena (no allocation, no locks).
+ *
+ * Weight file (little endian):
+ *   char[4] "NNW1", u32 numLayers, u32 inputSize
+ *   per layer: u32 type, u32 activation, u32 outputSize, u32 kernel (Conv1d, else 0)
+ *              then the float32 parameters, in the order listed for LayerType
+ *
+ * loadMapped() instead maps an "NNWM" container (see WeightContainer.h) and
+ * runs from it in place, including the int8 matrices when their packing
+ * matches the kernel.
+ *
+ * quantize() optionally converts the Dense and GRU matrices to int8 (per-row
+ * scales, see QuantKernels.h); activations are then quantized per vector on
+ * the fly. Conv1d layers and all biases stay float.
+ */
+class NeuralNet {
+public:
+    enum class LayerType : uint32_t {
+        Dense  = 0, // W[out][in], b[out]
+        Gru    = 1, // W_ih[3*out][in], W_hh[3*out][out], b_ih[3*out], b_hh[3*out]
+        Conv1d = 2, // W[out][in][kernel] (tap kernel-1 = current hop), b[out]
+    };
+    enum class Activation : uint32_t { None = 0, Relu = 1, Sigmoid = 2, Tanh = 3 };
+
+    struct Layer {
+        LayerType  type = LayerType::Dense;
+        Activation act  = Activation::None;
+        int32_t    in   = 0;
+        int32_t    out  = 0;
+        int32_t    kernel = 0;
+        size_t     weightOffset = 0;  // into mWeights
+        size_t     stateOffset  = 0;  // into mArena (GRU h, Conv1d input history)
+        int32_t    stateSize    = 0;
+    };
+
+    // Copies the whole file into memory; "NNWM" files are handed to loadMapped().
+    // Returns false (and logs) on any error.
+    bool load(const std::string& path);
+
+    // Maps an NNWM container read-only and uses it in place. The layer table
+    // checksum is always checked; verifyPayload also checks (and pages in) the rest.
+    bool loadMapped(const std::string& path, bool verifyPayload = false);
+
+    // Writes the loaded network as an NNWM container, int8 matrices packed for 'packing'.
+    bool save(const std::string& path, quant::Packing packing) const;
+
+    // Builds a network from already-parsed layers and parameters (same layout as the file).
+    bool build(int32_t inputSize, std::vector<Layer> layers, std::vector<float> weights);
+
+    bool    isLoaded()   const { return !mLayers.empty(); }
+    int32_t inputSize()  const { return mInputSize; }
+    int32_t outputSize() const { return mLayers.empty() ? 0 : mLayers.back().out; }
+    int32_t numLayers()  const { return static_cast<int32_t>(mLayers.size()); }
+    size_t  arenaBytes() const { return mArena.size() * sizeof(float); }
+    size_t  weightBytes() const { return mParamCount * sizeof(float); }
+    bool    isMapped()    const { return mMapped != nullptr; }
+
+    const Layer& layer(int32_t i) const { return mLayers[i]; }
+
+    // Packs int8 copies of the Dense/GRU matrices for kernel k; later steps use them.
+    bool quantize(quant::Kernel k);
+    void dropQuantized();
+    bool isQuantized() const { return !mQ.empty(); }
+    size_t quantizedBytes() const;
+
+    // Clears recurrent and convolution state.
+    void resetState();
+
+    // Runs layers [first, last) on the current activation; step 0 takes 'input'.
+    // Splitting lets the caller check a time budget between layers.
+    // Returns the output of layer last-1 (valid until the next call).
+    const float* runLayers(const float* input, int32_t first, int32_t last);
+
+    // Whole network for one hop.
+    const float* step(const float* input) { return runLayers(input, 0, numLayers()); }
+
+private:
+    int32_t            mInputSize = 0;
+    std::vector<Layer> mLayers;
+    std::vector<float> mWeights;     // copy loader storage
+    const float*       mParams = nullptr; // mWeights or the mapping; Layer::weightOffset indexes it
+    size_t             mParamCount = 0;
+
+    // Mapped container, plus its int8 matrices in mQ order
+    std::shared_ptr<const weights::MappedFile> mMapped;
+    quant::Packing                             mMappedPacking = quant::Packing::RowMajor;
+    std::vector<weights::ContainerMatrix>      mMappedMatrices;
+
+    // Int8 path: per layer, Dense W or GRU W_ih then W_hh (index mQIndex[layer])
+    std::vector<quant::QMatrix> mQ;
+    std::vector<int32_t>        mQIndex;
+    std::vector<int8_t>         mQAct;   // quantized activation, widest colsPadded
+
+    // Arena: [act A | act B | gate scratch | per-layer state ...]
+    std::vector<float> mArena;
+    size_t             mActSize = 0;
+    size_t             mScratchOffset = 0;
+    int32_t            mCur = 0;  // which activation buffer holds the latest output
+
+    bool planMemory();
+    float* act(int32_t i) { return mArena.data() + static_cast<size_t>(i) * mActSize; }
+
+    void dense (const Layer& l, const float* x, float* y);
+    void gru   (const Layer& l, const float* x, float* y);
+    void conv1d(const Layer& l, const float* x, float* y);
+    static void activate(Activation a, float* y, int32_t n);
+};
@@ -0,0 +1,52 @@
+// OboeAudioPort.cpp
+#include "OboeAudioPort.h"
+#include "EngineLog.h"
+
+bool OboeStreamPort::requestStart() {
+    const oboe::Result r = mStream->requestStart();
+    LOGI("OboeStreamPort: requestStart(%s) -> %s", oboe::convertToText(mStream->getDirection()),
+         oboe::convertToText(r));
+    return r == oboe::Result::OK;
+}
+
+bool OboeStreamPort::requestStop() {
+    const oboe::Result r = mStream->requestStop();
+    if (r != oboe::Result::OK) {
+        LOGW("OboeStreamPort: requestStop(%s) -> %s", oboe::convertToText(mStream->getDirection()),
+             oboe::convertToText(r));
+        return false;
+    }
+    return true;
+}
+
+int32_t OboeStreamPort::read(float* data, int32_t frames, int64_t timeoutNanos) {
+    oboe::ResultWithValue<int32_t> res = mStream->read(data, frames, timeoutNanos);
+    if (!res) return -1;
+    return res.value();
+}
+
+bool OboeDuplexDriver::start(audio::DuplexCallback* callback) {
+    if (!FullDuplexPass::inputFitsScratch(*mIn, *mOut)) {
+        LOGE("OboeDuplexDriver: %d input channels do not fit the %d-channel output's duplex buffer",
+             mIn->getChannelCount(), mOut->getChannelCount());
+        return false;
+    }
+    mPass = std::make_unique<Pass>(callback);
+    mPass->setSharedInputStream(mIn);
+    mPass->setSharedOutputStream(mOut);
+    const oboe::Result r = mPass->start();
+    LOGI("OboeDuplexDriver: FullDuplexStream start -> %s", oboe::convertToText(r));
+    if (r != oboe::Result::OK) {
+        mPass.reset();
+        return false;
+    }
+    return true;
+}
+
+void OboeDuplexDriver::stop() {
+    if (!mPass) return;
+    const oboe::Result r = mPass->stop(); // both streams
+    if (r != oboe::Result::OK) {
+        LOGW("OboeDuplexDriver: FullDuplexStream stop -> %s", oboe::convertToText(r));
+    }
+}
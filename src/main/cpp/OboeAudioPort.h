@@ -0,0 +1,60 @@
+// OboeAudioPort.h
+#pragma once
+#include <memory>
+#include <oboe/Oboe.h>
+#include "AudioPort.h"
+#include "FullDuplexPass.h"
+
+// audio::Stream over an opened Oboe stream (float format)
+class OboeStreamPort : public audio::Stream {
+public:
+    explicit OboeStreamPort(std::shared_ptr<oboe::AudioStream> stream) : mStream(std::move(stream)) {}
+
+    int32_t channelCount() const override { return mStream->getChannelCount(); }
+    int32_t sampleRate() const override { return mStream->getSampleRate(); }
+    int32_t framesPerBurst() const override { return mStream->getFramesPerBurst(); }
+
+    bool requestStart() override;
+    bool requestStop() override;
+    int32_t read(float* data, int32_t frames, int64_t timeoutNanos) override;
+
+private:
+    std::shared_ptr<oboe::AudioStream> mStream;
+};
+
+// Callback mode on Oboe: an oboe::FullDuplexStream that starts input before
+// output and reads input without blocking inside the output callback. The
+// output stream's data callback must forward to onAudioReady(). start()
+// refuses an input with more channels than the output (see FullDuplexPass).
+class OboeDuplexDriver : public audio::DuplexDriver {
+public:
+    OboeDuplexDriver(std::shared_ptr<oboe::AudioStream> in, std::shared_ptr<oboe::AudioStream> out)
+            : mIn(std::move(in)), mOut(std::move(out)) {}
+
+    bool start(audio::DuplexCallback* callback) override;
+    void stop() override;
+
+    oboe::DataCallbackResult onAudioReady(oboe::AudioStream* stream, void* audioData, int32_t numFrames) {
+        return mPass ? mPass->onAudioReady(stream, audioData, numFrames)
+                     : oboe::DataCallbackResult::Continue;
+    }
+
+private:
+    class Pass : public FullDuplexPass {
+    public:
+        explicit Pass(audio::DuplexCallback* cb) : mCallback(cb) {}
+        oboe::DataCallbackResult onBothStreamsReady(const void* inputData, int numInputFrames,
+                                                    void* outputData, int numOutputFrames) override {
+            assertInputFits(numInputFrames, numOutputFrames);
+            mCallback->onDuplex(static_cast<const float*>(inputData), numInputFrames,
+                                static_cast<float*>(outputData), numOutputFrames);
+            return oboe::DataCallbackResult::Continue;
+        }
+    private:
+        audio::DuplexCallback* mCallback;
+    };
+
+    std::shared_ptr<oboe::AudioStream> mIn;
+    std::shared_ptr<oboe::AudioStream> mOut;
+    std::unique_ptr<Pass> mPass;   // kept after stop(): late callbacks may still arrive
+};
@@ -0,0 +1,68 @@
+// OfflineBatch.cpp
+#include "OfflineBatch.h"
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <sys/stat.h>
+#include "EngineLog.h"
+
+namespace offline {
+
+bool BatchRunner::configure(const Options& options, int32_t workers) {
+    mPool.reset();
+    mDrivers.clear();
+    const int32_t n = std::max(1, workers);
+    for (int32_t i = 0; i < n; ++i) {
+        mDrivers.push_back(std::make_unique<Driver>());
+        if (!mDrivers.back()->configure(options)) {
+            mDrivers.clear();
+            return false;
+        }
+    }
+    mPool = std::make_unique<WorkStealingPool>(n);
+    return true;
+}
+
+BatchSummary BatchRunner::run(const std::vector<BatchJob>& jobs, std::vector<BatchResult>& results) {
+    BatchSummary summary;
+    summary.workers = workers();
+    summary.jobs = static_cast<int64_t>(jobs.size());
+    results.assign(jobs.size(), BatchResult{});
+    if (!mPool) return summary;
+
+    // Largest first; ties keep the job order
+    std::vector<int64_t> sizes(jobs.size(), 0);
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        struct stat st {};
+        if (stat(jobs[i].input.c_str(), &st) == 0) sizes[i] = static_cast<int64_t>(st.st_size);
+    }
+    std::vector<int64_t> order(jobs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](int64_t a, int64_t b) { return sizes[size_t(a)] > sizes[size_t(b)]; });
+
+    const uint64_t steals0 = mPool->steals();
+    const auto t0 = std::chrono::steady_clock::now();
+    mPool->run(summary.jobs, [&](int64_t index, int32_t worker) {
+        const BatchJob& job = jobs[size_t(index)];
+        BatchResult& r = results[size_t(index)];
+        r.ok = mDrivers[size_t(worker)]->process(job.input, job.output, r.result);
+        if (!r.ok) LOGE("offline::BatchRunner: %s failed", job.input.c_str());
+    }, order);
+    summary.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    summary.steals = mPool->steals() - steals0;
+
+    uint64_t digest = 1469598103934665603ULL;
+    for (const BatchResult& r : results) {
+        if (r.ok) {
+            summary.audioSeconds += r.result.audioSeconds();
+        } else {
+            ++summary.failed;
+        }
+        digest = (digest ^ (r.ok ? r.result.outputDigest : 0)) * 1099511628211ULL;
+    }
+    summary.digest = digest;
+    return summary;
+}
+
+} // namespace offline
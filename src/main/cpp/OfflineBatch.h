@@ -0,0 +1,62 @@
+// OfflineBatch.h
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "OfflineDriver.h"
+#include "WorkStealingPool.h"
+
+/**
+ * Many files through the offline chain at once: a WorkStealingPool with one
+ * offline::Driver per worker (its own engine, buffers and file I/O, reused
+ * from file to file). Jobs start largest input first so that the long ones
+ * do not end up last. Results land in the job's slot, whichever worker ran
+ * it, so the merged results, and every output file, are the same for any
+ * worker count.
+ */
+namespace offline {
+
+struct BatchJob {
+    std::string input;
+    std::string output;                  // empty: output discarded
+};
+
+struct BatchResult {
+    bool   ok = false;
+    Result result;
+};
+
+struct BatchSummary {
+    int32_t workers = 0;
+    int64_t jobs = 0;
+    int64_t failed = 0;
+    double  audioSeconds = 0.0;          // over the jobs that completed
+    double  wallSeconds = 0.0;
+    uint64_t steals = 0;
+    uint64_t digest = 0;                 // per-job output digests combined in job order
+
+    // Seconds of audio per second of wall time, all workers together
+    double throughput() const { return wallSeconds > 0.0 ? audioSeconds / wallSeconds : 0.0; }
+};
+
+class BatchRunner {
+public:
+    BatchRunner() = default;
+    BatchRunner(const BatchRunner&) = delete;
+    BatchRunner& operator=(const BatchRunner&) = delete;
+
+    // Starts 'workers' threads, each with a Driver configured from options
+    bool configure(const Options& options, int32_t workers);
+
+    // Runs every job; results[i] belongs to jobs[i]
+    BatchSummary run(const std::vector<BatchJob>& jobs, std::vector<BatchResult>& results);
+
+    int32_t workers() const { return mPool ? mPool->workers() : 0; }
+
+private:
+    std::vector<std::unique_ptr<Driver>> mDrivers;   // one per worker
+    std::unique_ptr<WorkStealingPool> mPool;
+};
+
+} // namespace offline
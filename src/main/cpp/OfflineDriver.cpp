@@ -0,0 +1,174 @@
+// OfflineDriver.cpp
+#include "OfflineDriver.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "EngineLog.h"
+
+namespace offline {
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+} // namespace
+
+bool Driver::configure(const Options& options) {
+    mOptions = options;
+    mOptions.framesPerBurst = std::max(1, mOptions.framesPerBurst);
+    mOptions.blockBursts = std::max(1, mOptions.blockBursts);
+
+    mDuplex = std::make_shared<audio::ManualDuplexDriver>();
+    mEngine.setIoMode(FullDuplexEngine::IoMode::Callback);
+    mEngine.setDuplexDriver(mDuplex);
+    mEngine.setStftRate(mOptions.stftRate);
+    mEngine.setStereoStft(mOptions.stereoStft);
+    mEngine.setLowLatencyStft(mOptions.lowLatencyStft);
+    mEngine.setBurstAlignedHop(mOptions.burstAlignedHop);
+    if (!mOptions.maskModel.empty() &&
+        !mEngine.loadMaskModel(mOptions.maskModel, mOptions.maskBudgetMicros, mOptions.maskQuantized)) {
+        LOGE("offline::Driver: cannot load mask model %s", mOptions.maskModel.c_str());
+        return false;
+    }
+    LogMelProcessor::Config mel;
+    // Room for a whole block: hops are at least 16 device frames
+    mel.ringFrames = std::max(mel.ringFrames, mOptions.blockBursts * mOptions.framesPerBurst / 16 + 1);
+    mEngine.setLogMelFeatures(!mOptions.logMelPath.empty(), mel);
+    return true;
+}
+
+bool Driver::drainLogMel(Result& result) {
+    LogMelProcessor* mel = mEngine.logMelFeatures();
+    if (mel == nullptr || mMelFile == nullptr) return true;
+    RingBuffer& ring = mel->features();
+    mMel.resize(static_cast<size_t>(ring.capacityFrames()) * mel->numMels());
+    const int32_t n = ring.readInterleaved(mMel.data(), ring.capacityFrames());
+    const size_t count = static_cast<size_t>(n) * mel->numMels();
+    result.logMelFrames += n;
+    if (std::fwrite(mMel.data(), sizeof(float), count, mMelFile) != count) {
+        LOGE("offline::Driver: error writing %s", mOptions.logMelPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Driver::process(const std::string& inPath, const std::string& outPath, Result& result) {
+    if (!mReader.open(inPath, mOptions.rawFormat)) return false;
+    bool ok;
+    if (outPath.empty()) {
+        ok = process(mReader, nullptr, result);
+    } else {
+        const audio::AudioFormat& in = mReader.format();
+        const int32_t outCh = mOptions.outputChannels > 0 ? mOptions.outputChannels : in.channels;
+        ok = mWriter.open(outPath, {outCh, in.sampleRate}) && process(mReader, &mWriter, result);
+        if (!mWriter.close() && ok) {
+            LOGE("offline::Driver: error writing %s", outPath.c_str());
+            ok = false;
+        }
+    }
+    mReader.close();
+    return ok;
+}
+
+bool Driver::process(audio::AudioFileReader& reader, audio::AudioFileWriter* writer, Result& result) {
+    const auto wall0 = std::chrono::steady_clock::now();
+    const audio::AudioFormat fmt = reader.format();
+    const int32_t fpb = mOptions.framesPerBurst;
+    const int32_t inCh = fmt.channels;
+    const int32_t outCh = mOptions.outputChannels > 0 ? mOptions.outputChannels : inCh;
+    const int32_t blockFrames = mOptions.blockBursts * fpb;
+    result = Result{};
+    result.sampleRate = fmt.sampleRate;
+    result.inputChannels = inCh;
+    result.outputChannels = outCh;
+
+    // The engine only takes the format from the streams in callback mode
+    mEngine.setSharedInputStream(std::make_shared<audio::NullOutputStream>(inCh, fmt.sampleRate, fpb));
+    mEngine.setSharedOutputStream(std::make_shared<audio::NullOutputStream>(outCh, fmt.sampleRate, fpb));
+    if (!mEngine.start()) return false;
+    if (!mOptions.logMelPath.empty()) {
+        mMelFile = std::fopen(mOptions.logMelPath.c_str(), "wb");
+        if (mMelFile == nullptr) {
+            LOGE("offline::Driver: cannot create %s", mOptions.logMelPath.c_str());
+            mEngine.stop();
+            return false;
+        }
+    }
+    result.latencyFrames = mEngine.algorithmicLatencyFrames() + mEngine.primedFrames();
+
+    mIn.resize(static_cast<size_t>(blockFrames) * inCh);
+    mOut.resize(static_cast<size_t>(blockFrames) * outCh);
+    int64_t skip = mOptions.compensateLatency ? result.latencyFrames : 0;
+    int64_t consumed = 0;   // input frames read from the file
+    int64_t written = 0;    // output frames kept
+    bool end = false;
+    bool ok = true;
+    double processSeconds = 0.0;
+    uint64_t digest = 1469598103934665603ULL;
+
+    // Until the output has caught up with the input; after the end of the
+    // file, silence flushes the delayed tail
+    while (ok && (!end || written < consumed)) {
+        int32_t frames = blockFrames;
+        if (!end) {
+            const int32_t n = reader.read(mIn.data(), blockFrames);
+            if (n < 0) {
+                LOGE("offline::Driver: read error");
+                ok = false;
+                break;
+            }
+            consumed += n;
+            end = n < blockFrames;
+            // Whole bursts only, padded with silence
+            frames = (n + fpb - 1) / fpb * fpb;
+            std::fill(mIn.begin() + static_cast<size_t>(n) * inCh,
+                      mIn.begin() + static_cast<size_t>(frames) * inCh, 0.0f);
+            if (frames == 0) continue;
+        } else {
+            std::fill(mIn.begin(), mIn.end(), 0.0f);
+        }
+
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int32_t f = 0; f < frames; f += fpb) {
+            const size_t i = static_cast<size_t>(f);
+            (void)mDuplex->process(mIn.data() + i * inCh, fpb, mOut.data() + i * outCh, fpb);
+        }
+        processSeconds += secondsSince(t0);
+
+        // Drop the delay at the front, keep no more than was read
+        const int32_t first = static_cast<int32_t>(std::min<int64_t>(skip, frames));
+        skip -= first;
+        const int32_t keep = static_cast<int32_t>(std::min<int64_t>(frames - first, consumed - written));
+        const float* kept = mOut.data() + static_cast<size_t>(first) * outCh;
+        for (size_t i = 0; i < static_cast<size_t>(std::max(0, keep)) * outCh; ++i) {
+            uint32_t bits;
+            std::memcpy(&bits, &kept[i], sizeof(bits));
+            digest = (digest ^ bits) * 1099511628211ULL;
+        }
+        if (keep > 0 && writer &&
+            !writer->write(kept, keep)) {
+            LOGE("offline::Driver: write error");
+            ok = false;
+        }
+        written += std::max(0, keep);
+        ok = ok && drainLogMel(result);
+    }
+    mEngine.stop();
+    if (mMelFile != nullptr) {
+        if (std::fclose(mMelFile) != 0 && ok) {
+            LOGE("offline::Driver: error writing %s", mOptions.logMelPath.c_str());
+            ok = false;
+        }
+        mMelFile = nullptr;
+    }
+
+    result.frames = consumed;
+    result.processSeconds = processSeconds;
+    result.outputDigest = digest;
+    result.wallSeconds = secondsSince(wall0);
+    return ok;
+}
+
+} // namespace offline
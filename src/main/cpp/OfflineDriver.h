@@ -0,0 +1,95 @@
+// OfflineDriver.h
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "AudioFile.h"
+#include "FullDuplexEngine.h"
+#include "HostAudioPort.h"
+
+/**
+ * Runs audio files through FullDuplexEngine as fast as the CPU allows, for
+ * host builds: the engine runs in callback mode and a ManualDuplexDriver
+ * hands it one device burst of input and output at a time, so the file
+ * goes through the same decimator, downmix, STFT, upsampler and upmix, with
+ * the same burst framing, as on a device.
+ *
+ * Files are streamed in blocks of blockBursts bursts; memory does not depend
+ * on their length. The output has the input's length. By default it is
+ * shifted by the chain's delay so that it lines up with the input; the last
+ * partial burst is padded with silence, as a device would deliver it.
+ *
+ * With logMelPath set, the engine's log-mel stage is attached and its
+ * features are appended to that file as they are produced.
+ *
+ * A Driver keeps its engine, buffers and file reader/writer across
+ * process() calls, so a run of many files allocates once; use one per
+ * thread (offline::BatchRunner keeps one per worker).
+ */
+namespace offline {
+
+struct Options {
+    int32_t framesPerBurst = 96;
+    int32_t outputChannels = 0;          // 0: as the input
+    FullDuplexEngine::StftRate stftRate = FullDuplexEngine::StftRate::Resampled16k;
+    bool    stereoStft = false;
+    bool    lowLatencyStft = false;
+    bool    burstAlignedHop = true;
+    std::string maskModel;               // NeuralNet weight file, empty for none
+    bool    maskQuantized = true;
+    int32_t maskBudgetMicros = 0;        // per hop, 0 = none (nothing is skipped)
+    std::string logMelPath;              // log-mel features per hop (raw float32, numMels each), empty for none
+    bool    compensateLatency = true;    // drop the chain's delay from the output
+    int32_t blockBursts = 64;            // file I/O granularity
+    audio::AudioFormat rawFormat;        // for inputs without a WAV header
+};
+
+struct Result {
+    int64_t frames = 0;                  // input frames (= output frames)
+    int32_t sampleRate = 0;
+    int32_t inputChannels = 0;
+    int32_t outputChannels = 0;
+    int32_t latencyFrames = 0;           // chain delay (removed if compensated)
+    double  wallSeconds = 0.0;           // whole run, file I/O included
+    double  processSeconds = 0.0;        // inside the engine only
+    uint64_t outputDigest = 0;           // FNV-1a over the output samples' bits
+    int64_t logMelFrames = 0;            // feature frames written (Options::logMelPath)
+
+    double audioSeconds() const { return sampleRate > 0 ? double(frames) / sampleRate : 0.0; }
+    // Processing time per second of audio: < 1 is faster than real time
+    double realTimeFactor() const { return frames > 0 ? wallSeconds / audioSeconds() : 0.0; }
+};
+
+class Driver {
+public:
+    Driver() = default;
+    Driver(const Driver&) = delete;
+    Driver& operator=(const Driver&) = delete;
+
+    // Applies the options to the engine and loads the mask model, if any
+    bool configure(const Options& options);
+
+    // Streams inPath through the chain into outPath (empty: output discarded)
+    bool process(const std::string& inPath, const std::string& outPath, Result& result);
+    // Same, from an open reader into an optional open writer
+    bool process(audio::AudioFileReader& reader, audio::AudioFileWriter* writer, Result& result);
+
+    const Options& options() const { return mOptions; }
+
+private:
+    Options mOptions;
+    FullDuplexEngine mEngine;
+    std::shared_ptr<audio::ManualDuplexDriver> mDuplex;
+    std::vector<float> mIn;              // blockBursts * fpb * input channels
+    std::vector<float> mOut;             // blockBursts * fpb * output channels
+    audio::AudioFileReader mReader;
+    audio::AudioFileWriter mWriter;
+    std::vector<float> mMel;             // log-mel frames drained per block
+    FILE* mMelFile = nullptr;
+
+    bool drainLogMel(Result& result);
+};
+
+} // namespace offline
@@ -0,0 +1,340 @@
+// QuantKernels.cpp
+#include "QuantKernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define QK_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__)
+#define QK_ARM64 1
+#include <arm_neon.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#if defined(__clang__)
+#define QK_TARGET_DOTPROD __attribute__((target("dotprod")))
+#else
+#define QK_TARGET_DOTPROD __attribute__((target("+dotprod")))
+#endif
+#endif
+
+namespace quant {
+
+namespace {
+
+std::atomic<int> gSelected{static_cast<int>(Kernel::Scalar)};
+
+constexpr int32_t kRowBlock = 4;
+constexpr int32_t kColAlign = 32;
+constexpr int32_t kChunkRows = 256; // int32 accumulators kept on the stack
+
+// All kernels: acc[i] = dot(Wq[r0 + i], xq) for i in [0, n), n a multiple of 4.
+void dotScalar(const QMatrix& A, const int8_t* xq, int32_t r0, int32_t n, int32_t* acc) {
+    const int32_t C = A.colsPadded;
+    for (int32_t i = 0; i < n; ++i) {
+        const int8_t* w = A.weights() + static_cast<size_t>(r0 + i) * C;
+        int32_t s = 0;
+        for (int32_t c = 0; c < C; ++c) s += int32_t(w[c]) * int32_t(xq[c]);
+        acc[i] = s;
+    }
+}
+
+#if QK_X86
+__attribute__((target("avx2")))
+inline int32_t hsum(__m256i v) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+}
+
+// Weights with the sign of x applied, so |x| can be the unsigned operand
+__attribute__((target("avx2")))
+inline __m256i signedW(const int8_t* w, __m256i x) {
+    return _mm256_sign_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(w)), x);
+}
+
+__attribute__((target("avx2")))
+inline __m256i maddAvx2(__m256i acc, __m256i ax, __m256i sw) {
+    const __m256i p = _mm256_maddubs_epi16(ax, sw); // pairs <= 2 * 127 * 127, no saturation
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(p, _mm256_set1_epi16(1)));
+}
+
+__attribute__((target("avx2")))
+void dotAvx2(const QMatrix& A, const int8_t* xq, int32_t r0, int32_t n, int32_t* acc) {
+    const int32_t C = A.colsPadded;
+    for (int32_t i = 0; i < n; i += kRowBlock) {
+        const int8_t* w = A.weights() + static_cast<size_t>(r0 + i) * C;
+        __m256i a0 = _mm256_setzero_si256(), a1 = a0, a2 = a0, a3 = a0;
+        for (int32_t c = 0; c < C; c += 32) {
+            const __m256i x  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xq + c));
+            const __m256i ax = _mm256_sign_epi8(x, x);
+            a0 = maddAvx2(a0, ax, signedW(w + c, x));
+            a1 = maddAvx2(a1, ax, signedW(w + C + c, x));
+            a2 = maddAvx2(a2, ax, signedW(w + 2 * C + c, x));
+            a3 = maddAvx2(a3, ax, signedW(w + 3 * C + c, x));
+        }
+        acc[i]     = hsum(a0);
+        acc[i + 1] = hsum(a1);
+        acc[i + 2] = hsum(a2);
+        acc[i + 3] = hsum(a3);
+    }
+}
+
+__attribute__((target("avx2,avx512vnni,avx512vl")))
+void dotAvx512Vnni(const QMatrix& A, const int8_t* xq, int32_t r0, int32_t n, int32_t* acc) {
+    const int32_t C = A.colsPadded;
+    for (int32_t i = 0; i < n; i += kRowBlock) {
+        const int8_t* w = A.weights() + static_cast<size_t>(r0 + i) * C;
+        __m256i a0 = _mm256_setzero_si256(), a1 = a0, a2 = a0, a3 = a0;
+        for (int32_t c = 0; c < C; c += 32) {
+            const __m256i x  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xq + c));
+            const __m256i ax = _mm256_sign_epi8(x, x);
+            a0 = _mm256_dpbusd_epi32(a0, ax, signedW(w + c, x));
+            a1 = _mm256_dpbusd_epi32(a1, ax, signedW(w + C + c, x));
+            a2 = _mm256_dpbusd_epi32(a2, ax, signedW(w + 2 * C + c, x));
+            a3 = _mm256_dpbusd_epi32(a3, ax, signedW(w + 3 * C + c, x));
+        }
+        acc[i]     = hsum(a0);
+        acc[i + 1] = hsum(a1);
+        acc[i + 2] = hsum(a2);
+        acc[i + 3] = hsum(a3);
+    }
+}
+
+__attribute__((target("avx2,avxvnni")))
+void dotAvxVnni(const QMatrix& A, const int8_t* xq, int32_t r0, int32_t n, int32_t* acc) {
+    const int32_t C = A.colsPadded;
+    for (int32_t i = 0; i < n; i += kRowBlock) {
+        const int8_t* w = A.weights() + static_cast<size_t>(r0 + i) * C;
+        __m256i a0 = _mm256_setzero_si256(), a1 = a0, a2 = a0, a3 = a0;
+        for (int32_t c = 0; c < C; c += 32) {
+            const __m256i x  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xq + c));
+            const __m256i ax = _mm256_sign_epi8(x, x);
+            a0 = _mm256_dpbusd_avx_epi32(a0, ax, signedW(w + c, x));
+            a1 = _mm256_dpbusd_avx_epi32(a1, ax, signedW(w + C + c, x));
+            a2 = _mm256_dpbusd_avx_epi32(a2, ax, signedW(w + 2 * C + c, x));
+            a3 = _mm256_dpbusd_avx_epi32(a3, ax, signedW(w + 3 * C + c, x));
+        }
+        acc[i]     = hsum(a0);
+        acc[i + 1] = hsum(a1);
+        acc[i + 2] = hsum(a2);
+        acc[i + 3] = hsum(a3);
+    }
+}
+#endif // QK_X86
+
+#if QK_ARM64
+// Tiles of 4 rows x 4 columns (16 bytes, row-major inside the tile); one
+// sdot lane multiplies a tile by 4 activations and updates all 4 rows.
+QK_TARGET_DOTPROD
+void dotNeon(const QMatrix& A, const int8_t* xq, int32_t r0, int32_t n, int32_t* acc) {
+    const int32_t C = A.colsPadded;
+    for (int32_t i = 0; i < n; i += kRowBlock) {
+        const int8_t* p = A.weights() + static_cast<size_t>(r0 + i) * C;
+        int32x4_t a = vdupq_n_s32(0);
+        int32x4_t b = vdupq_n_s32(0);
+        for (int32_t c = 0; c < C; c += 16) {
+            const int8x16_t x = vld1q_s8(xq + c);
+            a = vdotq_laneq_s32(a, vld1q_s8(p),      x, 0);
+            b = vdotq_laneq_s32(b, vld1q_s8(p + 16), x, 1);
+            a = vdotq_laneq_s32(a, vld1q_s8(p + 32), x, 2);
+            b = vdotq_laneq_s32(b, vld1q_s8(p + 48), x, 3);
+            p += 64;
+        }
+        vst1q_s32(acc + i, vaddq_s32(a, b));
+    }
+}
+#endif // QK_ARM64
+
+// Byte offset of W[r][c] in the packed data
+inline size_t packedIndex(const QMatrix& A, int32_t r, int32_t c) {
+    if (packingOf(A.layout) == Packing::Tile4x4) {
+        const size_t tile = static_cast<size_t>(r / kRowBlock) * (A.colsPadded / 4) + c / 4;
+        return tile * 16 + (r % kRowBlock) * 4 + (c % 4);
+    }
+    return static_cast<size_t>(r) * A.colsPadded + c;
+}
+
+void dotScalarTiled(const QMatrix& A, const int8_t* xq, int32_t r0, int32_t n, int32_t* acc) {
+    const int8_t* w = A.weights();
+    for (int32_t i = 0; i < n; ++i) {
+        int32_t s = 0;
+        for (int32_t c = 0; c < A.colsPadded; ++c) s += int32_t(w[packedIndex(A, r0 + i, c)]) * int32_t(xq[c]);
+        acc[i] = s;
+    }
+}
+
+using DotFn = void (*)(const QMatrix&, const int8_t*, int32_t, int32_t, int32_t*);
+
+bool supportedCached(Kernel k) {
+    static const bool sSupported[] = {
+        isSupported(Kernel::Scalar), isSupported(Kernel::Avx2), isSupported(Kernel::Avx512Vnni),
+        isSupported(Kernel::AvxVnni), isSupported(Kernel::NeonDot),
+    };
+    return sSupported[static_cast<int>(k)];
+}
+
+DotFn dotFor(Kernel k) {
+    if (!supportedCached(k)) {
+        return packingOf(k) == Packing::Tile4x4 ? dotScalarTiled : dotScalar;
+    }
+    switch (k) {
+#if QK_X86
+        case Kernel::Avx2:       return dotAvx2;
+        case Kernel::Avx512Vnni: return dotAvx512Vnni;
+        case Kernel::AvxVnni:    return dotAvxVnni;
+#endif
+#if QK_ARM64
+        case Kernel::NeonDot:    return dotNeon;
+#endif
+        default:                 return dotScalar;
+    }
+}
+
+} // namespace
+
+const char* kernelName(Kernel k) {
+    switch (k) {
+        case Kernel::Scalar:     return "scalar";
+        case Kernel::Avx2:       return "avx2";
+        case Kernel::Avx512Vnni: return "avx512-vnni";
+        case Kernel::AvxVnni:    return "avx-vnni";
+        case Kernel::NeonDot:    return "neon-sdot";
+    }
+    return "?";
+}
+
+Packing packingOf(Kernel k) {
+    return k == Kernel::NeonDot ? Packing::Tile4x4 : Packing::RowMajor;
+}
+
+bool isSupported(Kernel k) {
+    switch (k) {
+        case Kernel::Scalar: return true;
+#if QK_X86
+        case Kernel::Avx2:       return __builtin_cpu_supports("avx2");
+        case Kernel::Avx512Vnni: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("avx512vnni")
+                                        && __builtin_cpu_supports("avx512vl");
+        case Kernel::AvxVnni:    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("avxvnni");
+#endif
+#if QK_ARM64
+        case Kernel::NeonDot:
+#if defined(__linux__) && defined(HWCAP_ASIMDDP)
+            return (getauxval(AT_HWCAP) & HWCAP_ASIMDDP) != 0;
+#else
+            return false;
+#endif
+#endif
+        default: return false;
+    }
+}
+
+Kernel detectBest() {
+    for (Kernel k : {Kernel::NeonDot, Kernel::Avx512Vnni, Kernel::AvxVnni, Kernel::Avx2}) {
+        if (isSupported(k)) return k;
+    }
+    return Kernel::Scalar;
+}
+
+void select(Kernel k) {
+    gSelected.store(static_cast<int>(isSupported(k) ? k : Kernel::Scalar), std::memory_order_release);
+}
+
+Kernel selected() {
+    return static_cast<Kernel>(gSelected.load(std::memory_order_acquire));
+}
+
+void quantize(const float* W, int32_t rows, int32_t cols, QMatrix& out) {
+    quantize(W, rows, cols, out, selected());
+}
+
+void quantize(const float* W, int32_t rows, int32_t cols, QMatrix& out, Kernel k) {
+    out.rows       = rows;
+    out.cols       = cols;
+    out.rowsPadded = (rows + kRowBlock - 1) / kRowBlock * kRowBlock;
+    out.colsPadded = (cols + kColAlign - 1) / kColAlign * kColAlign;
+    out.layout     = k;
+    out.extData    = nullptr;
+    out.extScales  = nullptr;
+    out.data.assign(static_cast<size_t>(out.rowsPadded) * out.colsPadded, 0);
+    out.scales.assign(out.rowsPadded, 0.0f);
+    for (int32_t r = 0; r < rows; ++r) {
+        const float* w = W + static_cast<size_t>(r) * cols;
+        float maxAbs = 0.0f;
+        for (int32_t c = 0; c < cols; ++c) maxAbs = std::max(maxAbs, std::fabs(w[c]));
+        const float scale = maxAbs > 0.0f ? maxAbs / 127.0f : 1.0f;
+        const float inv = 1.0f / scale;
+        out.scales[r] = scale;
+        for (int32_t c = 0; c < cols; ++c) {
+            const float q = std::nearbyint(w[c] * inv);
+            out.data[packedIndex(out, r, c)] = static_cast<int8_t>(std::max(-127.0f, std::min(127.0f, q)));
+        }
+    }
+}
+
+bool wrap(const int8_t* packed, const float* scales, int32_t rows, int32_t cols,
+          Packing packing, Kernel k, QMatrix& out) {
+    if (packed == nullptr || scales == nullptr || rows <= 0 || cols <= 0 || packingOf(k) != packing) {
+        return false;
+    }
+    out.rows       = rows;
+    out.cols       = cols;
+    out.rowsPadded = (rows + kRowBlock - 1) / kRowBlock * kRowBlock;
+    out.colsPadded = (cols + kColAlign - 1) / kColAlign * kColAlign;
+    out.layout     = k;
+    out.data.clear();
+    out.scales.clear();
+    out.extData    = packed;
+    out.extScales  = scales;
+    return true;
+}
+
+float quantizeVector(const float* x, int32_t n, int8_t* xq, int32_t padded) {
+    float maxAbs = 0.0f;
+    for (int32_t i = 0; i < n; ++i) maxAbs = std::max(maxAbs, std::fabs(x[i]));
+    const float scale = maxAbs > 0.0f ? maxAbs / 127.0f : 1.0f;
+    const float inv = 1.0f / scale;
+    for (int32_t i = 0; i < n; ++i) {
+        const float q = std::nearbyint(x[i] * inv);
+        xq[i] = static_cast<int8_t>(std::max(-127.0f, std::min(127.0f, q)));
+    }
+    for (int32_t i = n; i < padded; ++i) xq[i] = 0;
+    return scale;
+}
+
+void gemvInt8(const QMatrix& A, const int8_t* xq, float xScale, const float* bias, float* y) {
+    const DotFn dot = dotFor(A.layout);
+    int32_t acc[kChunkRows];
+    for (int32_t r0 = 0; r0 < A.rows; r0 += kChunkRows) {
+        const int32_t n = std::min(kChunkRows, A.rowsPadded - r0);
+        dot(A, xq, r0, n, acc);
+        const int32_t m = std::min(n, A.rows - r0);
+        for (int32_t i = 0; i < m; ++i) {
+            const float v = A.rowScales()[r0 + i] * xScale * static_cast<float>(acc[i]);
+            y[r0 + i] = bias != nullptr ? v + bias[r0 + i] : v;
+        }
+    }
+}
+
+void gemvF32(const QMatrix& A, const float* x, const float* bias, float* y) {
+    for (int32_t r = 0; r < A.rows; ++r) {
+        float s = 0.0f;
+        if (packingOf(A.layout) == Packing::Tile4x4) {
+            for (int32_t c = 0; c < A.cols; ++c) s += float(A.weights()[packedIndex(A, r, c)]) * x[c];
+        } else {
+            const int8_t* w = A.weights() + static_cast<size_t>(r) * A.colsPadded;
+            for (int32_t c = 0; c < A.cols; ++c) s += float(w[c]) * x[c];
+        }
+        const float v = A.rowScales()[r] * s;
+        y[r] = bias != nullptr ? v + bias[r] : v;
+    }
+}
+
+} // namespace quant
@@ -0,0 +1,77 @@
+// QuantKernels.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Int8 matrix-vector kernels for per-hop models.
+ *
+ * Weights are quantized symmetrically per output row (scale = max|w| / 127)
+ * and packed once into the layout of the kernel that will run them.
+ * Activations are either float (gemvF32) or quantized per vector with one
+ * scale (gemvInt8). Accumulation is int32, so int8 results are exact and
+ * identical across kernels; only the final float scaling rounds.
+ *
+ * Kernels (chosen once with select(), normally detectBest() at engine start):
+ *   Scalar     - portable reference, row-major
+ *   Avx2       - x86_64, maddubs/madd on 32 bytes, 4 rows per pass
+ *   Avx512Vnni - x86_64, vpdpbusd on 256-bit registers (AVX512-VNNI + VL)
+ *   AvxVnni    - x86_64, vpdpbusd (VEX encoding, e.g. Alder Lake)
+ *   NeonDot    - arm64, sdot; rows packed in 4-row x 4-column tiles
+ * x86 kernels feed |x| as the unsigned operand and move the sign of x onto
+ * the weights, which stays exact because both are limited to [-127, 127].
+ */
+namespace quant {
+
+enum class Kernel { Scalar, Avx2, Avx512Vnni, AvxVnni, NeonDot };
+
+const char* kernelName(Kernel k);
+bool   isSupported(Kernel k);   // compiled in and supported by this CPU
+Kernel detectBest();
+void   select(Kernel k);        // falls back to Scalar if unsupported
+Kernel selected();
+
+// Byte order of packed weights. All x86 kernels and Scalar share RowMajor,
+// so one pre-packed copy (e.g. in a weight file) serves any of them.
+enum class Packing : uint32_t { RowMajor = 1, Tile4x4 = 2 };
+Packing packingOf(Kernel k);
+
+struct QMatrix {
+    int32_t rows = 0;
+    int32_t cols = 0;
+    int32_t rowsPadded = 0;     // multiple of 4
+    int32_t colsPadded = 0;     // multiple of 32; also the int8 activation length
+    Kernel  layout = Kernel::Scalar;
+    std::vector<int8_t> data;   // packed for 'layout' (empty when external)
+    std::vector<float>  scales; // per row (rowsPadded)
+    const int8_t* extData   = nullptr; // borrowed storage, e.g. a mapped file
+    const float*  extScales = nullptr;
+
+    const int8_t* weights()   const { return extData   ? extData   : data.data(); }
+    const float*  rowScales() const { return extScales ? extScales : scales.data(); }
+    size_t packedBytes() const { return static_cast<size_t>(rowsPadded) * colsPadded; }
+};
+
+// Quantizes row-major W[rows][cols] and packs it for kernel k (default: selected()).
+// Packing does not depend on the CPU; where k is not supported gemvInt8 runs
+// a scalar loop over the same packing (e.g. writing arm64 files on x86).
+void quantize(const float* W, int32_t rows, int32_t cols, QMatrix& out);
+void quantize(const float* W, int32_t rows, int32_t cols, QMatrix& out, Kernel k);
+
+// Wraps already packed weights (packedBytes() int8, rowsPadded scales) without
+// copying. The storage must outlive the matrix. False if the packing does not
+// suit kernel k.
+bool wrap(const int8_t* packed, const float* scales, int32_t rows, int32_t cols,
+          Packing packing, Kernel k, QMatrix& out);
+
+// Symmetric per-vector quantization of x[n] into xq[padded] (tail zeroed). Returns the scale.
+float quantizeVector(const float* x, int32_t n, int8_t* xq, int32_t padded);
+
+// y[r] = scale[r] * xScale * dot(Wq[r], xq) + bias[r]   (bias may be nullptr)
+void gemvInt8(const QMatrix& A, const int8_t* xq, float xScale, const float* bias, float* y);
+
+// y[r] = scale[r] * dot(Wq[r], x) + bias[r]; x has A.cols floats
+void gemvF32(const QMatrix& A, const float* x, const float* bias, float* y);
+
+} // namespace quant
@@ -14,7 +14,8 @@ public:
 
     // Returns number of output frames produced.
     // For DownBy3: requires inFrames multiple of 3 (we use 96 -> 32).
-    // For UpBy3: produces exactly 3*outFrames, using simple linear interpolation.
+    // For UpBy3: produces exactly 3*inFrames, using simple linear interpolation
+    // that continues across calls (one input sample of delay).
     int process(const float* in, int inFrames, float* out, int outMaxFrames) {
         return (mMode == Mode::DownBy3)
                ? processDown3(in, inFrames, out, outMaxFrames)
@@ -44,18 +45,20 @@ private:
         const int producedMax = std::min(need, outMaxFrames);
         int outIdx = 0;
 
-        // For each input sample i, interpolate towards the next (or hold at end)
+        // Interpolate from the previous input sample (the last one of the
+        // previous call, 0 after reset) towards each new one, so chunk
+        // boundaries are seamless: input sample m lands on frame 3m + 3.
+        float x0 = mPrevSample;
         for (int i = 0; i < inFrames && (outIdx + 3) <= producedMax; ++i) {
-            const float x0 = in[i];
-            const float x1 = (i + 1 < inFrames) ? in[i + 1] : x0; // hold last
+            const float x1 = in[i];
             const float d  = (x1 - x0) * (1.0f / 3.0f);
             out[outIdx++] = x0;            // 0/3
             out[outIdx++] = x0 + d;        // 1/3
             out[outIdx++] = x0 + 2.0f*d;   // 2/3
+            x0 = x1;
         }
 
-        // Save tail for potential continuity use later
-        mPrevSample = in[inFrames - 1];
+        mPrevSample = x0;
         mHadPrev = true;
         return outIdx; // == 3 * inFrames unless clipped
     }
@@ -0,0 +1,238 @@
+// RtThread.cpp
+#include "RtThread.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <xmmintrin.h>
+#endif
+
+namespace rt {
+
+namespace {
+
+int currentTid() {
+#if defined(__linux__)
+    return static_cast<int>(syscall(SYS_gettid));
+#else
+    return 0;
+#endif
+}
+
+// Reads one integer from a sysfs file, or -1.
+long readSysfsLong(const char* path) {
+    FILE* f = std::fopen(path, "r");
+    if (f == nullptr) return -1;
+    long v = -1;
+    if (std::fscanf(f, "%ld", &v) != 1) v = -1;
+    std::fclose(f);
+    return v;
+}
+
+bool trySched(int policy, int priority) {
+    sched_param sp{};
+    sp.sched_priority = priority;
+    return pthread_setschedparam(pthread_self(), policy, &sp) == 0;
+}
+
+std::vector<int> allowedCpus() {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &set)) cpus.push_back(c);
+        }
+    }
+#endif
+    return cpus;
+}
+
+bool setAffinity(const std::vector<int>& cpus) {
+#if defined(__linux__)
+    if (cpus.empty()) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus) {
+        if (c >= 0 && c < CPU_SETSIZE) CPU_SET(c, &set);
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+} // namespace
+
+const char* policyName(Policy p) {
+    switch (p) {
+        case Policy::Normal:     return "SCHED_OTHER";
+        case Policy::Fifo:       return "SCHED_FIFO";
+        case Policy::RoundRobin: return "SCHED_RR";
+    }
+    return "?";
+}
+
+std::string ThreadReport::describe() const {
+    char buf[256];
+    std::string cpuList;
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        cpuList += (i ? "," : "") + std::to_string(cpus[i]);
+    }
+    std::snprintf(buf, sizeof(buf), "%s prio %d nice %d, cpus [%s], ftz %s, stack %zu KB",
+                  policyName(policy), priority, nice, cpuList.c_str(),
+                  denormalsFlushed ? "on" : "off", stackPrefaulted / 1024);
+    return buf;
+}
+
+std::vector<int> bigCores() {
+    const long n = sysconf(_SC_NPROCESSORS_CONF);
+    std::vector<long> perf;
+    for (long c = 0; c < n; ++c) {
+        char path[128];
+        std::snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%ld/cpu_capacity", c);
+        long v = readSysfsLong(path);
+        if (v <= 0) {
+            std::snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%ld/cpufreq/cpuinfo_max_freq", c);
+            v = readSysfsLong(path);
+        }
+        perf.push_back(v);
+    }
+    std::vector<int> big;
+    if (perf.empty() || std::any_of(perf.begin(), perf.end(), [](long v) { return v <= 0; })) {
+        return big; // unknown topology
+    }
+    const long slowest = *std::min_element(perf.begin(), perf.end());
+    for (size_t c = 0; c < perf.size(); ++c) {
+        if (perf[c] > slowest) big.push_back(static_cast<int>(c));
+    }
+    return big; // empty when all cores are alike
+}
+
+bool flushDenormals() {
+#if defined(__aarch64__)
+    uint64_t fpcr;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+    fpcr |= (1ull << 24); // FZ
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr));
+    return true;
+#elif defined(__arm__) && defined(__ARM_FP)
+    uint32_t fpscr;
+    __asm__ __volatile__("vmrs %0, fpscr" : "=r"(fpscr));
+    fpscr |= (1u << 24); // FZ
+    __asm__ __volatile__("vmsr fpscr, %0" : : "r"(fpscr));
+    return true;
+#elif defined(__x86_64__) || defined(__i386__)
+    _mm_setcsr(_mm_getcsr() | 0x8040); // FTZ | DAZ
+    return true;
+#else
+    return false;
+#endif
+}
+
+__attribute__((noinline)) void prefaultStack(size_t bytes) {
+    constexpr size_t kChunk = 4096;
+    volatile uint8_t page[kChunk];
+    page[0] = 0;
+    if (bytes > kChunk) prefaultStack(bytes - kChunk);
+    page[kChunk - 1] = page[0]; // used after the call, so the frame is not reused as a tail call
+}
+
+bool setupCurrentThread(const ThreadConfig& cfg, ThreadReport* report) {
+    ThreadReport r;
+
+    // Scheduling: FIFO -> RR -> nice -> unchanged
+    bool realtime = false;
+    if (cfg.policy == Policy::Fifo && trySched(SCHED_FIFO, cfg.priority)) {
+        r.policy = Policy::Fifo;
+        realtime = true;
+    } else if (cfg.policy != Policy::Normal && trySched(SCHED_RR, cfg.priority)) {
+        r.policy = Policy::RoundRobin;
+        realtime = true;
+    }
+    if (!realtime && cfg.fallbackNice != 0) {
+        (void)setpriority(PRIO_PROCESS, currentTid(), cfg.fallbackNice);
+    }
+    int policy = SCHED_OTHER;
+    sched_param sp{};
+    if (pthread_getschedparam(pthread_self(), &policy, &sp) == 0) {
+        r.policy   = (policy == SCHED_FIFO) ? Policy::Fifo
+                   : (policy == SCHED_RR)   ? Policy::RoundRobin
+                   : Policy::Normal;
+        r.priority = sp.sched_priority;
+    }
+    errno = 0;
+    const int nice = getpriority(PRIO_PROCESS, currentTid());
+    r.nice = (errno == 0) ? nice : 0;
+
+    // Affinity
+    if (cfg.affinity == Affinity::BigCores) {
+        (void)setAffinity(bigCores());
+    } else if (cfg.affinity == Affinity::Explicit) {
+        (void)setAffinity(cfg.cpus);
+    }
+    r.cpus = allowedCpus();
+
+    if (cfg.flushDenormals) r.denormalsFlushed = flushDenormals();
+    if (cfg.prefaultStackBytes > 0) {
+        prefaultStack(cfg.prefaultStackBytes);
+        r.stackPrefaulted = cfg.prefaultStackBytes;
+    }
+
+    const bool improved = realtime || r.nice < 0;
+    if (report != nullptr) *report = std::move(r);
+    return improved;
+}
+
+JitterStats measureWakeupJitter(const ThreadConfig& cfg, int32_t periodMicros, int32_t iterations) {
+    JitterStats stats;
+    if (periodMicros <= 0 || iterations <= 0) return stats;
+    std::vector<double> lateUs(static_cast<size_t>(iterations));
+
+    std::thread worker([&]() {
+        setupCurrentThread(cfg, &stats.report);
+        timespec next{};
+        clock_gettime(CLOCK_MONOTONIC, &next);
+        for (int32_t i = 0; i < iterations; ++i) {
+            next.tv_nsec += static_cast<long>(periodMicros) * 1000;
+            while (next.tv_nsec >= 1000000000L) {
+                next.tv_nsec -= 1000000000L;
+                next.tv_sec += 1;
+            }
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr) == EINTR) {}
+            timespec now{};
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            const double late = double(now.tv_sec - next.tv_sec) * 1e6
+                              + double(now.tv_nsec - next.tv_nsec) / 1e3;
+            lateUs[i] = std::max(0.0, late);
+        }
+    });
+    worker.join();
+
+    std::sort(lateUs.begin(), lateUs.end());
+    auto pct = [&](double p) {
+        const size_t idx = std::min(lateUs.size() - 1, static_cast<size_t>(p * double(lateUs.size())));
+        return lateUs[idx];
+    };
+    stats.samples = iterations;
+    stats.p50Us  = pct(0.50);
+    stats.p90Us  = pct(0.90);
+    stats.p99Us  = pct(0.99);
+    stats.p999Us = pct(0.999);
+    stats.maxUs  = lateUs.back();
+    return stats;
+}
+
+} // namespace rt
@@ -0,0 +1,72 @@
+// RtThread.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Real-time setup for the engine's own threads (io thread, STFT worker).
+ *
+ * setupCurrentThread() applies, in order:
+ *   scheduling  SCHED_FIFO, else SCHED_RR, else a negative nice value on the
+ *               normal (CFS) scheduler, else nothing; each step is only tried
+ *               when the previous one is refused (EPERM on most app processes)
+ *   affinity    none, the big cores (every core above the slowest tier, from
+ *               cpu_capacity or cpuinfo_max_freq), or an explicit CPU list
+ *   denormals   flush-to-zero (and denormals-are-zero on x86) for this thread
+ *   stack       touch the first stackBytes of stack so the audio loop never
+ *               takes a page fault growing it
+ * and reports what the kernel actually granted.
+ */
+namespace rt {
+
+enum class Policy { Normal, Fifo, RoundRobin };
+enum class Affinity { None, BigCores, Explicit };
+
+struct ThreadConfig {
+    Policy   policy = Policy::Fifo;    // most demanding policy to try first
+    int      priority = 2;             // SCHED_FIFO/RR priority (Android audio uses 2-3)
+    int      fallbackNice = -18;       // CFS nice value when RT is refused
+    Affinity affinity = Affinity::None;
+    std::vector<int> cpus;             // Affinity::Explicit
+    bool     flushDenormals = true;
+    size_t   prefaultStackBytes = 64 * 1024;
+};
+
+struct ThreadReport {
+    Policy   policy = Policy::Normal;  // policy obtained
+    int      priority = 0;             // RT priority, 0 on CFS
+    int      nice = 0;
+    std::vector<int> cpus;             // allowed CPUs after setup (empty = unknown)
+    bool     denormalsFlushed = false;
+    size_t   stackPrefaulted = 0;
+
+    std::string describe() const;
+};
+
+// Applies cfg to the calling thread. Returns false only if nothing better than
+// the default policy could be obtained; the report is filled either way.
+bool setupCurrentThread(const ThreadConfig& cfg, ThreadReport* report = nullptr);
+
+const char* policyName(Policy p);
+
+// CPUs above the slowest performance tier; empty if all cores are alike or unknown.
+std::vector<int> bigCores();
+
+// FTZ/DAZ for the calling thread. Returns false where unsupported.
+bool flushDenormals();
+
+// Touches 'bytes' of stack below the caller, one page at a time.
+void prefaultStack(size_t bytes);
+
+// Wake-up jitter of a periodic thread set up with cfg: the thread sleeps to
+// absolute deadlines every periodMicros and records how late it woke.
+struct JitterStats {
+    ThreadReport report;
+    int32_t samples = 0;
+    double  p50Us = 0.0, p90Us = 0.0, p99Us = 0.0, p999Us = 0.0, maxUs = 0.0;
+};
+JitterStats measureWakeupJitter(const ThreadConfig& cfg, int32_t periodMicros, int32_t iterations);
+
+} // namespace rt
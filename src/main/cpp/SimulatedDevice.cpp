@@ -0,0 +1,272 @@
+// SimulatedDevice.cpp
+#include "SimulatedDevice.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace audio {
+
+namespace {
+
+// Uniform in [0, 1) from the top 53 bits: the same sequence on every platform
+double uniform01(std::mt19937_64& rng) {
+    return double(rng() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+} // namespace
+
+class SimulatedDevice::Input : public Stream {
+public:
+    explicit Input(SimulatedDevice& device) : mDev(device) {}
+
+    int32_t channelCount() const override { return mDev.mCfg.inputChannels; }
+    int32_t sampleRate() const override { return mDev.mCfg.sampleRate; }
+    int32_t framesPerBurst() const override { return mDev.mCfg.framesPerBurst; }
+
+    bool requestStart() override {
+        std::lock_guard<std::mutex> lock(mDev.mLock);
+        mDev.mInputStarted = true;
+        mDev.mCond.notify_all();
+        return true;
+    }
+
+    bool requestStop() override {
+        std::lock_guard<std::mutex> lock(mDev.mLock);
+        mDev.mInputStarted = false;
+        mDev.mCond.notify_all();
+        return true;
+    }
+
+    int32_t read(float* data, int32_t frames, int64_t timeoutNanos) override {
+        std::unique_lock<std::mutex> lock(mDev.mLock);
+        auto ready = [this]() { return mDev.mClosed || mDev.mCaptured > mDev.mReadPos; };
+        if (!ready() && timeoutNanos > 0) {
+            mDev.mReaderWaiting = true;
+            mDev.mCond.notify_all();
+            if (mDev.mCfg.clock == ClockMode::Virtual) {
+                mDev.mCond.wait(lock, ready);
+            } else {
+                (void)mDev.mCond.wait_for(lock, std::chrono::nanoseconds(timeoutNanos), ready);
+            }
+            mDev.mReaderWaiting = false;
+        }
+        if (mDev.mClosed || mDev.mCaptured <= mDev.mReadPos) return 0;
+        return mDev.readLocked(data, frames);
+    }
+
+private:
+    SimulatedDevice& mDev;
+};
+
+class SimulatedDevice::Output : public Stream {
+public:
+    explicit Output(SimulatedDevice& device) : mDev(device) {}
+
+    int32_t channelCount() const override { return mDev.mCfg.outputChannels; }
+    int32_t sampleRate() const override { return mDev.mCfg.sampleRate; }
+    int32_t framesPerBurst() const override { return mDev.mCfg.framesPerBurst; }
+
+    bool requestStart() override {
+        std::lock_guard<std::mutex> lock(mDev.mLock);
+        mDev.mOutputStarted = true;
+        return true;
+    }
+
+    bool requestStop() override {
+        std::lock_guard<std::mutex> lock(mDev.mLock);
+        mDev.mOutputStarted = false;
+        return true;
+    }
+
+    int32_t read(float*, int32_t, int64_t) override { return -1; }
+
+private:
+    SimulatedDevice& mDev;
+};
+
+class SimulatedDevice::Driver : public DuplexDriver {
+public:
+    explicit Driver(SimulatedDevice& device) : mDev(device) {}
+
+    bool start(DuplexCallback* callback) override {
+        std::lock_guard<std::mutex> lock(mDev.mLock);
+        mDev.mCallback = callback;
+        return callback != nullptr;
+    }
+
+    void stop() override {
+        std::lock_guard<std::mutex> lock(mDev.mLock);
+        mDev.mCallback = nullptr;
+    }
+
+private:
+    SimulatedDevice& mDev;
+};
+
+SimulatedDevice::SimulatedDevice(const Config& config)
+        : mCfg(config), mReadRng(config.seed ^ 0x9e3779b97f4a7c15ULL), mRng(config.seed) {
+    mInput = std::make_shared<Input>(*this);
+    mOutput = std::make_shared<Output>(*this);
+    mDriver = std::make_shared<Driver>(*this);
+    mInBuf.assign(static_cast<size_t>(mCfg.framesPerBurst) * mCfg.inputChannels, 0.0f);
+    mOutBuf.assign(static_cast<size_t>(mCfg.framesPerBurst) * mCfg.outputChannels, 0.0f);
+
+    bool late = false;
+    mNextInNs = static_cast<int64_t>(double(mCfg.framesPerBurst) * 1e9 /
+                                     (double(mCfg.sampleRate) * (1.0 + mCfg.driftPpm * 1e-6))) +
+                eventDelayNs(late);
+    if (late) ++mStats.lateInputBursts;
+    mNextOutNs = eventDelayNs(late);
+    if (late) ++mStats.lateCallbacks;
+}
+
+SimulatedDevice::~SimulatedDevice() {
+    close();
+}
+
+std::shared_ptr<Stream> SimulatedDevice::inputStream() { return mInput; }
+std::shared_ptr<Stream> SimulatedDevice::outputStream() { return mOutput; }
+std::shared_ptr<DuplexDriver> SimulatedDevice::duplexDriver() { return mDriver; }
+
+void SimulatedDevice::close() {
+    std::lock_guard<std::mutex> lock(mLock);
+    mClosed = true;
+    mCond.notify_all();
+}
+
+SimulatedDevice::Stats SimulatedDevice::stats() const {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mStats;
+}
+
+int64_t SimulatedDevice::eventDelayNs(bool& late) {
+    double us = 0.0;
+    switch (mCfg.jitter) {
+        case JitterShape::None:
+            break;
+        case JitterShape::Uniform:
+            us = uniform01(mRng) * mCfg.jitterMicros;
+            break;
+        case JitterShape::Normal: {
+            // Box-Muller; u1 in (0, 1]
+            const double u1 = 1.0 - uniform01(mRng);
+            const double u2 = uniform01(mRng);
+            us = std::fabs(std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * M_PI * u2)) * mCfg.jitterMicros;
+            break;
+        }
+    }
+    late = mCfg.lateProbability > 0.0 && uniform01(mRng) < mCfg.lateProbability;
+    if (late) us += mCfg.lateMicros;
+    return static_cast<int64_t>(us * 1000.0);
+}
+
+int32_t SimulatedDevice::readLocked(float* data, int32_t frames) {
+    int32_t n = static_cast<int32_t>(std::min<int64_t>(frames, mCaptured - mReadPos));
+    if (n <= 0) return 0;
+    if (n > 1 && mCfg.partialReadProbability > 0.0 &&
+        uniform01(mReadRng) < mCfg.partialReadProbability) {
+        n = 1 + static_cast<int32_t>(uniform01(mReadRng) * double(n - 1));
+        ++mStats.partialReads;
+    }
+    if (mSource) {
+        mSource(mReadPos, data, n);
+    } else {
+        std::fill(data, data + static_cast<size_t>(n) * mCfg.inputChannels, 0.0f);
+    }
+    mReadPos += n;
+    mStats.inputFramesRead += n;
+    return n;
+}
+
+void SimulatedDevice::waitForReaderIdle(std::unique_lock<std::mutex>& lock) {
+    mCond.wait(lock, [this]() {
+        return mClosed || !mInputStarted || mCallback != nullptr ||
+               (mReaderWaiting && mCaptured == mReadPos);
+    });
+}
+
+void SimulatedDevice::deliverInputBurst() {
+    std::unique_lock<std::mutex> lock(mLock);
+    mCaptured += mCfg.framesPerBurst;
+    ++mStats.inputBursts;
+    const int64_t capacity = static_cast<int64_t>(mCfg.inputBufferBursts) * mCfg.framesPerBurst;
+    if (mCaptured - mReadPos > capacity) {
+        mStats.inputFramesLost += mCaptured - mReadPos - capacity;
+        mReadPos = mCaptured - capacity;
+    }
+    mCond.notify_all();
+    if (mCfg.clock == ClockMode::Virtual) waitForReaderIdle(lock);
+}
+
+void SimulatedDevice::outputCallback() {
+    const int32_t fpb = mCfg.framesPerBurst;
+    std::fill(mOutBuf.begin(), mOutBuf.end(), 0.0f);
+    DuplexCallback* callback = nullptr;
+    bool pull = false;
+    int32_t numIn = 0;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        callback = mCallback;
+        pull = mOutputStarted && mPull;
+        // Callback mode: whatever input is there, up to one buffer, without blocking
+        if (callback != nullptr) numIn = readLocked(mInBuf.data(), fpb);
+    }
+    if (callback != nullptr) {
+        callback->onDuplex(mInBuf.data(), numIn, mOutBuf.data(), fpb);
+    } else if (pull) {
+        mPull(mOutBuf.data(), fpb);
+    }
+    int64_t first;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        first = mStats.outputFrames;
+        mStats.outputFrames += fpb;
+        ++mStats.outputCallbacks;
+    }
+    if (mSink) mSink(first, mOutBuf.data(), fpb);
+}
+
+void SimulatedDevice::run(double seconds) {
+    const int64_t end = mNowNs + static_cast<int64_t>(seconds * 1e9);
+    if (mCfg.clock == ClockMode::RealTime && !mWallStarted) {
+        mWallStart = std::chrono::steady_clock::now();
+        mWallStarted = true;
+    }
+    const double inPeriodNs = double(mCfg.framesPerBurst) * 1e9 /
+                              (double(mCfg.sampleRate) * (1.0 + mCfg.driftPpm * 1e-6));
+    const double outPeriodNs = double(mCfg.framesPerBurst) * 1e9 / double(mCfg.sampleRate);
+    while (true) {
+        const bool input = mNextInNs <= mNextOutNs;
+        const int64_t t = input ? mNextInNs : mNextOutNs;
+        if (t > end) break;
+        if (mCfg.clock == ClockMode::RealTime) {
+            std::this_thread::sleep_until(mWallStart + std::chrono::nanoseconds(t));
+        }
+        mNowNs = t;
+
+        // Events of one kind stay in order however late the previous one was
+        bool late = false;
+        if (input) {
+            deliverInputBurst();
+            ++mInBurst;
+            const int64_t nominal = static_cast<int64_t>(double(mInBurst + 1) * inPeriodNs);
+            mNextInNs = std::max(nominal + eventDelayNs(late), mNextInNs);
+            if (late) {
+                std::lock_guard<std::mutex> lock(mLock);
+                ++mStats.lateInputBursts;
+            }
+        } else {
+            outputCallback();
+            ++mOutBurst;
+            const int64_t nominal = static_cast<int64_t>(double(mOutBurst) * outPeriodNs);
+            mNextOutNs = std::max(nominal + eventDelayNs(late), mNextOutNs);
+            if (late) {
+                std::lock_guard<std::mutex> lock(mLock);
+                ++mStats.lateCallbacks;
+            }
+        }
+    }
+    mNowNs = end;
+}
+
+} // namespace audio
@@ -0,0 +1,152 @@
+// SimulatedDevice.h
+#pragma once
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+#include "AudioPort.h"
+
+namespace audio {
+
+/**
+ * An input/output stream pair with a modelled clock, for host builds: drives
+ * FullDuplexEngine the way a device would, with its irregularities.
+ *
+ * Time is the output device's clock. Input bursts complete at the input
+ * clock's rate (off by driftPpm) and output callbacks at the output rate;
+ * each is delayed by a jitter sample and, occasionally, by lateMicros. Input
+ * lands in a device buffer of inputBufferBursts bursts; what is not read in
+ * time is overwritten and counted as lost. Reads may return only part of
+ * what is available (partialReadProbability).
+ *
+ * Threaded mode: the engine's io thread reads inputStream() and the output
+ * callbacks call the Pull function (FullDuplexEngine::pullTo). Callback
+ * mode: duplexDriver() hands each output callback the input available for
+ * it, as oboe::FullDuplexStream does.
+ *
+ * ClockMode::Virtual runs as fast as the CPU allows and is deterministic for
+ * a given Config: after each input burst, run() waits until the io thread is
+ * blocked in read() again with nothing left to read, so the engine always
+ * sees the same sequence of events. This holds for the single-thread and
+ * callback modes; the pipelined STFT worker is not synchronized. Reads
+ * block without a timeout on the virtual clock; close() releases them. A
+ * zero timeout never waits, on either clock.
+ * ClockMode::RealTime sleeps to each event instead.
+ *
+ * The device must outlive the engine's use of its streams.
+ */
+class SimulatedDevice {
+public:
+    enum class ClockMode { Virtual, RealTime };
+    enum class JitterShape { None, Uniform, Normal };
+
+    struct Config {
+        int32_t sampleRate = 48000;
+        int32_t framesPerBurst = 96;
+        int32_t inputChannels = 2;
+        int32_t outputChannels = 2;
+        double  driftPpm = 0.0;              // input clock relative to the output clock
+        JitterShape jitter = JitterShape::Uniform;
+        double  jitterMicros = 200.0;        // Uniform: maximum delay; Normal: sigma of |N(0, sigma)|
+        double  lateProbability = 0.0;       // per callback / input burst
+        double  lateMicros = 5000.0;
+        double  partialReadProbability = 0.0;
+        int32_t inputBufferBursts = 8;
+        uint64_t seed = 1;
+        ClockMode clock = ClockMode::Virtual;
+    };
+
+    struct Stats {
+        int64_t outputCallbacks = 0;
+        int64_t lateCallbacks = 0;
+        int64_t inputBursts = 0;
+        int64_t lateInputBursts = 0;
+        int64_t partialReads = 0;
+        int64_t inputFramesRead = 0;
+        int64_t inputFramesLost = 0;   // overwritten in the device buffer before being read
+        int64_t outputFrames = 0;
+    };
+
+    // Input signal: fills 'frames' interleaved frames starting at input frame 'frame'
+    using Source = std::function<void(int64_t frame, float* data, int32_t frames)>;
+    // Every output buffer after the callback filled it, with its first frame index
+    using Sink = std::function<void(int64_t frame, const float* data, int32_t frames)>;
+    // Threaded mode: fills one output buffer (FullDuplexEngine::pullTo)
+    using Pull = std::function<void(float* data, int32_t frames)>;
+
+    explicit SimulatedDevice(const Config& config);
+    ~SimulatedDevice();
+    SimulatedDevice(const SimulatedDevice&) = delete;
+    SimulatedDevice& operator=(const SimulatedDevice&) = delete;
+
+    std::shared_ptr<Stream> inputStream();
+    std::shared_ptr<Stream> outputStream();
+    std::shared_ptr<DuplexDriver> duplexDriver();
+
+    // Set before run()
+    void setSource(Source source) { mSource = std::move(source); }
+    void setSink(Sink sink) { mSink = std::move(sink); }
+    void setPull(Pull pull) { mPull = std::move(pull); }
+
+    // Advances the device clock by 'seconds', delivering every input burst
+    // and output callback due on the way. May be called repeatedly.
+    void run(double seconds);
+
+    // Makes every read() return 0 from now on; call before stopping the engine
+    void close();
+
+    double nowSeconds() const { return double(mNowNs) * 1e-9; }
+    const Config& config() const { return mCfg; }
+    Stats stats() const;
+
+private:
+    class Input;
+    class Output;
+    class Driver;
+
+    int64_t eventDelayNs(bool& late);
+    void    waitForReaderIdle(std::unique_lock<std::mutex>& lock);
+    void    deliverInputBurst();
+    void    outputCallback();
+    int32_t readLocked(float* data, int32_t frames);  // mLock held
+
+    const Config mCfg;
+    Source mSource;
+    Sink   mSink;
+    Pull   mPull;
+
+    std::shared_ptr<Input>  mInput;
+    std::shared_ptr<Output> mOutput;
+    std::shared_ptr<Driver> mDriver;
+
+    // Device state, shared with the reader thread
+    mutable std::mutex      mLock;
+    std::condition_variable mCond;
+    int64_t mCaptured = 0;        // input frames completed so far
+    int64_t mReadPos = 0;         // next input frame to hand out
+    bool    mInputStarted = false;
+    bool    mOutputStarted = false;
+    bool    mReaderWaiting = false;
+    bool    mClosed = false;
+    DuplexCallback* mCallback = nullptr;
+    std::mt19937_64 mReadRng;     // partial reads (reader side)
+    Stats   mStats;
+
+    // Event schedule (run() only)
+    std::mt19937_64 mRng;
+    int64_t mNowNs = 0;
+    int64_t mInBurst = 0;         // next input burst index
+    int64_t mOutBurst = 0;        // next output callback index
+    int64_t mNextInNs = 0;
+    int64_t mNextOutNs = 0;
+    bool    mWallStarted = false;
+    std::chrono::steady_clock::time_point mWallStart{};
+    std::vector<float> mInBuf;
+    std::vector<float> mOutBuf;
+};
+
+} // namespace audio
@@ -0,0 +1,124 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+/**
+ * Read-only 2-D window over the most recent hops of a SpectralHistory.
+ * Rows are hops, oldest first (row numHops-1 is the newest); each row is
+ * channel-major like SpectralFrame (channel c starts at c * numBins).
+ * Rows are rowStride floats apart, so re/im are plain strided matrices.
+ */
+struct SpectralHistoryView {
+    const float* re = nullptr;
+    const float* im = nullptr;
+    int32_t numHops     = 0;
+    int32_t numBins     = 0;
+    int32_t numChannels = 0;
+    size_t  rowStride   = 0; // floats between consecutive hops (multiple of 16)
+
+    const float* reRow(int32_t hop, int32_t ch = 0) const { return re + hop * rowStride + ch * numBins; }
+    const float* imRow(int32_t hop, int32_t ch = 0) const { return im + hop * rowStride + ch * numBins; }
+};
+
+/**
+ * Fixed-capacity history of half-spectra (re/im SoA planes), one row per hop.
+ *
+ * Mirrored layout: every row is stored twice, at slot i and slot i + capacity,
+ * so the last N hops (N <= capacity) are always one contiguous block and
+ * last() returns a view into the storage without copying. Rows are 64-byte
+ * aligned. All memory is allocated in init(); push is two row copies.
+ * Single-threaded: written and read on the STFT thread.
+ */
+class SpectralHistory {
+public:
+    SpectralHistory() = default;
+    // Views point into the storage; copying would alias it
+    SpectralHistory(const SpectralHistory&) = delete;
+    SpectralHistory& operator=(const SpectralHistory&) = delete;
+
+    // capacityHops <= 0 releases the storage (history disabled).
+    bool init(int32_t capacityHops, int32_t numBins, int32_t numChannels) {
+        if (capacityHops <= 0 || numBins <= 0 || numChannels <= 0) {
+            std::vector<float>().swap(mStorage);
+            mRe = mIm = nullptr;
+            mCapacity = mNumBins = mNumChannels = 0;
+            mRowStride = 0;
+            reset();
+            return false;
+        }
+        mCapacity    = capacityHops;
+        mNumBins     = numBins;
+        mNumChannels = numChannels;
+        const size_t width = static_cast<size_t>(numBins) * numChannels;
+        mRowStride = (width + kAlignFloats - 1) / kAlignFloats * kAlignFloats;
+        const size_t plane = mRowStride * 2 * static_cast<size_t>(mCapacity);
+        mStorage.assign(2 * plane + kAlignFloats, 0.0f);
+        mRe = alignUp(mStorage.data());
+        mIm = mRe + plane;
+        reset();
+        return true;
+    }
+
+    void reset() {
+        mWrite = 0;
+        mSize  = 0;
+    }
+
+    int32_t capacity()    const { return mCapacity; }
+    int32_t size()        const { return mSize; }     // hops stored (<= capacity)
+    int32_t numBins()     const { return mNumBins; }
+    int32_t numChannels() const { return mNumChannels; }
+
+    // Row that the next hop is written into (channel-major, numBins per channel).
+    // Fill both, then call commit().
+    float* nextRe() { return mRe + static_cast<size_t>(mWrite) * mRowStride; }
+    float* nextIm() { return mIm + static_cast<size_t>(mWrite) * mRowStride; }
+
+    // Publishes the row written through nextRe()/nextIm() and mirrors it.
+    void commit() {
+        const size_t lo = static_cast<size_t>(mWrite) * mRowStride;
+        const size_t hi = lo + static_cast<size_t>(mCapacity) * mRowStride;
+        const size_t bytes = static_cast<size_t>(mNumBins) * mNumChannels * sizeof(float);
+        std::memcpy(mRe + hi, mRe + lo, bytes);
+        std::memcpy(mIm + hi, mIm + lo, bytes);
+        mWrite = (mWrite + 1 == mCapacity) ? 0 : mWrite + 1;
+        mSize  = std::min(mSize + 1, mCapacity);
+    }
+
+    // The newest min(hops, size()) hops, oldest first, as one contiguous view.
+    SpectralHistoryView last(int32_t hops) const {
+        SpectralHistoryView v;
+        v.numHops     = std::max(0, std::min(hops, mSize));
+        v.numBins     = mNumBins;
+        v.numChannels = mNumChannels;
+        v.rowStride   = mRowStride;
+        if (mCapacity == 0) return v;
+        // Slot mWrite + capacity is one past the newest mirrored row
+        const size_t first = static_cast<size_t>(mWrite + mCapacity - v.numHops) * mRowStride;
+        v.re = mRe + first;
+        v.im = mIm + first;
+        return v;
+    }
+
+private:
+    static constexpr size_t kAlignFloats = 16; // 64 bytes
+
+    static float* alignUp(float* p) {
+        const uintptr_t a = reinterpret_cast<uintptr_t>(p);
+        const uintptr_t mask = kAlignFloats * sizeof(float) - 1;
+        return reinterpret_cast<float*>((a + mask) & ~mask);
+    }
+
+    std::vector<float> mStorage;
+    float*  mRe = nullptr;
+    float*  mIm = nullptr;
+    size_t  mRowStride   = 0;
+    int32_t mCapacity    = 0;
+    int32_t mNumBins     = 0;
+    int32_t mNumChannels = 0;
+    int32_t mWrite = 0;  // slot of the next row, in [0, capacity)
+    int32_t mSize  = 0;
+};
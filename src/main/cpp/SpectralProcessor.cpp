@@ -0,0 +1,102 @@
+// SpectralProcessor.cpp
+#include "SpectralProcessor.h"
+#include "FastMath.h"
+#include <cmath>
+#include <algorithm>
+
+void SpectralFrame::toPolar() {
+    if (mLayout == Layout::Polar) return;
+    const int32_t n = mNumBins * mNumChannels;
+    if (mCache != nullptr && mCache->isValid(SpectralViewCache::kMagnitude)) {
+        // magnitude already known: only the (exact) phase is left to compute
+        const float* mag = mCache->mMag.data();
+        for (int32_t k = 0; k < n; ++k) {
+            mB[k] = std::atan2(mB[k], mA[k]);
+            mA[k] = mag[k];
+        }
+        mLayout = Layout::Polar;
+        return;
+    }
+    for (int32_t k = 0; k < n; ++k) {
+        const float re = mA[k];
+        const float im = mB[k];
+        mA[k] = std::sqrt(re * re + im * im);
+        mB[k] = std::atan2(im, re);
+    }
+    mLayout = Layout::Polar;
+}
+
+void SpectralFrame::toCartesian() {
+    if (mLayout == Layout::Cartesian) return;
+    const int32_t n = mNumBins * mNumChannels;
+    for (int32_t k = 0; k < n; ++k) {
+        const float mag = mA[k];
+        const float ph  = mB[k];
+        mA[k] = mag * std::cos(ph);
+        mB[k] = mag * std::sin(ph);
+    }
+    mLayout = Layout::Cartesian;
+}
+
+void SpectralFrame::computePower() {
+    if (mCache->isValid(SpectralViewCache::kPower)) return;
+    const int32_t n = mNumBins * mNumChannels;
+    float* pw = mCache->mPow.data();
+    if (mLayout == Layout::Cartesian) {
+        for (int32_t k = 0; k < n; ++k) pw[k] = mA[k] * mA[k] + mB[k] * mB[k];
+    } else {
+        for (int32_t k = 0; k < n; ++k) pw[k] = mA[k] * mA[k];
+    }
+    mCache->mValid |= SpectralViewCache::kPower;
+}
+
+const float* SpectralFrame::magnitudeView(int32_t ch) {
+    if (mCache == nullptr) return nullptr;
+    if (!mCache->isValid(SpectralViewCache::kMagnitude)) {
+        const int32_t n = mNumBins * mNumChannels;
+        float* mag = mCache->mMag.data();
+        if (mLayout == Layout::Polar) {
+            std::copy_n(mA, n, mag);
+        } else {
+            computePower();
+            const float* pw = mCache->mPow.data();
+            for (int32_t k = 0; k < n; ++k) mag[k] = std::sqrt(pw[k]);
+        }
+        mCache->mValid |= SpectralViewCache::kMagnitude;
+    }
+    return mCache->mMag.data() + ch * mNumBins;
+}
+
+const float* SpectralFrame::powerView(int32_t ch) {
+    if (mCache == nullptr) return nullptr;
+    computePower();
+    return mCache->mPow.data() + ch * mNumBins;
+}
+
+const float* SpectralFrame::logPowerView(int32_t ch) {
+    if (mCache == nullptr) return nullptr;
+    if (!mCache->isValid(SpectralViewCache::kLogPower)) {
+        computePower();
+        const int32_t n = mNumBins * mNumChannels;
+        const float* pw = mCache->mPow.data();
+        float* lp = mCache->mLogPow.data();
+        for (int32_t k = 0; k < n; ++k) lp[k] = fastmath::logApprox(pw[k] + kLogPowerFloor);
+        mCache->mValid |= SpectralViewCache::kLogPower;
+    }
+    return mCache->mLogPow.data() + ch * mNumBins;
+}
+
+const float* SpectralFrame::phaseView(int32_t ch) {
+    if (mCache == nullptr) return nullptr;
+    if (!mCache->isValid(SpectralViewCache::kPhase)) {
+        const int32_t n = mNumBins * mNumChannels;
+        float* ph = mCache->mPhase.data();
+        if (mLayout == Layout::Polar) {
+            std::copy_n(mB, n, ph);
+        } else {
+            for (int32_t k = 0; k < n; ++k) ph[k] = fastmath::atan2Approx(mB[k], mA[k]);
+        }
+        mCache->mValid |= SpectralViewCache::kPhase;
+    }
+    return mCache->mPhase.data() + ch * mNumBins;
+}
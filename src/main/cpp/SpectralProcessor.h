@@ -0,0 +1,206 @@
+// SpectralProcessor.h
+#pragma once
+#include <cstdint>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+class SpectralHistory;
+
+/**
+ * Per-hop metadata handed to every spectral processor together with the bins.
+ */
+struct SpectralHopInfo {
+    uint64_t hopIndex       = 0; // 0-based hop counter since the STFT was created
+    uint64_t streamFrame    = 0; // input sample index of the first sample of the newest hop
+    int64_t  timestampNanos = 0; // steady_clock time at which the hop was analysed
+    int32_t  sampleRate     = 0; // rate of the STFT time domain (e.g. 16000)
+    int32_t  hopSize        = 0;
+    int32_t  fftSize        = 0;
+    // Spectra of recent hops including this one (before any processing), or
+    // nullptr if the STFT keeps no history (Config::historyHops == 0)
+    const SpectralHistory* history = nullptr;
+};
+
+/**
+ * Storage for the derived per-bin views of one hop (magnitude, power,
+ * log-power, phase). Owned by the STFT, sized once before streaming; the
+ * frame fills a view the first time it is requested and the values stay
+ * valid until the spectrum is modified or the next hop starts.
+ */
+class SpectralViewCache {
+public:
+    enum View : uint8_t { kMagnitude = 1, kPower = 2, kLogPower = 4, kPhase = 8 };
+
+    // Allocates numBins * numChannels floats per view. Not for the audio thread.
+    void resize(int32_t numBins, int32_t numChannels) {
+        const size_t n = static_cast<size_t>(numBins) * numChannels;
+        mMag.assign(n, 0.0f);
+        mPow.assign(n, 0.0f);
+        mLogPow.assign(n, 0.0f);
+        mPhase.assign(n, 0.0f);
+        mValid = 0;
+    }
+    void invalidate() { mValid = 0; }
+    bool isValid(View v) const { return (mValid & v) != 0; }
+
+private:
+    friend class SpectralFrame;
+    std::vector<float> mMag;
+    std::vector<float> mPow;
+    std::vector<float> mLogPow;
+    std::vector<float> mPhase;
+    uint8_t            mValid = 0;
+};
+
+/**
+ * In-place view of one half-spectrum (DC .. Nyquist, fftSize/2 + 1 bins) per channel.
+ *
+ * Storage is structure-of-arrays: two contiguous float planes, channel-major
+ * (channel c starts at c * numBins). In Cartesian layout they hold (re, im);
+ * in Polar layout the SAME planes hold (magnitude, phase). Switching layout
+ * converts in place, so a processor never sees a copy of the spectrum.
+ *
+ * Derived views (magnitudeView() etc.) are computed lazily for all channels
+ * on first use and memoized in the attached SpectralViewCache, so several
+ * consumers of the same hop share one computation and a view nobody asks
+ * for is never computed. They are read-only, channel-major like the planes,
+ * and independent of the current layout.
+ */
+class SpectralFrame {
+public:
+    enum class Layout { Cartesian, Polar };
+
+    SpectralFrame() = default;
+    SpectralFrame(float* planeA, float* planeB, int32_t numBins, int32_t numChannels = 1,
+                  SpectralViewCache* cache = nullptr)
+            : mA(planeA), mB(planeB), mNumBins(numBins), mNumChannels(numChannels), mCache(cache) {}
+
+    int32_t numBins()     const { return mNumBins; }
+    int32_t numChannels() const { return mNumChannels; }
+    Layout  layout()      const { return mLayout; }
+
+    // Cartesian access (call toCartesian() first if unsure)
+    float* re(int32_t ch = 0) { return mA + ch * mNumBins; }
+    float* im(int32_t ch = 0) { return mB + ch * mNumBins; }
+    const float* re(int32_t ch = 0) const { return mA + ch * mNumBins; }
+    const float* im(int32_t ch = 0) const { return mB + ch * mNumBins; }
+
+    // Polar access (call toPolar() first if unsure)
+    float* magnitude(int32_t ch = 0) { return mA + ch * mNumBins; }
+    float* phase(int32_t ch = 0)     { return mB + ch * mNumBins; }
+    const float* magnitude(int32_t ch = 0) const { return mA + ch * mNumBins; }
+    const float* phase(int32_t ch = 0)     const { return mB + ch * mNumBins; }
+
+    // Lazy derived views; nullptr if the frame has no cache attached.
+    // |X| and |X|^2 are exact. logPowerView() is ln(|X|^2 + kLogPowerFloor) and
+    // phaseView() is arg X, both via fastmath approximations (FastMath.h:
+    // ~1e-5 absolute error). In Polar layout phase is copied exactly.
+    static constexpr float kLogPowerFloor = 1e-12f;
+    const float* magnitudeView(int32_t ch = 0);
+    const float* powerView(int32_t ch = 0);
+    const float* logPowerView(int32_t ch = 0);
+    const float* phaseView(int32_t ch = 0);
+
+    // Drops all memoized views; call after writing to the planes.
+    void invalidateViews() { if (mCache != nullptr) mCache->invalidate(); }
+
+    // In-place layout conversion; no-op if already in the requested layout.
+    void toPolar();
+    void toCartesian();
+    void setLayout(Layout l) { if (l == Layout::Polar) toPolar(); else toCartesian(); }
+
+private:
+    float*  mA = nullptr;
+    float*  mB = nullptr;
+    int32_t mNumBins = 0;
+    int32_t mNumChannels = 1;
+    Layout  mLayout = Layout::Cartesian;
+    SpectralViewCache* mCache = nullptr;
+
+    void computePower();
+};
+
+/**
+ * Interface for effects that operate between the forward and inverse FFT.
+ * processHop() is called once per hop (one virtual call per processor per hop);
+ * the per-bin loop lives inside the implementation.
+ */
+class SpectralProcessor {
+public:
+    virtual ~SpectralProcessor() = default;
+
+    // Layout the frame is converted to before processHop() is called.
+    virtual SpectralFrame::Layout preferredLayout() const { return SpectralFrame::Layout::Cartesian; }
+
+    // Highest frequency this processor reads or modifies; 0 means the full band.
+    // Bins above the chain's maximum are neither converted nor handed over
+    // (frame.numBins() is reduced accordingly) and pass through unchanged.
+    virtual float maxFrequencyHz() const { return 0.0f; }
+
+    // False for analyzers that only read the frame; memoized views then stay
+    // valid for the processors that follow.
+    virtual bool modifiesSpectrum() const { return true; }
+
+    // Called on the audio thread. Must not allocate or block.
+    virtual void processHop(SpectralFrame& frame, const SpectralHopInfo& info) = 0;
+};
+
+/**
+ * Fixed-capacity ordered list of spectral processors.
+ * Not thread-safe: configure it before the audio pipeline starts.
+ * Processors are not owned.
+ */
+class SpectralChain {
+public:
+    static constexpr int kMaxProcessors = 8;
+
+    bool add(SpectralProcessor* p) {
+        if (p == nullptr || mCount >= kMaxProcessors) return false;
+        mProcs[mCount++] = p;
+        return true;
+    }
+
+    bool remove(SpectralProcessor* p) {
+        for (int i = 0; i < mCount; ++i) {
+            if (mProcs[i] == p) {
+                for (int j = i + 1; j < mCount; ++j) mProcs[j - 1] = mProcs[j];
+                mProcs[--mCount] = nullptr;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void clear() { mProcs.fill(nullptr); mCount = 0; }
+    int  size() const { return mCount; }
+    bool empty() const { return mCount == 0; }
+
+    // Number of leading bins (out of allBins) that any processor needs.
+    int binsNeeded(int32_t fftSize, int32_t sampleRate, int allBins) const {
+        int bins = 0;
+        for (int i = 0; i < mCount; ++i) {
+            const float hz = mProcs[i]->maxFrequencyHz();
+            if (hz <= 0.0f || sampleRate <= 0) return allBins;
+            const int b = static_cast<int>(std::ceil(hz * float(fftSize) / float(sampleRate))) + 1;
+            bins = std::max(bins, std::min(b, allBins));
+        }
+        return mCount == 0 ? allBins : bins;
+    }
+
+    // Runs every processor in order, converting the layout only when it changes.
+    // Leaves the frame in Cartesian layout, ready for the inverse FFT.
+    void run(SpectralFrame& frame, const SpectralHopInfo& info) {
+        for (int i = 0; i < mCount; ++i) {
+            frame.setLayout(mProcs[i]->preferredLayout());
+            mProcs[i]->processHop(frame, info);
+            if (mProcs[i]->modifiesSpectrum()) frame.invalidateViews();
+        }
+        frame.toCartesian();
+    }
+
+private:
+    std::array<SpectralProcessor*, kMaxProcessors> mProcs{};
+    int mCount = 0;
+};
@@ -0,0 +1,116 @@
+// StageTimer.cpp
+#include "StageTimer.h"
+
+#if ENGINE_STAGE_TIMING
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+namespace stagetimer {
+
+namespace {
+
+struct StageRecord {
+    metrics::HistogramSnapshot base;   // at configure()
+    std::atomic<int64_t> worstNs[kWorst];
+    std::atomic<int64_t> worstAt[kWorst];
+};
+
+StageRecord gStages[kNumStages];
+std::atomic<int64_t> gPeriodNs{0};
+std::atomic<int64_t> gEpochNs{0};
+
+// Upper bound of the bucket holding quantile q, or the maximum past the last bound
+int64_t quantileNs(const metrics::HistogramSnapshot& s, double q) {
+    const uint64_t want = static_cast<uint64_t>(q * double(s.count));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < s.bounds.size(); ++b) {
+        seen += s.counts[b];
+        if (seen > want) return s.bounds[b];
+    }
+    return s.max;
+}
+
+} // namespace
+
+metrics::Histogram& histogram(Stage s) {
+    struct Table {
+        metrics::Histogram* h[kNumStages];
+        Table() {
+            static const std::vector<int64_t> kLog2Ns = {
+                    1000, 2000, 4000, 8000, 16000, 32000, 64000, 128000, 256000, 512000,
+                    1024000, 2048000, 4096000, 8192000, 16384000};
+            for (int32_t i = 0; i < kNumStages; ++i) {
+                h[i] = &metrics::registry().histogram(
+                        std::string("stage.") + stageName(static_cast<Stage>(i)) + "_ns", kLog2Ns);
+            }
+        }
+    };
+    static const Table table;
+    return *table.h[static_cast<int32_t>(s)];
+}
+
+void record(Stage s, int64_t startNs, int64_t durationNs) {
+    histogram(s).record(durationNs);
+    // Replace the shortest of the worst runs if this one is longer
+    StageRecord& r = gStages[static_cast<int32_t>(s)];
+    int32_t slot = 0;
+    for (int32_t w = 1; w < kWorst; ++w) {
+        if (r.worstNs[w].load(std::memory_order_relaxed) <
+            r.worstNs[slot].load(std::memory_order_relaxed)) slot = w;
+    }
+    if (durationNs > r.worstNs[slot].load(std::memory_order_relaxed)) {
+        r.worstNs[slot].store(durationNs, std::memory_order_relaxed);
+        r.worstAt[slot].store(startNs, std::memory_order_relaxed);
+    }
+}
+
+void configure(int64_t burstPeriodNanos) {
+    for (int32_t i = 0; i < kNumStages; ++i) {
+        StageRecord& r = gStages[i];
+        r.base = histogram(static_cast<Stage>(i)).snapshot();
+        for (int32_t w = 0; w < kWorst; ++w) {
+            r.worstNs[w].store(0);
+            r.worstAt[w].store(0);
+        }
+    }
+    gPeriodNs.store(burstPeriodNanos);
+    gEpochNs.store(nowNanos());
+}
+
+std::string report() {
+    const double period = double(gPeriodNs.load());
+    const int64_t epoch = gEpochNs.load();
+    std::string out;
+    for (int32_t i = 0; i < kNumStages; ++i) {
+        const StageRecord& r = gStages[i];
+        metrics::HistogramSnapshot snap = histogram(static_cast<Stage>(i)).snapshot();
+        for (size_t b = 0; b < snap.counts.size(); ++b) snap.counts[b] -= r.base.counts[b];
+        snap.count -= r.base.count;
+        snap.sum -= r.base.sum;
+        if (snap.count == 0) continue;
+        int64_t maxNs = 0;
+        for (int32_t w = 0; w < kWorst; ++w) maxNs = std::max(maxNs, r.worstNs[w].load(std::memory_order_relaxed));
+        const double avgNs = double(snap.sum) / double(snap.count);
+        char line[256];
+        int n = std::snprintf(line, sizeof(line),
+                              "%-10s n=%llu p50<=%lld us p99<=%lld us | avg %.1f%% max %.1f%% of burst | worst",
+                              stageName(static_cast<Stage>(i)), (unsigned long long)snap.count,
+                              (long long)quantileNs(snap, 0.50) / 1000, (long long)quantileNs(snap, 0.99) / 1000,
+                              period > 0 ? 100.0 * avgNs / period : 0.0,
+                              period > 0 ? 100.0 * double(maxNs) / period : 0.0);
+        for (int32_t w = 0; w < kWorst && n > 0 && n < static_cast<int>(sizeof(line)); ++w) {
+            const int64_t d = r.worstNs[w].load(std::memory_order_relaxed);
+            if (d <= 0) continue;
+            n += std::snprintf(line + n, sizeof(line) - n, " %.0fus@%.3fs", double(d) / 1e3,
+                               double(r.worstAt[w].load(std::memory_order_relaxed) - epoch) / 1e9);
+        }
+        out += line;
+        out += '\n';
+    }
+    return out;
+}
+
+} // namespace stagetimer
+
+#endif // ENGINE_STAGE_TIMING
@@ -0,0 +1,107 @@
+// StageTimer.h
+#pragma once
+#include <cstdint>
+#include <string>
+#include <time.h>
+#include "Metrics.h"
+#include "TraceSpan.h"
+
+/**
+ * Scoped stage markers: STAGE_TIMER(stage) opens a trace span (TraceSpan.h)
+ * named after the stage, and times it when built with ENGINE_STAGE_TIMING=1
+ * (CMake option of the same name). Otherwise it is the span alone and
+ * nothing below is referenced, so a normal build carries no timing code.
+ * The engine's always-on stage stats do not come from here: they are
+ * metrics::ScopedNanos histograms of their own (engine.capture_ns, ...).
+ *
+ * With timing on, each stage records into "stage.<name>_ns" in the metrics
+ * registry (log2 buckets from 1 us, so dumpMetrics() carries it too), and
+ * report() gives its share of the burst period (fpb / sampleRate) and its
+ * kWorst longest runs with their CLOCK_MONOTONIC start times. Stages are
+ * timed on one thread at a time (the io thread, the STFT worker or the
+ * playback callback), so the worst list uses plain relaxed stores.
+ */
+#ifndef ENGINE_STAGE_TIMING
+#define ENGINE_STAGE_TIMING 0
+#endif
+
+namespace stagetimer {
+
+enum class Stage : int32_t {
+    Read,        // blocking input read() (includes waiting for the device)
+    Capture,     // deinterleave, downmix, downsample, enqueue
+    Downsample,  // decimator bank (inside Capture)
+    Stft,        // one drain: STFT, spectral processors, upsample, out ring write
+    Upsample,    // interpolator bank (inside Stft)
+    Callback,    // whole playback data callback
+    Count
+};
+constexpr int32_t kNumStages = static_cast<int32_t>(Stage::Count);
+constexpr int32_t kWorst = 4;
+
+// Also the span name, so a string literal
+constexpr const char* stageName(Stage s) {
+    switch (s) {
+        case Stage::Read:       return "read";
+        case Stage::Capture:    return "capture";
+        case Stage::Downsample: return "downsample";
+        case Stage::Stft:       return "stft";
+        case Stage::Upsample:   return "upsample";
+        case Stage::Callback:   return "callback";
+        case Stage::Count:      break;
+    }
+    return "?";
+}
+
+#if ENGINE_STAGE_TIMING
+inline int64_t nowNanos() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+// The stage's registry histogram (ns); registered on first use
+metrics::Histogram& histogram(Stage s);
+
+void record(Stage s, int64_t startNs, int64_t durationNs);
+
+// Sets the period that budget figures refer to and starts a new report
+// interval (the histograms are cumulative). Off the audio path.
+void configure(int64_t burstPeriodNanos);
+
+// One line per stage that ran since configure(): calls, p50/p99 (bucket
+// upper bounds), average and worst share of the burst period, and the worst
+// runs as "duration @ seconds since configure()". Not for the audio path.
+std::string report();
+
+template <Stage S>
+class ScopedTimer {
+public:
+    ScopedTimer() : mStart(nowNanos()) { tracing::beginSpan(stageName(S)); }
+    ~ScopedTimer() {
+        const int64_t end = nowNanos();
+        tracing::endSpan();
+        record(S, mStart, end - mStart);
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+private:
+    int64_t mStart;
+};
+#else
+template <Stage S>
+class ScopedTimer {
+public:
+    ScopedTimer() { tracing::beginSpan(stageName(S)); }
+    ~ScopedTimer() { tracing::endSpan(); }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+#endif
+
+} // namespace stagetimer
+
+#define STAGE_TIMER_CAT2(a, b) a##b
+#define STAGE_TIMER_CAT(a, b) STAGE_TIMER_CAT2(a, b)
+#define STAGE_TIMER(stage) \
+    stagetimer::ScopedTimer<stagetimer::Stage::stage> STAGE_TIMER_CAT(stageTimer_, __LINE__)
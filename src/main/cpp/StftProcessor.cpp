@@ -2,100 +2,479 @@
 #include "StftProcessor.h"
 #include <cmath>
 #include <algorithm>
+#include <chrono>
 
-static inline float hann512(int n, int N) {
+static inline float hannSymmetric(int n, int N) {
     // Hann with periodic = false (common DSP convention)
     return 0.5f * (1.0f - std::cos(2.0f * float(M_PI) * float(n) / float(N - 1)));
 }
 
-StftProcessor::StftProcessor() {
+static inline double hannPeriodic(int n, int L) {
+    // Periodic Hann of length L (sums to 1 at hop L/2)
+    return 0.5 * (1.0 - std::cos(2.0 * M_PI * double(n) / double(L)));
+}
+
+static inline bool isPow2(int v) { return v > 0 && (v & (v - 1)) == 0; }
+
+StftProcessor::StftProcessor() : StftProcessor(Config::mid16k()) {}
+
+StftProcessor::StftProcessor(const Config& config) {
+    if (!configure(config)) configure(Config::mid16k());
+}
+
+bool StftProcessor::configure(const Config& config) {
+    const int N = config.fftSize;
+    const int H = config.hopSize;
+    if (!isPow2(N) || N > 32768) return false;  // bit-reversal table is uint16_t
+    if (H <= 0 || config.frameSize < H || config.frameSize > N) return false;
+    if (mMode == WindowMode::LowDelay && 2 * H > N) return false;
+
+    mCfg  = config;
+    mBins = N / 2 + 1;
+    mHist = config.frameSize - H;
+    mPad  = N - config.frameSize;
+
     // windows
-    mWin.resize(kNFFT);
-    for (int i = 0; i < kNFFT; ++i) mWin[i] = hann512(i, kNFFT);
+    mAnaWin.resize(N);
+    mSynWin.resize(N);
+    mWinProd.resize(N);
+    buildWindows();
+
+    // FFT tables (shared by the single-hop and batch paths)
+    mTwRe.resize(N / 2);
+    mTwIm.resize(N / 2);
+    for (int k = 0; k < N / 2; ++k) {
+        const double ang = 2.0 * M_PI * double(k) / double(N);
+        mTwRe[k] = float(std::cos(ang));
+        mTwIm[k] = float(-std::sin(ang));
+    }
+    mBitRev.resize(N);
+    for (int i = 0, j = 0; i < N; ++i) {
+        mBitRev[i] = static_cast<uint16_t>(j);
+        int bit = N >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+    }
 
     // input hop and history
-    mHopBuf.assign(kHOP, 0.0f);
-    mHist384.assign(384, 0.0f);
+    mHopBuf.assign(H, 0.0f);
+    mHopBufR.assign(H, 0.0f);
+    mHistBuf.assign(mHist, 0.0f);
+    mHistBufR.assign(mHist, 0.0f);
 
     // scratches
-    mFFTIn.resize(kNFFT);
-    mFFTOut.resize(kNFFT);
-    mTime512.assign(kNFFT, 0.0f);
-    mTimeWin.assign(kNFFT, 0.0f);
+    mFFTIn.resize(N);
+    mFFTOut.resize(N);
+    mTimeBuf.assign(N, 0.0f);
+    mTimeWin.assign(N, 0.0f);
+    mTimeWinR.assign(N, 0.0f);
+    mIFFTBuf.resize(N);
+    mBinA.assign(static_cast<size_t>(mBins) * 2, 0.0f);
+    mBinB.assign(static_cast<size_t>(mBins) * 2, 0.0f);
+    mViews.resize(mBins, 2);
+    mHistory.init(config.historyHops, mBins, mChannels);
+    updateChainBins();
+
+    // batch scratch
+    const size_t span = static_cast<size_t>(N) + (kMaxBatchHops - 1) * H;
+    mBatchTimeline.assign(mHist + kMaxBatchHops * H, 0.0f);
+    mBatchTimelineR.assign(mHist + kMaxBatchHops * H, 0.0f);
+    mBatchRe.assign(static_cast<size_t>(N) * kMaxBatchHops, 0.0f);
+    mBatchIm.assign(static_cast<size_t>(N) * kMaxBatchHops, 0.0f);
+    mBatchOla.assign(span, 0.0f);
+    mBatchOlaR.assign(span, 0.0f);
+    mBatchNorm.assign(span, 0.0f);
 
-    // OLA ring: power-of-two capacity, plenty of headroom (>= 8 hops)
-    const size_t cap = 1u << 15; // 32768 samples
+    // OLA ring: power-of-two capacity, plenty of headroom (>= 8 hops past a frame)
+    size_t cap = 1u << 15; // 32768 samples
+    while (cap < 4 * span) cap <<= 1;
     mOlaBuf.assign(cap, 0.0f);
+    mOlaBufR.assign(cap, 0.0f);
     mNormBuf.assign(cap, 0.0f);
-    mOlaWrite = 0;
-    mOlaRead  = 0;
     mOlaMask  = cap - 1;
+    resetStream();
+    return true;
+}
+
+void StftProcessor::setWindowMode(WindowMode mode) {
+    if (mode == WindowMode::LowDelay && 2 * mCfg.hopSize > mCfg.fftSize) return;
+    mMode = mode;
+    buildWindows();
+    resetStream();
+}
+
+void StftProcessor::setChannelCount(int channels) {
+    mChannels = (channels >= 2) ? 2 : 1;
+    mHistory.init(mCfg.historyHops, mBins, mChannels);
+    resetStream();
+}
+
+bool StftProcessor::addSpectralProcessor(SpectralProcessor* p) {
+    if (!mChain.add(p)) return false;
+    updateChainBins();
+    return true;
+}
+
+bool StftProcessor::removeSpectralProcessor(SpectralProcessor* p) {
+    if (!mChain.remove(p)) return false;
+    updateChainBins();
+    return true;
+}
+
+void StftProcessor::updateChainBins() {
+    mChainBins = mChain.binsNeeded(mCfg.fftSize, mCfg.sampleRate, mBins);
+}
+
+void StftProcessor::buildWindows() {
+    const int N = mCfg.fftSize;
+    if (mMode == WindowMode::Symmetric) {
+        // Hann over the analysis frame only; the zero-pad region gets zero
+        // weight so it does not inflate the OLA normalization
+        const int F = mCfg.frameSize;
+        for (int i = 0; i < N; ++i) {
+            mAnaWin[i] = (i < mPad) ? 0.0f : hannSymmetric(i - mPad, F);
+            mSynWin[i] = mAnaWin[i];
+        }
+        // Nothing lands in the pad region, so output starts at the frame itself
+        mReadOffset = mPad;
+    } else {
+        // K = frame, M = hop. Analysis: rising half of a sqrt-Hann(2(K-M)), then the
+        // falling half of a sqrt-Hann(2M). Synthesis: zero except the last 2M
+        // samples, chosen so that ana * syn == Hann(2M) there.
+        const int K = N;
+        const int M = mCfg.hopSize;
+        for (int n = 0; n < K; ++n) {
+            double a, y;
+            if (n < K - M) {
+                a = std::sqrt(hannPeriodic(n, 2 * (K - M)));
+            } else {
+                a = std::sqrt(hannPeriodic(n - (K - 2 * M), 2 * M));
+            }
+            if (n < K - 2 * M) {
+                y = 0.0;
+            } else if (n < K - M) {
+                y = hannPeriodic(n - (K - 2 * M), 2 * M) / a;
+            } else {
+                y = a;
+            }
+            mAnaWin[n] = float(a);
+            mSynWin[n] = float(y);
+        }
+        // Only the last 2M samples of a frame carry output; the first of those
+        // hops is complete as soon as the frame has been added.
+        mReadOffset = K - 2 * M;
+    }
+    for (int i = 0; i < N; ++i) mWinProd[i] = mAnaWin[i] * mSynWin[i];
+}
+
+void StftProcessor::resetStream() {
+    mHopFill = 0;
+    std::fill(mHistBuf.begin(), mHistBuf.end(), 0.0f);
+    std::fill(mHistBufR.begin(), mHistBufR.end(), 0.0f);
+    std::fill(mOlaBuf.begin(), mOlaBuf.end(), 0.0f);
+    std::fill(mOlaBufR.begin(), mOlaBufR.end(), 0.0f);
+    std::fill(mNormBuf.begin(), mNormBuf.end(), 0.0f);
+    mOlaWrite = 0;
+    mOlaRead  = static_cast<size_t>(mReadOffset);
     mAvail    = 0;
+    mHistory.reset();
+}
+
+void StftProcessor::pushTimeDomain(const float* mono, int frames) {
+    pushPlanar(mono, nullptr, frames);
 }
 
-void StftProcessor::pushTimeDomain(const float* mono16, int frames) {
-    mPushed += static_cast<uint64_t>(frames);
+void StftProcessor::pushTimeDomainStereo(const float* left, const float* right, int frames) {
+    pushPlanar(left, right, frames);
+}
+
+void StftProcessor::pushPlanar(const float* ch0, const float* ch1, int frames) {
+    const bool stereo = (mChannels == 2);
+    const int H = mCfg.hopSize;
+    advance(mPushed, static_cast<uint64_t>(frames));
     int idx = 0;
     while (idx < frames) {
-        const int need = kHOP - mHopFill;
+        // Catch-up path: hop-aligned with several whole hops pending
+        if (mHopFill == 0 && mMaxBatch > 1) {
+            const int hops = std::min((frames - idx) / H, mMaxBatch);
+            if (hops >= 2) {
+                processHopBatch(ch0 + idx, stereo ? ch1 + idx : nullptr, hops);
+                idx += hops * H;
+                continue;
+            }
+        }
+
+        const int need = H - mHopFill;
         const int take = std::min(need, frames - idx);
-        std::copy_n(mono16 + idx, take, mHopBuf.begin() + mHopFill);
+        std::copy_n(ch0 + idx, take, mHopBuf.begin() + mHopFill);
+        if (stereo) std::copy_n(ch1 + idx, take, mHopBufR.begin() + mHopFill);
         mHopFill += take;
         idx      += take;
 
-        if (mHopFill == kHOP) {
+        if (mHopFill == H) {
             processOneHop();  // consumes mHopBuf
             mHopFill = 0;
 
-            // Update 384-history: drop 96, append 96 new
-            // old hist: [0..383] -> keep 288 (from 96..383) and append 96 from hop
-            std::move(mHist384.begin() + kHOP, mHist384.end(), mHist384.begin());
-            std::copy_n(mHopBuf.begin(), kHOP, mHist384.begin() + (384 - kHOP));
+            // Update history: drop one hop, append the new one
+            // (if the overlap is shorter than a hop, keep only the hop's tail)
+            const int keep = std::min(H, mHist);
+            std::move(mHistBuf.begin() + keep, mHistBuf.end(), mHistBuf.begin());
+            std::copy_n(mHopBuf.begin() + (H - keep), keep, mHistBuf.begin() + (mHist - keep));
+            if (stereo) {
+                std::move(mHistBufR.begin() + keep, mHistBufR.end(), mHistBufR.begin());
+                std::copy_n(mHopBufR.begin() + (H - keep), keep, mHistBufR.begin() + (mHist - keep));
+            }
         }
     }
 }
 
 void StftProcessor::processOneHop() {
-    // Build 512-sample analysis frame:
-    // first 32 are zeros, next 480 = 384 from history + 96 new hop
-    std::fill(mTime512.begin(), mTime512.end(), 0.0f);
-    // copy history (384) to positions [32..415]
-    std::copy_n(mHist384.begin(), 384, mTime512.begin() + 32);
-    // copy new hop (96) to positions [416..511]
-    std::copy_n(mHopBuf.begin(), kHOP, mTime512.begin() + 32 + 384);
+    const int N = mCfg.fftSize;
+    const int H = mCfg.hopSize;
+
+    // Build NFFT-sample analysis frame:
+    // first mPad are zeros, then (frame - hop) from history + one new hop
+    // (default geometry: 32 zeros, 384 history at [32..415], 96 new at [416..511])
+    std::fill(mTimeBuf.begin(), mTimeBuf.begin() + mPad, 0.0f);
+    std::copy_n(mHistBuf.begin(), mHist, mTimeBuf.begin() + mPad);
+    std::copy_n(mHopBuf.begin(), H, mTimeBuf.begin() + mPad + mHist);
 
     // Analysis window
-    for (int i = 0; i < kNFFT; ++i) mTimeWin[i] = mTime512[i] * mWin[i];
+    for (int i = 0; i < N; ++i) mTimeWin[i] = mTimeBuf[i] * mAnaWin[i];
 
-    // Pack to complex
-    for (int i = 0; i < kNFFT; ++i) mFFTIn[i] = std::complex<float>(mTimeWin[i], 0.0f);
+    // Pack to complex (stereo: right channel goes into the imaginary part)
+    if (mChannels == 2) {
+        std::copy_n(mHistBufR.begin(), mHist, mTimeBuf.begin() + mPad);
+        std::copy_n(mHopBufR.begin(), H, mTimeBuf.begin() + mPad + mHist);
+        for (int i = 0; i < N; ++i) {
+            mFFTIn[i] = std::complex<float>(mTimeWin[i], mTimeBuf[i] * mAnaWin[i]);
+        }
+    } else {
+        for (int i = 0; i < N; ++i) mFFTIn[i] = std::complex<float>(mTimeWin[i], 0.0f);
+    }
 
     // FFT
     mFFTOut = mFFTIn;
     fft(mFFTOut, /*inverse=*/false);
 
-    // Identity processing (Y = X)
-    // (do nothing)
+    // History, then spectral processing (identity when no processors are attached)
+    float* spec = reinterpret_cast<float*>(mFFTOut.data());
+    if (mHistory.capacity() > 0) recordHistory(spec, spec + 1, 2);
+    if (!mChain.empty()) runSpectralChain(spec, spec + 1, 2, hopsProcessed());
 
     // iFFT
-    auto y = mFFTOut;
-    fft(y, /*inverse=*/true); // returns scaled by 1/N internally
+    std::copy(mFFTOut.begin(), mFFTOut.end(), mIFFTBuf.begin());
+    fft(mIFFTBuf, /*inverse=*/true); // returns scaled by 1/N internally
 
     // Synthesis window and OLA
-    for (int i = 0; i < kNFFT; ++i) mTimeWin[i] = y[i].real() * mWin[i];
-    olaAdd(mTimeWin.data());
+    for (int i = 0; i < N; ++i) mTimeWin[i] = mIFFTBuf[i].real() * mSynWin[i];
+    if (mChannels == 2) {
+        for (int i = 0; i < N; ++i) mTimeWinR[i] = mIFFTBuf[i].imag() * mSynWin[i];
+        olaAdd(mTimeWin.data(), mTimeWinR.data());
+    } else {
+        olaAdd(mTimeWin.data(), nullptr);
+    }
 
-    // After OLA add, we made exactly kHOP new samples available.
-    mAvail += kHOP;
-    mHops += 1;
+    // After OLA add, we made exactly one hop of new samples available.
+    mAvail += H;
+    advance(mHops, 1);
 }
 
-int StftProcessor::popTimeDomain(float* out16, int maxFrames) {
+void StftProcessor::processHopBatch(const float* newSamples, const float* newSamplesR, int hops) {
+    const int K = hops;
+    const int N = mCfg.fftSize;
+    const int H = mCfg.hopSize;
+    constexpr int L = kMaxBatchHops; // lane stride
+    const bool stereo = (newSamplesR != nullptr);
+
+    // Contiguous timeline: [history | K * hop new]; frame b starts at b * hop
+    std::copy_n(mHistBuf.begin(), mHist, mBatchTimeline.begin());
+    std::copy_n(newSamples, K * H, mBatchTimeline.begin() + mHist);
+    if (stereo) {
+        std::copy_n(mHistBufR.begin(), mHist, mBatchTimelineR.begin());
+        std::copy_n(newSamplesR, K * H, mBatchTimelineR.begin() + mHist);
+    }
+
+    // Analysis window, one pass: each window value is applied across all K lanes
+    // (stereo: right channel packed into the imaginary lanes)
+    for (int n = 0; n < mPad; ++n) {
+        std::fill_n(&mBatchRe[n * L], K, 0.0f);
+        std::fill_n(&mBatchIm[n * L], K, 0.0f);
+    }
+    for (int n = mPad; n < N; ++n) {
+        const float w = mAnaWin[n];
+        const float* src = &mBatchTimeline[n - mPad];
+        float* dst = &mBatchRe[n * L];
+        for (int b = 0; b < K; ++b) dst[b] = w * src[b * H];
+        float* dstI = &mBatchIm[n * L];
+        if (stereo) {
+            const float* srcR = &mBatchTimelineR[n - mPad];
+            for (int b = 0; b < K; ++b) dstI[b] = w * srcR[b * H];
+        } else {
+            std::fill_n(dstI, K, 0.0f);
+        }
+    }
+
+    fftBatch(K, /*inverse=*/false);
+
+    // Lane by lane, so hop b sees the history up to and including itself
+    if (mHistory.capacity() > 0 || !mChain.empty()) {
+        for (int b = 0; b < K; ++b) {
+            if (mHistory.capacity() > 0) recordHistory(&mBatchRe[b], &mBatchIm[b], L);
+            if (!mChain.empty()) runSpectralChain(&mBatchRe[b], &mBatchIm[b], L, hopsProcessed() + b);
+        }
+    }
+
+    fftBatch(K, /*inverse=*/true);
+
+    // Synthesis window into a local OLA span, then a single flush into the ring
+    const int span = N + (K - 1) * H;
+    std::fill_n(mBatchOla.begin(), span, 0.0f);
+    std::fill_n(mBatchNorm.begin(), span, 0.0f);
+    if (stereo) std::fill_n(mBatchOlaR.begin(), span, 0.0f);
+    const float invN = 1.0f / float(N);
+    for (int b = 0; b < K; ++b) {
+        float* ola  = &mBatchOla[b * H];
+        float* norm = &mBatchNorm[b * H];
+        for (int n = 0; n < N; ++n) {
+            ola[n]  += mBatchRe[n * L + b] * invN * mSynWin[n];
+            norm[n] += mWinProd[n];
+        }
+        if (stereo) {
+            float* olaR = &mBatchOlaR[b * H];
+            for (int n = 0; n < N; ++n) olaR[n] += mBatchIm[n * L + b] * invN * mSynWin[n];
+        }
+    }
+    for (int j = 0; j < span; ++j) {
+        const size_t idx = (mOlaWrite + j) & mOlaMask;
+        mOlaBuf[idx]  += mBatchOla[j];
+        mNormBuf[idx] += mBatchNorm[j];
+    }
+    if (stereo) {
+        for (int j = 0; j < span; ++j) mOlaBufR[(mOlaWrite + j) & mOlaMask] += mBatchOlaR[j];
+    }
+    mOlaWrite = (mOlaWrite + static_cast<size_t>(K) * H) & mOlaMask;
+
+    // History = last (frame - hop) samples of the timeline
+    std::copy_n(mBatchTimeline.begin() + K * H, mHist, mHistBuf.begin());
+    if (stereo) std::copy_n(mBatchTimelineR.begin() + K * H, mHist, mHistBufR.begin());
+
+    mAvail   += static_cast<size_t>(K) * H;
+    advance(mHops, static_cast<uint64_t>(K));
+    advance(mBatches, 1);
+}
+
+void StftProcessor::recordHistory(const float* re, const float* im, size_t stride) {
+    const int N = mCfg.fftSize;
+    float* hr = mHistory.nextRe();
+    float* hi = mHistory.nextIm();
+    if (mChannels == 2) {
+        // same separation as runSpectralChain, over all bins
+        float* hrR = hr + mBins;
+        float* hiR = hi + mBins;
+        for (int k = 0; k < mBins; ++k) {
+            const size_t nk = static_cast<size_t>((N - k) & (N - 1));
+            const float zr = re[k * stride],  zi = im[k * stride];
+            const float cr = re[nk * stride], ci = -im[nk * stride];
+            hr[k]  = 0.5f * (zr + cr);
+            hi[k]  = 0.5f * (zi + ci);
+            hrR[k] = 0.5f * (zi - ci);
+            hiR[k] = 0.5f * (cr - zr);
+        }
+    } else {
+        for (int k = 0; k < mBins; ++k) {
+            hr[k] = re[k * stride];
+            hi[k] = im[k * stride];
+        }
+    }
+    mHistory.commit();
+}
+
+void StftProcessor::runSpectralChain(float* re, float* im, size_t stride, uint64_t hopIndex) {
+    const int N  = mCfg.fftSize;
+    const int nb = mChainBins;  // bins at and above nb pass through untouched
+    float* aL = mBinA.data();
+    float* bL = mBinB.data();
+    float* aR = mBinA.data() + nb;
+    float* bR = mBinB.data() + nb;
+
+    // Split: bins 0..nb-1 into SoA planes
+    if (mChannels == 2) {
+        // Z = X_L + j X_R; with Zc = conj(Z[N-k]):
+        // X_L = (Z + Zc) / 2, X_R = (Z - Zc) / 2j
+        for (int k = 0; k < nb; ++k) {
+            const size_t nk = static_cast<size_t>((N - k) & (N - 1));
+            const float zr = re[k * stride],  zi = im[k * stride];
+            const float cr = re[nk * stride], ci = -im[nk * stride];
+            aL[k] = 0.5f * (zr + cr);
+            bL[k] = 0.5f * (zi + ci);
+            aR[k] = 0.5f * (zi - ci);
+            bR[k] = 0.5f * (cr - zr);
+        }
+    } else {
+        for (int k = 0; k < nb; ++k) {
+            aL[k] = re[k * stride];
+            bL[k] = im[k * stride];
+        }
+    }
+
+    SpectralHopInfo info;
+    info.hopIndex       = hopIndex;
+    info.streamFrame    = hopIndex * static_cast<uint64_t>(mCfg.hopSize);
+    info.timestampNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    info.sampleRate     = mCfg.sampleRate;
+    info.hopSize        = mCfg.hopSize;
+    info.fftSize        = N;
+    info.history        = (mHistory.capacity() > 0) ? &mHistory : nullptr;
+
+    mViews.invalidate();
+    SpectralFrame frame(mBinA.data(), mBinB.data(), nb, mChannels, &mViews);
+    mChain.run(frame, info);
+
+    // Merge: rebuild the full spectrum with Hermitian symmetry so the iFFT stays real
+    // (per channel; in stereo Z = Y_L + j Y_R over all N bins)
+    const int mirrorEnd = std::min(nb, N / 2);
+    if (mChannels == 2) {
+        for (int k = 0; k < nb; ++k) {
+            re[k * stride] = aL[k] - bR[k];
+            im[k * stride] = bL[k] + aR[k];
+        }
+        for (int k = 1; k < mirrorEnd; ++k) {
+            re[(N - k) * stride] = aL[k] + bR[k];
+            im[(N - k) * stride] = aR[k] - bL[k];
+        }
+    } else {
+        for (int k = 0; k < nb; ++k) {
+            re[k * stride] = aL[k];
+            im[k * stride] = bL[k];
+        }
+        for (int k = 1; k < mirrorEnd; ++k) {
+            re[(N - k) * stride] =  aL[k];
+            im[(N - k) * stride] = -bL[k];
+        }
+    }
+}
+
+int StftProcessor::popTimeDomain(float* out, int maxFrames) {
+    return popPlanar(out, nullptr, maxFrames);
+}
+
+int StftProcessor::popTimeDomainStereo(float* left, float* right, int maxFrames) {
+    return popPlanar(left, right, maxFrames);
+}
+
+int StftProcessor::popPlanar(float* ch0, float* ch1, int maxFrames) {
     const int want = std::min<int>(maxFrames, static_cast<int>(mAvail));
     for (int i = 0; i < want; ++i) {
         const size_t idx = (mOlaRead + i) & mOlaMask;
         const float n = mNormBuf[idx];
-        out16[i] = (n > kEps) ? (mOlaBuf[idx] / n) : 0.0f;
+        const float g = (n > kEps) ? (1.0f / n) : 0.0f;
+        ch0[i] = mOlaBuf[idx] * g;
+        if (ch1 != nullptr) {
+            ch1[i] = mOlaBufR[idx] * g;
+            mOlaBufR[idx] = 0.0f;
+        }
 
         // clear after reading (keeps buffers bounded)
         mOlaBuf[idx]  = 0.0f;
@@ -103,37 +482,33 @@ int StftProcessor::popTimeDomain(float* out16, int maxFrames) {
     }
     mOlaRead = (mOlaRead + want) & mOlaMask;
     mAvail  -= want;
-    mPopped += static_cast<uint64_t>(want);
+    advance(mPopped, static_cast<uint64_t>(want));
     return want;
 }
 
-// ===== FFT (radix-2, N=512) =====
+// ===== FFT (radix-2, N=NFFT) =====
 void StftProcessor::fft(std::vector<std::complex<float>>& a, bool inverse) {
-    // length must be power of two (512)
+    // length must be NFFT (tables are sized for it)
     const size_t n = a.size();
 
     // bit-reverse
-    size_t j = 0;
-    for (size_t i = 1; i < n; ++i) {
-        size_t bit = n >> 1;
-        for (; j & bit; bit >>= 1) j ^= bit;
-        j ^= bit;
+    for (size_t i = 0; i < n; ++i) {
+        const size_t j = mBitRev[i];
         if (i < j) std::swap(a[i], a[j]);
     }
 
-    // Cooley–Tukey
+    // Cooley–Tukey with tabulated twiddles
+    const float sign = inverse ? -1.0f : 1.0f;
     for (size_t len = 2; len <= n; len <<= 1) {
-        const float ang = (inverse ? 2.0f : -2.0f) * float(M_PI) / float(len);
-        const std::complex<float> wlen(std::cos(ang), std::sin(ang));
+        const size_t half = len >> 1;
+        const size_t step = n / len;
         for (size_t i = 0; i < n; i += len) {
-            std::complex<float> w(1.0f, 0.0f);
-            const size_t half = len >> 1;
             for (size_t k = 0; k < half; ++k) {
+                const std::complex<float> w(mTwRe[k * step], sign * mTwIm[k * step]);
                 auto u = a[i + k];
                 auto v = a[i + k + half] * w;
                 a[i + k]         = u + v;
                 a[i + k + half]  = u - v;
-                w *= wlen;
             }
         }
     }
@@ -144,11 +519,60 @@ void StftProcessor::fft(std::vector<std::complex<float>>& a, bool inverse) {
     }
 }
 
-void StftProcessor::olaAdd(const float* block512) {
-    for (int i = 0; i < kNFFT; ++i) {
+void StftProcessor::fftBatch(int hops, bool inverse) {
+    // Same radix-2 network as fft(), but every butterfly operates on a row of
+    // 'hops' lanes, so the innermost loop is contiguous and vectorizes.
+    // No 1/N scaling here; the batch synthesis folds it into the window.
+    constexpr int L = kMaxBatchHops;
+    const int K = hops;
+    const int N = mCfg.fftSize;
+    float* re = mBatchRe.data();
+    float* im = mBatchIm.data();
+
+    for (int i = 0; i < N; ++i) {
+        const int j = mBitRev[i];
+        if (i < j) {
+            for (int b = 0; b < K; ++b) {
+                std::swap(re[i * L + b], re[j * L + b]);
+                std::swap(im[i * L + b], im[j * L + b]);
+            }
+        }
+    }
+
+    const float sign = inverse ? -1.0f : 1.0f;
+    for (int len = 2; len <= N; len <<= 1) {
+        const int half = len >> 1;
+        const int step = N / len;
+        for (int k = 0; k < half; ++k) {
+            const float wr = mTwRe[k * step];
+            const float wi = sign * mTwIm[k * step];
+            for (int i = k; i < N; i += len) {
+                float* ur = &re[i * L];
+                float* ui = &im[i * L];
+                float* vr = &re[(i + half) * L];
+                float* vi = &im[(i + half) * L];
+                for (int b = 0; b < K; ++b) {
+                    const float tr = vr[b] * wr - vi[b] * wi;
+                    const float ti = vr[b] * wi + vi[b] * wr;
+                    vr[b] = ur[b] - tr;
+                    vi[b] = ui[b] - ti;
+                    ur[b] += tr;
+                    ui[b] += ti;
+                }
+            }
+        }
+    }
+}
+
+void StftProcessor::olaAdd(const float* block, const float* blockR) {
+    const int N = mCfg.fftSize;
+    for (int i = 0; i < N; ++i) {
         const size_t idx = (mOlaWrite + i) & mOlaMask;
-        mOlaBuf[idx]  += block512[i];
-        mNormBuf[idx] += mWin[i] * mWin[i];
+        mOlaBuf[idx]  += block[i];
+        mNormBuf[idx] += mWinProd[i];
+    }
+    if (blockR != nullptr) {
+        for (int i = 0; i < N; ++i) mOlaBufR[(mOlaWrite + i) & mOlaMask] += blockR[i];
     }
-    mOlaWrite = (mOlaWrite + kHOP) & mOlaMask;
+    mOlaWrite = (mOlaWrite + mCfg.hopSize) & mOlaMask;
 }
\ No newline at end of file
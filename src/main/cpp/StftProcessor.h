@@ -1,68 +1,220 @@
 // StftProcessor.h
 #pragma once
 #include <vector>
+#include <atomic>
 #include <complex>
 #include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include "SpectralProcessor.h"
+#include "SpectralHistory.h"
 
 class StftProcessor {
 public:
+    // Geometry of the transform. The analysis frame is zero-padded at the
+    // front up to fftSize (power of two); overlap = frameSize - hopSize.
+    struct Config {
+        int fftSize    = 512;
+        int frameSize  = 480;   // 384 overlap + 96 new
+        int hopSize    = 96;
+        int sampleRate = 16000; // only reported to spectral processors
+        int historyHops = 0;    // spectral history depth in hops (0 = none)
+
+        // Default 16 kHz path: NFFT=512, hop=96, analysis frame=480
+        static Config mid16k() { return Config{}; }
+        // Device-rate path: 32 ms frame, 6 ms hop, full 0..24 kHz band
+        static Config native48k() { return Config{2048, 1536, 288, 48000}; }
+    };
+
     // NFFT=512, hop=96, analysis frame=480 (zero-pad to 512)
     StftProcessor();
+    explicit StftProcessor(const Config& config);
+
+    // Re-allocates for a new geometry and clears all stream state. Call before streaming.
+    // Returns false (and keeps the old geometry) if the config is invalid.
+    bool configure(const Config& config);
+    const Config& config() const { return mCfg; }
+
+    // Symmetric: Hann(frame) analysis and synthesis, delay = frame - hop
+    //            (384 samples = 24 ms at the default 16 kHz geometry).
+    // LowDelay:  asymmetric pair (Mauler & Martin 2007). The analysis window keeps
+    //            the NFFT-point support, so frequency resolution is unchanged. The
+    //            synthesis window covers only the last 2 hops. Their product is a
+    //            Hann(2*hop) that overlap-adds to 1, and output is read from the
+    //            frame tail, so the delay is one hop (96 samples = 6 ms by default).
+    enum class WindowMode { Symmetric, LowDelay };
+
+    // Rebuilds the windows and clears all stream state. Call before streaming.
+    void setWindowMode(WindowMode mode);
+    WindowMode windowMode() const { return mMode; }
+
+    // Exact input->output delay in samples: out[n] == in[n - delay] for identity processing.
+    // The zero pad never reaches the output, so it costs no latency.
+    int algorithmicDelayFrames() const { return mCfg.fftSize - mCfg.hopSize - mReadOffset; }
+
+    // Upper bound on hops processed together by the batch path.
+    static constexpr int kMaxBatchHops = 8;
+    int hopSize() const { return mCfg.hopSize; }
+    int numBins() const { return mBins; }
+
+    // Feed mono time-domain samples (any count). Internally, every hop it
+    // makes a frame with (frame - hop) overlap, pads to NFFT,
+    // FFT -> spectral chain -> iFFT -> OLA into an internal FIFO.
+    // When the input is hop-aligned and carries several whole hops (the
+    // pipeline is catching up), up to maxBatchHops() hops are processed
+    // together: frames are laid out lane-wise so window, twiddle and
+    // butterfly loops run across hops, and OLA is flushed once per batch.
+    void pushTimeDomain(const float* mono, int frames);
+
+    // 1 disables batching; clamped to [1, kMaxBatchHops].
+    void setMaxBatchHops(int hops) { mMaxBatch = std::max(1, std::min(hops, kMaxBatchHops)); }
+    int  maxBatchHops() const { return mMaxBatch; }
+
+    // Pop up to maxFrames mono samples produced by OLA (normalized).
+    // Returns frames actually written to out.
+    int popTimeDomain(float* out, int maxFrames);
+
+    // 1 (mono, default) or 2 (stereo). Clears stream state; call before streaming.
+    // Stereo packs L and R as the real and imaginary parts of one complex FFT
+    // (the frame is real per channel, so the two spectra separate exactly via
+    // X_L[k] = (Z[k] + Z*[N-k]) / 2, X_R[k] = (Z[k] - Z*[N-k]) / 2j). Two
+    // channels cost one complex FFT pair instead of two. Without spectral
+    // processors the separation is skipped entirely.
+    void setChannelCount(int channels);
+    int  channelCount() const { return mChannels; }
+
+    // Stereo counterparts of pushTimeDomain/popTimeDomain (planar L/R).
+    void pushTimeDomainStereo(const float* left, const float* right, int frames);
+    int  popTimeDomainStereo(float* left, float* right, int maxFrames);
 
-    // Feed mono@16k time-domain samples (any count). Internally,
-    // every 96 samples it makes a 480-frame with 384 overlap, pads to 512,
-    // FFT -> identity -> iFFT -> OLA into an internal FIFO.
-    void pushTimeDomain(const float* mono16, int frames);
+    // Spectral processors run in order on the half-spectrum of every hop,
+    // between the forward and inverse FFT. Only the bins below the highest
+    // maxFrequencyHz() of the chain are split out, converted and merged back;
+    // the rest of the spectrum passes through untouched.
+    // Not owned; configure before streaming.
+    bool addSpectralProcessor(SpectralProcessor* p);
+    bool removeSpectralProcessor(SpectralProcessor* p);
+    void clearSpectralProcessors() { mChain.clear(); mChainBins = mBins; }
 
-    // Pop up to maxFrames mono@16k samples produced by OLA (normalized).
-    // Returns frames actually written to out16.
-    int popTimeDomain(float* out16, int maxFrames);
+    // Unprocessed half-spectra of the last Config::historyHops hops, recorded
+    // right after every forward FFT (separated per channel in stereo). Also
+    // handed to spectral processors through SpectralHopInfo::history.
+    const SpectralHistory& spectralHistory() const { return mHistory; }
 
-    uint64_t framesPushed() const { return mPushed; }
-    uint64_t framesPopped() const { return mPopped; }
-    uint64_t hopsProcessed() const { return mHops; }
+    // Safe to read from any thread (e.g. a stats log while a worker streams)
+    uint64_t framesPushed() const { return mPushed.load(std::memory_order_relaxed); }
+    uint64_t framesPopped() const { return mPopped.load(std::memory_order_relaxed); }
+    uint64_t hopsProcessed() const { return mHops.load(std::memory_order_relaxed); }
+    uint64_t batchesProcessed() const { return mBatches.load(std::memory_order_relaxed); }
+
+    // The per-hop radix-2 transform, in place; a.size() must be fftSize.
+    // Public for benchmarks.
+    void transform(std::vector<std::complex<float>>& a, bool inverse) { fft(a, inverse); }
 
 private:
     // --- constants ---
-    static constexpr int kNFFT   = 512;
-    static constexpr int kHOP    = 96;
-    static constexpr int kFRAME  = 480; // 384 overlap + 96 new
     static constexpr float kEps  = 1e-8f;
 
-    // --- analysis/synthesis window ---
-    std::vector<float> mWin;        // Hann(512)
+    // --- geometry ---
+    Config mCfg;
+    int    mBins = 0;       // NFFT/2 + 1 (DC .. Nyquist)
+    int    mHist = 0;       // frame - hop (overlap kept between hops)
+    int    mPad  = 0;       // NFFT - frame (leading zeros)
+
+    // --- analysis/synthesis windows ---
+    WindowMode         mMode = WindowMode::Symmetric;
+    std::vector<float> mAnaWin;     // analysis window (NFFT)
+    std::vector<float> mSynWin;     // synthesis window (NFFT)
+    std::vector<float> mWinProd;    // ana * syn (OLA normalization)
+    int                mReadOffset = 0; // first frame sample that is complete after its hop
+
+    // --- FFT tables ---
+    std::vector<float>    mTwRe;    // cos(2*pi*k/N), k < N/2
+    std::vector<float>    mTwIm;    // -sin(2*pi*k/N) (forward sign)
+    std::vector<uint16_t> mBitRev;  // bit-reversal permutation of 0..N-1
 
-    // --- small input staging (collect hops of 96) ---
-    std::vector<float> mHopBuf;     // size kHOP
+    int mChannels = 1;
+
+    // --- small input staging (collect one hop) ---
+    std::vector<float> mHopBuf;     // size hop (mono or left)
+    std::vector<float> mHopBufR;    // size hop (right, stereo only)
     int                mHopFill = 0;
 
-    // --- rolling history for 384 overlap ---
-    std::vector<float> mHist384;    // size 384
+    // --- rolling history for the overlap ---
+    std::vector<float> mHistBuf;    // size frame - hop (mono or left)
+    std::vector<float> mHistBufR;   // size frame - hop (right)
 
     // --- scratch buffers for one STFT block ---
-    std::vector<std::complex<float>> mFFTIn;   // 512
-    std::vector<std::complex<float>> mFFTOut;  // 512
-    std::vector<float>               mTime512; // 512
-    std::vector<float>               mTimeWin; // 512
+    std::vector<std::complex<float>> mFFTIn;   // NFFT
+    std::vector<std::complex<float>> mFFTOut;  // NFFT
+    std::vector<float>               mTimeBuf; // NFFT
+    std::vector<float>               mTimeWin; // NFFT
+    std::vector<float>               mTimeWinR; // NFFT (right)
+    std::vector<std::complex<float>> mIFFTBuf; // NFFT
+
+    // --- half-spectrum SoA planes handed to the spectral chain ---
+    std::vector<float> mBinA;     // re (or magnitude), size bins * 2
+    std::vector<float> mBinB;     // im (or phase), size bins * 2
+    SpectralChain      mChain;
+    SpectralViewCache  mViews;         // memoized magnitude/power/log/phase, per hop
+    int                mChainBins = 0; // bins the chain needs (<= mBins)
+    SpectralHistory    mHistory;       // recent forward spectra (mirrored ring)
+
+    // --- batch path scratch (lane-interleaved: index = bin * kMaxBatchHops + hop) ---
+    int                mMaxBatch = kMaxBatchHops;
+    std::vector<float> mBatchTimeline; // history + kMaxBatchHops * hop new
+    std::vector<float> mBatchTimelineR;
+    std::vector<float> mBatchRe;       // NFFT * kMaxBatchHops
+    std::vector<float> mBatchIm;       // NFFT * kMaxBatchHops
+    std::vector<float> mBatchOla;      // NFFT + (kMaxBatchHops-1) * hop
+    std::vector<float> mBatchOlaR;
+    std::vector<float> mBatchNorm;     // same size as mBatchOla
 
-    // --- OLA FIFO (circular) + normalization FIFO (sum of win^2) ---
+    // --- OLA FIFO (circular) + normalization FIFO (sum of ana*syn) ---
     std::vector<float> mOlaBuf;   // big ring
+    std::vector<float> mOlaBufR;  // big ring (right, stereo only)
     std::vector<float> mNormBuf;  // big ring
     size_t             mOlaWrite = 0;
     size_t             mOlaRead  = 0;
     size_t             mOlaMask  = 0; // capacity-1 (power of two)
     size_t             mAvail    = 0; // frames available to pop
 
-    uint64_t mPushed = 0;
-    uint64_t mPopped = 0;
-    uint64_t mHops   = 0;
+    // Written only by the streaming thread (load + relaxed store, no RMW)
+    std::atomic<uint64_t> mPushed{0};
+    std::atomic<uint64_t> mPopped{0};
+    std::atomic<uint64_t> mHops{0};
+    std::atomic<uint64_t> mBatches{0};
+    static void advance(std::atomic<uint64_t>& c, uint64_t n) {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
 
-    // --- FFT helpers (radix-2 iterative, N=512) ---
+    void buildWindows();
+    void resetStream();
+    void updateChainBins();
+
+    // ch1 is nullptr in mono mode
+    void pushPlanar(const float* ch0, const float* ch1, int frames);
+    int  popPlanar(float* ch0, float* ch1, int maxFrames);
+
+    // --- FFT helpers (radix-2 iterative, N=NFFT) ---
     void fft(std::vector<std::complex<float>>& a, bool inverse);
 
-    // One complete STFT frame (using the 96 samples currently in mHopBuf).
+    // K hops at once, lane-wise across frames (re/im rows of kMaxBatchHops floats).
+    void fftBatch(int hops, bool inverse);
+
+    // Split the full FFT output (strided re/im) into the SoA half-spectrum
+    // (separating L/R in stereo), run the chain, and merge back.
+    void runSpectralChain(float* re, float* im, size_t stride, uint64_t hopIndex);
+
+    // Append the forward spectrum (strided re/im, full N bins) to mHistory.
+    void recordHistory(const float* re, const float* im, size_t stride);
+
+    // One complete STFT frame (using the hop currently in mHopBuf).
     void processOneHop();
 
-    // push to OLA ring (timeWin added, norm adds win^2)
-    void olaAdd(const float* block512);
-};
\ No newline at end of file
+    // 'hops' whole hops taken directly from the inputs (hops * hop floats each).
+    void processHopBatch(const float* newSamples, const float* newSamplesR, int hops);
+
+    // push to OLA ring (timeWin added, norm adds ana*syn); blockR may be nullptr
+    void olaAdd(const float* block, const float* blockR);
+};
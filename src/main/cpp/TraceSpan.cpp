@@ -0,0 +1,196 @@
+// TraceSpan.cpp
+#include "TraceSpan.h"
+#include <pthread.h>
+
+#if defined(__ANDROID__)
+#include <mutex>
+#include <trace.h>
+#else
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "Metrics.h"
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif
+
+namespace tracing {
+
+#if defined(__ANDROID__)
+
+void initialize() {
+    static std::once_flag once;
+    std::call_once(once, []() { Trace::initialize(); });
+}
+
+void beginSpan(const char* name) {
+    if (Trace::isEnabled()) Trace::beginSection("%s", name);
+}
+
+void endSpan() {
+    if (Trace::isEnabled()) Trace::endSection();
+}
+
+void counter(const char*, int64_t) {}
+
+void setThreadName(const char* name) {
+    (void)pthread_setname_np(pthread_self(), name);
+}
+
+bool   startCapture(size_t) { return false; }
+void   stopCapture() {}
+size_t capturedEvents() { return 0; }
+size_t droppedEvents() { return 0; }
+bool   writeChromeJson(const std::string&) { return false; }
+
+#else
+
+namespace {
+
+struct Event {
+    const char* name;
+    int64_t     tsNs;
+    int64_t     value;
+    int32_t     tid;
+    char        phase;              // 'B', 'E' or 'C'
+    std::atomic<bool> done{false};  // set last; unfinished slots are skipped on export
+};
+
+std::atomic<Event*>  gEvents{nullptr};   // null while not capturing
+std::unique_ptr<Event[]> gStorage;       // kept after stopCapture() for export
+size_t               gCapacity = 0;
+std::atomic<size_t>  gNext{0};
+metrics::Counter&    gDropped = metrics::registry().counter("trace.dropped_events");
+int64_t              gDroppedBase = 0;   // gDropped at startCapture()
+int64_t              gEpochNs = 0;
+std::mutex           gControl;
+std::map<int32_t, std::string> gThreadNames;
+
+int64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int32_t currentTid() {
+#if defined(__linux__)
+    thread_local int32_t tid = static_cast<int32_t>(syscall(SYS_gettid));
+#else
+    thread_local int32_t tid = static_cast<int32_t>(
+            std::hash<std::thread::id>()(std::this_thread::get_id()) & 0x7fffffff);
+#endif
+    return tid;
+}
+
+void push(char phase, const char* name, int64_t value) {
+    Event* events = gEvents.load(std::memory_order_acquire);
+    if (events == nullptr) return;
+    const size_t i = gNext.fetch_add(1, std::memory_order_relaxed);
+    if (i >= gCapacity) {
+        gDropped.add();
+        return;
+    }
+    Event& e = events[i];
+    e.name  = name;
+    e.tsNs  = nowNanos();
+    e.value = value;
+    e.tid   = currentTid();
+    e.phase = phase;
+    e.done.store(true, std::memory_order_release);
+}
+
+// Names are literals from this code base; escape anyway so the JSON stays valid
+void writeJsonString(FILE* f, const char* s) {
+    std::fputc('"', f);
+    for (; s != nullptr && *s != '\0'; ++s) {
+        if (*s == '"' || *s == '\\') std::fputc('\\', f);
+        std::fputc(*s, f);
+    }
+    std::fputc('"', f);
+}
+
+} // namespace
+
+void initialize() {}
+
+void beginSpan(const char* name) { push('B', name, 0); }
+void endSpan() { push('E', nullptr, 0); }
+void counter(const char* name, int64_t value) { push('C', name, value); }
+
+void setThreadName(const char* name) {
+#if defined(__linux__)
+    (void)pthread_setname_np(pthread_self(), name);
+#endif
+    std::lock_guard<std::mutex> lock(gControl);
+    gThreadNames[currentTid()] = name;
+}
+
+bool startCapture(size_t maxEvents) {
+    std::lock_guard<std::mutex> lock(gControl);
+    if (gEvents.load() != nullptr || maxEvents == 0) return false;
+    // Storage of a previous capture is released here, when no writer can be
+    // left on it (capture is stopped after the audio threads are)
+    gStorage.reset(new Event[maxEvents]);
+    gCapacity = maxEvents;
+    gNext.store(0);
+    gDroppedBase = gDropped.value();
+    gEpochNs = nowNanos();
+    gEvents.store(gStorage.get(), std::memory_order_release);
+    return true;
+}
+
+void stopCapture() {
+    gEvents.store(nullptr, std::memory_order_release);
+}
+
+size_t capturedEvents() {
+    return std::min(gNext.load(), gCapacity);
+}
+
+size_t droppedEvents() {
+    return static_cast<size_t>(gDropped.value() - gDroppedBase);
+}
+
+bool writeChromeJson(const std::string& path) {
+    std::lock_guard<std::mutex> lock(gControl);
+    if (!gStorage) return false;
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (f == nullptr) return false;
+
+    std::fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool first = true;
+    for (const auto& t : gThreadNames) {
+        std::fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+                     first ? "" : ",\n", t.first);
+        writeJsonString(f, t.second.c_str());
+        std::fprintf(f, "}}");
+        first = false;
+    }
+    const size_t n = capturedEvents();
+    for (size_t i = 0; i < n; ++i) {
+        const Event& e = gStorage[i];
+        if (!e.done.load(std::memory_order_acquire)) continue;
+        const double tsUs = double(e.tsNs - gEpochNs) / 1000.0;
+        std::fprintf(f, "%s{\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%.3f", first ? "" : ",\n",
+                     e.phase, e.tid, tsUs);
+        if (e.name != nullptr) {
+            std::fprintf(f, ",\"name\":");
+            writeJsonString(f, e.name);
+        }
+        if (e.phase == 'C') std::fprintf(f, ",\"args\":{\"value\":%lld}", (long long)e.value);
+        std::fprintf(f, "}");
+        first = false;
+    }
+    std::fprintf(f, "\n]}\n");
+    return std::fclose(f) == 0;
+}
+
+#endif
+
+} // namespace tracing
@@ -0,0 +1,53 @@
+// TraceSpan.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Begin/end trace markers for the pipeline stages and ring transfers.
+ *
+ * On Android, spans go to ATrace through debug-utils/trace (Trace), and only
+ * cost a flag check while no systrace/Perfetto session is recording.
+ * Elsewhere (Linux host builds) they go to an in-memory event buffer that
+ * startCapture() allocates: writers claim a slot with one fetch_add and
+ * never block; once the buffer is full further events are dropped and
+ * counted in the metrics registry ("trace.dropped_events"). After the run,
+ * writeChromeJson() exports the buffer in the Chrome trace event format,
+ * which chrome://tracing and ui.perfetto.dev open, with one track per named
+ * thread. engineSim and engineOffline do this with --trace FILE.
+ *
+ * Span and counter names must be string literals (the pointer is stored).
+ */
+namespace tracing {
+
+// Android: loads the ATrace entry points once. Host: nothing.
+void initialize();
+
+void beginSpan(const char* name);
+void endSpan();
+// Host only: a counter track (e.g. ring fill); ignored on Android
+void counter(const char* name, int64_t value);
+// Labels the calling thread's track (host export)
+void setThreadName(const char* name);
+
+// Host capture control. Not for the audio path.
+bool   startCapture(size_t maxEvents = 1 << 20);
+void   stopCapture();
+size_t capturedEvents();
+size_t droppedEvents();
+bool   writeChromeJson(const std::string& path);
+
+class ScopedSpan {
+public:
+    explicit ScopedSpan(const char* name) { beginSpan(name); }
+    ~ScopedSpan() { endSpan(); }
+    ScopedSpan(const ScopedSpan&) = delete;
+    ScopedSpan& operator=(const ScopedSpan&) = delete;
+};
+
+} // namespace tracing
+
+#define TRACE_SPAN_CAT2(a, b) a##b
+#define TRACE_SPAN_CAT(a, b) TRACE_SPAN_CAT2(a, b)
+#define TRACE_SPAN(name) tracing::ScopedSpan TRACE_SPAN_CAT(traceSpan_, __LINE__)(name)
@@ -0,0 +1,83 @@
+// WeightContainer.cpp
+#include "WeightContainer.h"
+#include "EngineLog.h"
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace weights {
+
+uint64_t checksum(const void* data, size_t bytes) {
+    constexpr uint64_t kPrime = 0x100000001b3ull;
+    uint64_t h = 0xcbf29ce484222325ull;
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, p + i, 8);
+        h = (h ^ w) * kPrime;
+    }
+    if (i < bytes) {
+        uint64_t w = 0;
+        std::memcpy(&w, p + i, bytes - i);
+        h = (h ^ w) * kPrime;
+    }
+    return h;
+}
+
+MappedFile::~MappedFile() {
+    if (mData != nullptr) munmap(const_cast<uint8_t*>(mData), mSize);
+}
+
+std::shared_ptr<const MappedFile> MappedFile::openShared(const std::string& path) {
+    static std::mutex sLock;
+    static std::map<std::string, std::weak_ptr<const MappedFile>> sOpen;
+
+    std::lock_guard<std::mutex> lock(sLock);
+    auto it = sOpen.find(path);
+    if (it != sOpen.end()) {
+        if (auto existing = it->second.lock()) return existing;
+    }
+
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOGE("MappedFile: cannot open %s", path.c_str());
+        return nullptr;
+    }
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        LOGE("MappedFile: cannot stat %s", path.c_str());
+        ::close(fd);
+        return nullptr;
+    }
+    void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping keeps the file referenced
+    if (p == MAP_FAILED) {
+        LOGE("MappedFile: mmap failed for %s", path.c_str());
+        return nullptr;
+    }
+
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    file->mData = static_cast<const uint8_t*>(p);
+    file->mSize = static_cast<size_t>(st.st_size);
+    file->mPath = path;
+    sOpen[path] = file;
+    return file;
+}
+
+size_t residentBytes() {
+    FILE* f = std::fopen("/proc/self/statm", "r");
+    if (f == nullptr) return 0;
+    unsigned long total = 0, resident = 0;
+    const int n = std::fscanf(f, "%lu %lu", &total, &resident);
+    std::fclose(f);
+    if (n != 2) return 0;
+    return static_cast<size_t>(resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+} // namespace weights
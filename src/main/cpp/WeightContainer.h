@@ -0,0 +1,102 @@
+// WeightContainer.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * Versioned, memory-mappable model weight container ("NNWM").
+ *
+ * The file is mapped read-only and used in place: float parameters and the
+ * int8 matrices (already packed for one quant::Packing) are read straight
+ * from the mapping, so nothing is parsed or copied at load and pages come in
+ * lazily on first use. Because the mapping is shared and file-backed, pages
+ * stay in the page cache across engine restarts and are shared between
+ * processes using the same file.
+ *
+ * Layout (little endian, every section 64-byte aligned):
+ *   ContainerHeader                      64 B at offset 0
+ *   ContainerLayer[numLayers]            96 B each, at headerBytes
+ *   per layer: float parameters (NNW1 order, see NeuralNet), then for Dense
+ *              one and for GRU two (W_ih, W_hh) int8 matrices + row scales
+ *
+ * tableChecksum covers the layer table and is always verified.
+ * payloadChecksum covers everything after the table; verifying it reads the
+ * whole file, so it is optional at load.
+ */
+namespace weights {
+
+constexpr char     kMagic[4]  = {'N', 'N', 'W', 'M'};
+constexpr uint32_t kVersion   = 1;
+constexpr uint32_t kAlignment = 64;
+constexpr uint32_t kMaxMatricesPerLayer = 2;
+
+struct ContainerHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t headerBytes;      // offset of the layer table
+    uint32_t numLayers;
+    uint32_t inputSize;
+    uint32_t packing;          // quant::Packing of the int8 sections, 0 = none
+    uint64_t fileBytes;
+    uint64_t tableChecksum;
+    uint64_t payloadChecksum;
+    uint8_t  reserved[16];
+};
+static_assert(sizeof(ContainerHeader) == 64, "ContainerHeader layout");
+
+struct ContainerMatrix {
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t rowsPadded;
+    uint32_t colsPadded;
+    uint64_t dataOffset;       // rowsPadded * colsPadded int8
+    uint64_t scalesOffset;     // rowsPadded float
+};
+static_assert(sizeof(ContainerMatrix) == 32, "ContainerMatrix layout");
+
+struct ContainerLayer {
+    uint32_t type;             // NeuralNet::LayerType
+    uint32_t act;              // NeuralNet::Activation
+    uint32_t in;
+    uint32_t out;
+    uint32_t kernel;
+    uint32_t numMatrices;
+    uint64_t paramsOffset;     // float parameters
+    ContainerMatrix matrices[kMaxMatricesPerLayer];
+};
+static_assert(sizeof(ContainerLayer) == 96, "ContainerLayer layout");
+
+// FNV-1a over 64-bit little-endian words (tail bytes zero-padded).
+uint64_t checksum(const void* data, size_t bytes);
+
+inline uint64_t alignUp(uint64_t v) { return (v + kAlignment - 1) / kAlignment * kAlignment; }
+
+/**
+ * Read-only shared mapping of a whole file. openShared() returns the mapping
+ * already held elsewhere in the process for the same path, if any.
+ */
+class MappedFile {
+public:
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    static std::shared_ptr<const MappedFile> openShared(const std::string& path);
+
+    const uint8_t* data() const { return mData; }
+    size_t         size() const { return mSize; }
+    const std::string& path() const { return mPath; }
+
+private:
+    MappedFile() = default;
+    const uint8_t* mData = nullptr;
+    size_t         mSize = 0;
+    std::string    mPath;
+};
+
+// Resident set size of this process in bytes (0 if unavailable).
+size_t residentBytes();
+
+} // namespace weights
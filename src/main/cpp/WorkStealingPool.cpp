@@ -0,0 +1,77 @@
+// WorkStealingPool.cpp
+#include "WorkStealingPool.h"
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(int32_t workers) {
+    const int32_t n = std::max(1, workers);
+    for (int32_t i = 0; i < n; ++i) mQueues.push_back(std::make_unique<Queue>());
+    for (int32_t i = 0; i < n; ++i) mThreads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mShutdown = true;
+    }
+    mWake.notify_all();
+    for (auto& t : mThreads) t.join();
+}
+
+void WorkStealingPool::run(int64_t count, const Task& task, const std::vector<int64_t>& order) {
+    const int32_t n = workers();
+    const int64_t total = order.empty() ? count : static_cast<int64_t>(order.size());
+    if (total <= 0) return;
+    for (int64_t k = 0; k < total; ++k) {
+        Queue& q = *mQueues[static_cast<size_t>(k % n)];
+        std::lock_guard<std::mutex> lock(q.lock);
+        q.items.push_back(order.empty() ? k : order[static_cast<size_t>(k)]);
+    }
+
+    std::unique_lock<std::mutex> lock(mLock);
+    mTask = &task;
+    mBusy = n;
+    ++mGeneration;
+    mWake.notify_all();
+    mDone.wait(lock, [this]() { return mBusy == 0; });
+    mTask = nullptr;
+}
+
+// Own queue first (front), then the others' (back), starting after our own
+bool WorkStealingPool::next(int32_t self, int64_t& index) {
+    const int32_t n = workers();
+    for (int32_t k = 0; k < n; ++k) {
+        Queue& q = *mQueues[static_cast<size_t>((self + k) % n)];
+        std::lock_guard<std::mutex> lock(q.lock);
+        if (q.items.empty()) continue;
+        if (k == 0) {
+            index = q.items.front();
+            q.items.pop_front();
+        } else {
+            index = q.items.back();
+            q.items.pop_back();
+            mSteals.fetch_add(1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(int32_t self) {
+    uint64_t seen = 0;
+    while (true) {
+        const Task* task;
+        {
+            std::unique_lock<std::mutex> lock(mLock);
+            mWake.wait(lock, [&]() { return mShutdown || mGeneration != seen; });
+            if (mShutdown) return;
+            seen = mGeneration;
+            task = mTask;
+        }
+        // Tasks do not add tasks, so all queues empty means this run is over
+        int64_t index;
+        while (next(self, index)) (*task)(index, self);
+
+        std::lock_guard<std::mutex> lock(mLock);
+        if (--mBusy == 0) mDone.notify_all();
+    }
+}
@@ -0,0 +1,63 @@
+// WorkStealingPool.h
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads for batches of independent, coarse tasks
+ * (whole files): run() deals the task indices round robin onto per-worker
+ * queues, each worker takes from the front of its own queue and, once it is
+ * empty, steals from the back of the others', so a worker stuck with long
+ * tasks sheds the rest of its queue to idle ones. Tasks are identified by
+ * index and get the number of the worker running them, so callers can keep
+ * per-worker state without locks.
+ *
+ * The queues are mutex-protected deques: a task is a whole file, so queue
+ * traffic is a few operations per task and never contended for long.
+ */
+class WorkStealingPool {
+public:
+    using Task = std::function<void(int64_t index, int32_t worker)>;
+
+    explicit WorkStealingPool(int32_t workers);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Runs task(i, worker) once for every i in 'order' (all of [0, count)
+    // when empty; dealt in that order, so put the longest first) and returns
+    // when all are done. One run() at a time.
+    void run(int64_t count, const Task& task, const std::vector<int64_t>& order = {});
+
+    int32_t workers() const { return static_cast<int32_t>(mQueues.size()); }
+    // Tasks taken from another worker's queue, over every run()
+    uint64_t steals() const { return mSteals.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(64) Queue {
+        std::mutex lock;
+        std::deque<int64_t> items;
+    };
+
+    void workerLoop(int32_t self);
+    bool next(int32_t self, int64_t& index);
+
+    std::vector<std::unique_ptr<Queue>> mQueues;
+    std::vector<std::thread> mThreads;
+
+    std::mutex mLock;
+    std::condition_variable mWake;       // a run started, or shutting down
+    std::condition_variable mDone;       // the last worker left the run
+    const Task* mTask = nullptr;
+    uint64_t mGeneration = 0;
+    int32_t  mBusy = 0;                  // workers still in the current run
+    bool     mShutdown = false;
+    std::atomic<uint64_t> mSteals{0};
+};
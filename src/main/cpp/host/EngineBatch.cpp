@@ -0,0 +1,158 @@
+// EngineBatch.cpp
+//
+// Runs many audio files through the offline chain in parallel
+// (offline::BatchRunner) and reports the merged results in input order:
+//
+//   engineBatch [options] [--workers N] [--out-dir DIR] [--list FILE] <input>...
+//
+// Outputs go to DIR/<input name>.wav (discarded without --out-dir). With
+// --scaling the batch is run at 1, 2, 4, ... workers up to N instead, with
+// the outputs discarded, and the scaling curve is reported: throughput,
+// speedup and parallel efficiency against one worker, and whether the
+// merged output digest matched.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "EngineLog.h"
+#include "OfflineArgs.h"
+#include "OfflineBatch.h"
+
+namespace {
+
+struct BatchArgs {
+    offline::Options options;
+    int32_t workers = 0;
+    std::string outDir;
+    bool scaling = false;
+    std::vector<std::string> inputs;
+};
+
+void usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s\n" OFFLINE_ARGS_USAGE
+                 "          [--workers N] [--out-dir DIR] [--list FILE] [--scaling] <input>...\n",
+                 argv0);
+}
+
+bool parse(int argc, char** argv, BatchArgs& args) {
+    for (int i = 1; i < argc; ++i) {
+        bool bad;
+        if (parseOfflineArg(argc, argv, i, args.options, bad)) continue;
+        if (bad) return false;
+        const std::string a = argv[i];
+        if (a == "--scaling") {
+            args.scaling = true;
+        } else if (a == "--workers" || a == "--out-dir" || a == "--list") {
+            if (i + 1 >= argc) return false;
+            const std::string v = argv[++i];
+            if (a == "--workers") {
+                args.workers = std::atoi(v.c_str());
+            } else if (a == "--out-dir") {
+                args.outDir = v;
+            } else {
+                std::ifstream list(v);
+                if (!list) return false;
+                for (std::string line; std::getline(list, line);) {
+                    if (!line.empty()) args.inputs.push_back(line);
+                }
+            }
+        } else if (a[0] == '-') {
+            return false;
+        } else {
+            args.inputs.push_back(a);
+        }
+    }
+    if (args.workers <= 0) args.workers = static_cast<int32_t>(std::max(1u, std::thread::hardware_concurrency()));
+    return !args.inputs.empty() && args.options.framesPerBurst > 0;
+}
+
+// DIR/<name without extension>.wav; false if two inputs share a name
+bool makeJobs(const BatchArgs& args, std::vector<offline::BatchJob>& jobs) {
+    std::set<std::string> names;
+    for (const std::string& in : args.inputs) {
+        offline::BatchJob job;
+        job.input = in;
+        if (!args.outDir.empty()) {
+            std::string name = in.substr(in.find_last_of('/') + 1);
+            name = name.substr(0, name.find_last_of('.'));
+            if (!names.insert(name).second) {
+                std::fprintf(stderr, "two inputs would write %s.wav\n", name.c_str());
+                return false;
+            }
+            job.output = args.outDir + "/" + name + ".wav";
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BatchArgs args;
+    if (!parse(argc, argv, args)) {
+        usage(argv[0]);
+        return 2;
+    }
+    enginelog::setQuiet(true);
+    std::vector<offline::BatchJob> jobs;
+    if (!makeJobs(args, jobs)) return 2;
+    std::vector<offline::BatchResult> results;
+
+    if (args.scaling) {
+        for (offline::BatchJob& job : jobs) job.output.clear();
+        std::vector<int32_t> counts;
+        for (int32_t w = 1; w < args.workers; w *= 2) counts.push_back(w);
+        counts.push_back(args.workers);
+
+        std::printf("%zu files, %u hardware threads\n", jobs.size(), std::thread::hardware_concurrency());
+        std::printf("%8s %10s %12s %9s %11s %8s %7s\n", "workers", "wall_s", "x_realtime", "speedup",
+                    "efficiency", "steals", "digest");
+        double base = 0.0;
+        uint64_t digest0 = 0;
+        for (int32_t w : counts) {
+            offline::BatchRunner runner;
+            if (!runner.configure(args.options, w)) return 1;
+            const offline::BatchSummary s = runner.run(jobs, results);
+            if (w == counts.front()) {
+                base = s.throughput();
+                digest0 = s.digest;
+            }
+            const double speedup = base > 0.0 ? s.throughput() / base : 0.0;
+            std::printf("%8d %10.3f %12.1f %9.2f %10.0f%% %8llu %7s\n", w, s.wallSeconds, s.throughput(),
+                        speedup, 100.0 * speedup / w, (unsigned long long)s.steals,
+                        s.digest == digest0 ? "same" : "DIFF");
+            if (s.failed > 0) return 1;
+        }
+        const unsigned hw = std::thread::hardware_concurrency();
+        if (hw > 0 && static_cast<unsigned>(args.workers) > hw) {
+            std::printf("note: rows above %u workers share %u hardware thread(s); their speedup is not a "
+                        "scaling measurement\n", hw, hw);
+        }
+        return 0;
+    }
+
+    offline::BatchRunner runner;
+    if (!runner.configure(args.options, args.workers)) return 1;
+    const offline::BatchSummary s = runner.run(jobs, results);
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const offline::Result& r = results[i].result;
+        if (!results[i].ok) {
+            std::printf("%s: FAILED\n", jobs[i].input.c_str());
+            continue;
+        }
+        std::printf("%s: %lld frames, %.2f s @%d Hz, %d -> %d ch, delay %d, digest %016llx\n",
+                    jobs[i].input.c_str(), (long long)r.frames, r.audioSeconds(), r.sampleRate,
+                    r.inputChannels, r.outputChannels, r.latencyFrames, (unsigned long long)r.outputDigest);
+    }
+    std::printf("%lld files (%lld failed), %.1f s of audio in %.3f s on %d workers: %.1fx real time, "
+                "%llu steals, digest %016llx\n",
+                (long long)s.jobs, (long long)s.failed, s.audioSeconds, s.wallSeconds, s.workers,
+                s.throughput(), (unsigned long long)s.steals, (unsigned long long)s.digest);
+    return s.failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,451 @@
+// EngineBench.cpp
+//
+// Microbenchmarks for the hot-path components of the engine, host builds
+// only. Every case is swept over burst sizes and channel counts and reported
+// as JSON (stdout, or --out <file>):
+//
+//   ns_per_frame       wall time per device frame
+//   cycles_per_sample  CPU cycles per sample (frame * channel), from the
+//                      hardware cycle counter via perf_event_open; null when
+//                      perf counters are not available
+//   bytes_per_second   audio bytes moved (read + written) per second
+//
+// Each case is calibrated to --min-time-ms per repetition and the median of
+// --repetitions is reported. --filter <substring> selects cases by name.
+#include <algorithm>
+#include <chrono>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "ChannelMixer.h"
+#include "LogMelProcessor.h"
+#include "QuantKernels.h"
+#include "Resampler3x.h"
+#include "RingBuffer.h"
+#include "StftProcessor.h"
+
+namespace {
+
+const int32_t kBursts[]   = {32, 64, 96, 128, 192, 256, 512, 1024};
+const int32_t kChannels[] = {1, 2, 4, 8};
+
+// Keeps the compiler from discarding a result
+template <typename T>
+inline void keep(T const& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// User-space CPU cycles of the calling thread
+class CycleCounter {
+public:
+    CycleCounter() {
+#if defined(__linux__)
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        mFd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+    ~CycleCounter() {
+#if defined(__linux__)
+        if (mFd >= 0) close(mFd);
+#endif
+    }
+    CycleCounter(const CycleCounter&) = delete;
+    CycleCounter& operator=(const CycleCounter&) = delete;
+
+    bool available() const { return mFd >= 0; }
+
+    void start() {
+#if defined(__linux__)
+        if (mFd < 0) return;
+        ioctl(mFd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(mFd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+    // Cycles since start(), or -1
+    int64_t stop() {
+#if defined(__linux__)
+        if (mFd < 0) return -1;
+        ioctl(mFd, PERF_EVENT_IOC_DISABLE, 0);
+        int64_t cycles = 0;
+        if (read(mFd, &cycles, sizeof(cycles)) != static_cast<ssize_t>(sizeof(cycles))) return -1;
+        return cycles;
+#else
+        return -1;
+#endif
+    }
+
+private:
+    int mFd = -1;
+};
+
+struct Options {
+    std::string filter;
+    std::string out;
+    double      minTimeMs = 20.0;
+    int32_t     repetitions = 5;
+};
+
+struct Case {
+    std::string name;
+    int32_t burst = 0;
+    int32_t channels = 0;
+    int64_t framesPerIter = 0;  // device frames one call of 'body' covers
+    int64_t bytesPerIter = 0;   // audio bytes read + written per call
+    std::function<void()> body;
+};
+
+struct Result {
+    Case    c;
+    int64_t iterations = 0;
+    double  nsPerIter = 0.0;
+    double  cyclesPerIter = -1.0;
+};
+
+int64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Result run(const Case& c, const Options& opt, CycleCounter& counter) {
+    // Warm caches and branch predictors, then find an iteration count that
+    // takes at least minTimeMs
+    for (int i = 0; i < 16; ++i) c.body();
+    int64_t iters = 1;
+    const double minNs = opt.minTimeMs * 1e6;
+    while (true) {
+        const int64_t t0 = nowNanos();
+        for (int64_t i = 0; i < iters; ++i) c.body();
+        const double ns = double(nowNanos() - t0);
+        if (ns >= minNs || iters >= (int64_t(1) << 30)) break;
+        const double scale = ns > 0.0 ? 1.4 * minNs / ns : 10.0;
+        iters = std::max(iters + 1, static_cast<int64_t>(double(iters) * std::min(scale, 10.0)));
+    }
+
+    std::vector<double> nsPer, cyclesPer;
+    for (int32_t r = 0; r < opt.repetitions; ++r) {
+        counter.start();
+        const int64_t t0 = nowNanos();
+        for (int64_t i = 0; i < iters; ++i) c.body();
+        const int64_t ns = nowNanos() - t0;
+        const int64_t cycles = counter.stop();
+        nsPer.push_back(double(ns) / double(iters));
+        if (cycles >= 0) cyclesPer.push_back(double(cycles) / double(iters));
+    }
+    auto median = [](std::vector<double>& v) {
+        std::sort(v.begin(), v.end());
+        return v[v.size() / 2];
+    };
+    Result res;
+    res.c = c;
+    res.iterations = iters;
+    res.nsPerIter = median(nsPer);
+    if (!cyclesPer.empty()) res.cyclesPerIter = median(cyclesPer);
+    return res;
+}
+
+std::vector<float> noise(size_t n) {
+    std::vector<float> v(n);
+    uint32_t x = 0x12345678u;
+    for (float& s : v) {
+        x = x * 1664525u + 1013904223u;
+        s = float(int32_t(x >> 8) - (1 << 23)) / float(1 << 24);
+    }
+    return v;
+}
+
+// --- cases ---------------------------------------------------------------
+
+void addRingCases(std::vector<Case>& cases) {
+    for (int32_t ch : kChannels) {
+        for (int32_t burst : kBursts) {
+            auto ring = std::make_shared<RingBuffer>();
+            ring->init(4 * burst, ch);
+            auto src = std::make_shared<std::vector<float>>(noise(static_cast<size_t>(burst) * ch));
+            auto dst = std::make_shared<std::vector<float>>(src->size());
+            // Offset by a third of the capacity so transfers also wrap
+            std::vector<float> pre(static_cast<size_t>(burst) * ch);
+            ring->writeInterleaved(pre.data(), burst + burst / 3);
+            ring->readInterleaved(pre.data(), burst);
+            Case c{"ring.write_read", burst, ch, burst, 2LL * burst * ch * 4, nullptr};
+            c.body = [ring, src, dst, burst]() {
+                keep(ring->writeInterleaved(src->data(), burst));
+                keep(ring->readInterleaved(dst->data(), burst));
+            };
+            cases.push_back(std::move(c));
+        }
+    }
+}
+
+void addResamplerCases(std::vector<Case>& cases) {
+    for (int32_t ch : kChannels) {
+        for (int32_t burst : kBursts) {
+            const int32_t n16 = burst / 3;
+            auto down = std::make_shared<std::vector<Resampler3x>>(ch, Resampler3x(Resampler3x::Mode::DownBy3));
+            auto up = std::make_shared<std::vector<Resampler3x>>(ch, Resampler3x(Resampler3x::Mode::UpBy3));
+            auto in48 = std::make_shared<std::vector<float>>(noise(static_cast<size_t>(burst) * ch));
+            auto mid = std::make_shared<std::vector<float>>(static_cast<size_t>(n16 + 1) * ch);
+            auto out48 = std::make_shared<std::vector<float>>(static_cast<size_t>(3 * n16 + 3) * ch);
+
+            // One decimator per channel over planar input, as captureBlock runs them
+            Case d{"resampler.down3", burst, ch, burst, (int64_t(burst) + n16) * ch * 4, nullptr};
+            d.body = [down, in48, mid, burst, n16, ch]() {
+                for (int32_t c = 0; c < ch; ++c) {
+                    keep((*down)[c].process(in48->data() + size_t(c) * burst, burst,
+                                            mid->data() + size_t(c) * (n16 + 1), n16 + 1));
+                }
+            };
+            cases.push_back(std::move(d));
+
+            Case u{"resampler.up3", burst, ch, 3LL * n16, (int64_t(n16) + 3 * n16) * ch * 4, nullptr};
+            u.body = [up, mid, out48, n16, ch]() {
+                for (int32_t c = 0; c < ch; ++c) {
+                    keep((*up)[c].process(mid->data() + size_t(c) * (n16 + 1), n16,
+                                          out48->data() + size_t(c) * (3 * n16 + 3), 3 * n16 + 3));
+                }
+            };
+            cases.push_back(std::move(u));
+        }
+    }
+}
+
+void addInterleaveCases(std::vector<Case>& cases) {
+    for (int32_t ch : kChannels) {
+        for (int32_t burst : kBursts) {
+            auto inter = std::make_shared<std::vector<float>>(noise(static_cast<size_t>(burst) * ch));
+            auto planar = std::make_shared<std::vector<float>>(inter->size());
+            auto planes = std::make_shared<std::vector<float*>>(ch);
+            auto cplanes = std::make_shared<std::vector<const float*>>(ch);
+            for (int32_t c = 0; c < ch; ++c) {
+                (*planes)[c] = planar->data() + size_t(c) * burst;
+                (*cplanes)[c] = (*planes)[c];
+            }
+            auto back = std::make_shared<std::vector<float>>(inter->size());
+            const int64_t bytes = 2LL * burst * ch * 4;
+
+            Case d{"chmix.deinterleave", burst, ch, burst, bytes, nullptr};
+            d.body = [inter, planes, planar, burst, ch]() {
+                chmix::deinterleave(inter->data(), burst, ch, planes->data());
+                keep((*planar)[0]);
+            };
+            cases.push_back(std::move(d));
+
+            Case i{"chmix.interleave", burst, ch, burst, bytes, nullptr};
+            i.body = [cplanes, back, burst, ch]() {
+                chmix::interleave(cplanes->data(), ch, burst, back->data());
+                keep((*back)[0]);
+            };
+            cases.push_back(std::move(i));
+        }
+    }
+}
+
+// push + pop of one burst at the STFT rate, with the engine's two geometries.
+// The STFT takes 1 or 2 channels.
+void addStftCases(std::vector<Case>& cases) {
+    struct Geometry { const char* name; StftProcessor::Config cfg; };
+    const Geometry geometries[] = {{"stft.push_pop.16k", StftProcessor::Config::mid16k()},
+                                   {"stft.push_pop.native", StftProcessor::Config::native48k()}};
+    for (const Geometry& g : geometries) {
+        for (int32_t ch : {1, 2}) {
+            for (int32_t burst : kBursts) {
+                auto stft = std::make_shared<StftProcessor>(g.cfg);
+                stft->setChannelCount(ch);
+                auto l = std::make_shared<std::vector<float>>(noise(static_cast<size_t>(burst)));
+                auto r = std::make_shared<std::vector<float>>(noise(static_cast<size_t>(burst) + 7));
+                auto ol = std::make_shared<std::vector<float>>(burst);
+                auto orr = std::make_shared<std::vector<float>>(burst);
+                Case c{g.name, burst, ch, burst, 2LL * burst * ch * 4, nullptr};
+                if (ch == 1) {
+                    c.body = [stft, l, ol, burst]() {
+                        stft->pushTimeDomain(l->data(), burst);
+                        keep(stft->popTimeDomain(ol->data(), burst));
+                    };
+                } else {
+                    c.body = [stft, l, r, ol, orr, burst]() {
+                        stft->pushTimeDomainStereo(l->data(), r->data(), burst);
+                        keep(stft->popTimeDomainStereo(ol->data(), orr->data(), burst));
+                    };
+                }
+                cases.push_back(std::move(c));
+            }
+        }
+    }
+}
+
+// One hop of log-mel features from a fresh spectrum (the power view is
+// recomputed, as when the log-mel stage is the only reader), 40 mels with
+// normalization; "burst" is the hop size here, at the STFT rate
+void addLogMelCases(std::vector<Case>& cases) {
+    for (const StftProcessor::Config& cfg : {StftProcessor::Config::mid16k(), StftProcessor::Config::native48k()}) {
+        for (int32_t ch : {1, 2}) {
+            LogMelProcessor::Config mc;
+            mc.normalize = true;
+            auto mel = std::make_shared<LogMelProcessor>();
+            if (!mel->prepare(mc, cfg.fftSize, cfg.sampleRate)) continue;
+            const int32_t bins = cfg.fftSize / 2 + 1;
+            const int32_t n = bins * ch;
+            auto re = std::make_shared<std::vector<float>>(noise(static_cast<size_t>(n)));
+            auto im = std::make_shared<std::vector<float>>(noise(static_cast<size_t>(n) + 3));
+            auto out = std::make_shared<std::vector<float>>(mc.numMels);
+            auto cache = std::make_shared<SpectralViewCache>();
+            cache->resize(bins, ch);
+            SpectralHopInfo info;
+            info.sampleRate = cfg.sampleRate;
+            info.hopSize = cfg.hopSize;
+            info.fftSize = cfg.fftSize;
+            Case c{"logmel.hop", cfg.hopSize, ch, cfg.hopSize, 2LL * n * 4 + 4LL * mc.numMels, nullptr};
+            c.body = [mel, re, im, out, cache, info, bins, ch]() {
+                SpectralFrame frame(re->data(), im->data(), bins, ch, cache.get());
+                frame.invalidateViews();
+                mel->processHop(frame, info);
+                keep(mel->features().readInterleaved(out->data(), 1));
+            };
+            cases.push_back(std::move(c));
+        }
+    }
+}
+
+// One int8 matrix-vector product per supported kernel, at the shapes of
+// small per-hop models (a GRU's 3H x in, dense layers); "burst" is the row
+// count and a frame is one output row. The name carries kernel and shape.
+void addQuantCases(std::vector<Case>& cases) {
+    const int32_t shapes[][2] = {{64, 64}, {192, 64}, {384, 128}, {768, 256}};
+    for (quant::Kernel k : {quant::Kernel::Scalar, quant::Kernel::Avx2, quant::Kernel::Avx512Vnni,
+                            quant::Kernel::AvxVnni, quant::Kernel::NeonDot}) {
+        if (!quant::isSupported(k)) continue;
+        for (const auto& shape : shapes) {
+            const int32_t rows = shape[0], cols = shape[1];
+            auto A = std::make_shared<quant::QMatrix>();
+            const std::vector<float> W = noise(static_cast<size_t>(rows) * cols);
+            quant::quantize(W.data(), rows, cols, *A, k);
+            auto xq = std::make_shared<std::vector<int8_t>>(A->colsPadded);
+            const std::vector<float> x = noise(static_cast<size_t>(cols));
+            const float xs = quant::quantizeVector(x.data(), cols, xq->data(), A->colsPadded);
+            auto y = std::make_shared<std::vector<float>>(rows);
+            const std::string name = std::string("quant.gemv.") + quant::kernelName(k) + "." +
+                                     std::to_string(rows) + "x" + std::to_string(cols);
+            Case c{name, rows, 1, rows, int64_t(A->packedBytes()) + A->colsPadded + 4LL * rows, nullptr};
+            c.body = [A, xq, xs, y]() {
+                quant::gemvInt8(*A, xq->data(), xs, nullptr, y->data());
+                keep((*y)[0]);
+            };
+            cases.push_back(std::move(c));
+        }
+    }
+}
+
+// One forward + inverse transform; "burst" is the FFT size here
+void addFftCases(std::vector<Case>& cases) {
+    for (const StftProcessor::Config& cfg : {StftProcessor::Config::mid16k(), StftProcessor::Config::native48k()}) {
+        auto stft = std::make_shared<StftProcessor>(cfg);
+        auto buf = std::make_shared<std::vector<std::complex<float>>>(cfg.fftSize);
+        const std::vector<float> n = noise(static_cast<size_t>(cfg.fftSize));
+        for (int i = 0; i < cfg.fftSize; ++i) (*buf)[i] = {n[i], 0.0f};
+        const float scale = 1.0f / float(cfg.fftSize);
+        Case c{"fft.forward_inverse", cfg.fftSize, 1, cfg.fftSize, 2LL * cfg.fftSize * 8, nullptr};
+        c.body = [stft, buf, scale]() {
+            stft->transform(*buf, false);
+            stft->transform(*buf, true);
+            for (auto& v : *buf) v *= scale; // keeps the values bounded
+            keep((*buf)[0]);
+        };
+        cases.push_back(std::move(c));
+    }
+}
+
+void writeJson(FILE* f, const std::vector<Result>& results, const Options& opt, bool perf) {
+    std::fprintf(f, "{\n  \"context\": {\"min_time_ms\": %.1f, \"repetitions\": %d, \"perf_counters\": %s},\n",
+                 opt.minTimeMs, opt.repetitions, perf ? "true" : "false");
+    std::fprintf(f, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        const double frames = double(r.c.framesPerIter);
+        const double samples = frames * r.c.channels;
+        std::fprintf(f, "    {\"name\": \"%s\", \"burst\": %d, \"channels\": %d, \"iterations\": %lld, "
+                        "\"ns_per_iter\": %.2f, \"ns_per_frame\": %.4f, \"cycles_per_sample\": ",
+                     r.c.name.c_str(), r.c.burst, r.c.channels, (long long)r.iterations,
+                     r.nsPerIter, r.nsPerIter / frames);
+        if (r.cyclesPerIter >= 0.0) {
+            std::fprintf(f, "%.4f", r.cyclesPerIter / samples);
+        } else {
+            std::fprintf(f, "null");
+        }
+        std::fprintf(f, ", \"bytes_per_second\": %.0f}%s\n",
+                     double(r.c.bytesPerIter) * 1e9 / r.nsPerIter, i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+}
+
+void usage(const char* argv0) {
+    std::fprintf(stderr, "usage: %s [--filter <substring>] [--min-time-ms <ms>] "
+                         "[--repetitions <n>] [--out <file.json>]\n", argv0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (a == "--filter" && hasValue) {
+            opt.filter = argv[++i];
+        } else if (a == "--min-time-ms" && hasValue) {
+            opt.minTimeMs = std::max(0.1, std::atof(argv[++i]));
+        } else if (a == "--repetitions" && hasValue) {
+            opt.repetitions = std::max(1, std::atoi(argv[++i]));
+        } else if (a == "--out" && hasValue) {
+            opt.out = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<Case> cases;
+    addRingCases(cases);
+    addResamplerCases(cases);
+    addInterleaveCases(cases);
+    addStftCases(cases);
+    addLogMelCases(cases);
+    addFftCases(cases);
+    addQuantCases(cases);
+
+    CycleCounter counter;
+    if (!counter.available()) std::fprintf(stderr, "perf counters unavailable; cycles_per_sample is null\n");
+
+    std::vector<Result> results;
+    for (const Case& c : cases) {
+        if (!opt.filter.empty() && c.name.find(opt.filter) == std::string::npos) continue;
+        results.push_back(run(c, opt, counter));
+        const Result& r = results.back();
+        std::fprintf(stderr, "%-24s burst %4d ch %d: %9.2f ns/frame\n", c.name.c_str(), c.burst, c.channels,
+                     r.nsPerIter / double(c.framesPerIter));
+    }
+
+    FILE* f = opt.out.empty() ? stdout : std::fopen(opt.out.c_str(), "w");
+    if (f == nullptr) {
+        std::fprintf(stderr, "cannot write %s\n", opt.out.c_str());
+        return 1;
+    }
+    writeJson(f, results, opt, counter.available());
+    if (f != stdout) std::fclose(f);
+    return 0;
+}
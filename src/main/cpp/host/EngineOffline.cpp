@@ -0,0 +1,98 @@
+// EngineOffline.cpp
+//
+// Runs an audio file through the engine's processing chain (offline::Driver)
+// as fast as the CPU allows and reports the throughput:
+//
+//   engineOffline [options] <input.wav|.raw> [output.wav|.raw]
+//
+// Without an output file the result is discarded (throughput only). Raw
+// input is interleaved float32 and needs --raw-ch and --raw-rate. With
+// --log-mel FILE the log-mel features of every hop are written to FILE as
+// raw float32, 40 per hop. With --trace FILE the stage spans of the run are
+// written to FILE as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+#include <cstdio>
+#include <string>
+#include <sys/resource.h>
+#include "OfflineArgs.h"
+#include "OfflineDriver.h"
+#include "TraceSpan.h"
+
+namespace {
+
+void usage(const char* argv0) {
+    std::fprintf(stderr, "usage: %s\n" OFFLINE_ARGS_USAGE "          [--log-mel FILE] [--trace FILE] <input> [output]\n",
+                 argv0);
+}
+
+bool parse(int argc, char** argv, offline::Options& opt, std::string& in, std::string& out,
+           std::string& trace) {
+    for (int i = 1; i < argc; ++i) {
+        bool bad;
+        if (parseOfflineArg(argc, argv, i, opt, bad)) continue;
+        if (bad) return false;
+        if (std::string(argv[i]) == "--log-mel" && i + 1 < argc) {
+            opt.logMelPath = argv[++i];
+            continue;
+        }
+        if (std::string(argv[i]) == "--trace" && i + 1 < argc) {
+            trace = argv[++i];
+            continue;
+        }
+        if (argv[i][0] == '-') return false;
+        if (in.empty()) {
+            in = argv[i];
+        } else if (out.empty()) {
+            out = argv[i];
+        } else {
+            return false;
+        }
+    }
+    return !in.empty() && opt.framesPerBurst > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    offline::Options opt;
+    std::string in, out, trace;
+    if (!parse(argc, argv, opt, in, out, trace)) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (!trace.empty()) {
+        tracing::setThreadName("offline");
+        (void)tracing::startCapture();
+    }
+    offline::Driver driver;
+    offline::Result r;
+    const bool ok = driver.configure(opt) && driver.process(in, out, r);
+    if (!trace.empty()) {
+        tracing::stopCapture();
+        if (!tracing::writeChromeJson(trace)) {
+            std::fprintf(stderr, "cannot write %s\n", trace.c_str());
+            return 1;
+        }
+    }
+    if (!ok) {
+        std::fprintf(stderr, "%s: processing failed\n", in.c_str());
+        return 1;
+    }
+
+    rusage ru{};
+    (void)getrusage(RUSAGE_SELF, &ru);
+    std::printf("%s: %lld frames, %.1f s @%d Hz, %d -> %d ch, burst %d\n", in.c_str(), (long long)r.frames,
+                r.audioSeconds(), r.sampleRate, r.inputChannels, r.outputChannels, opt.framesPerBurst);
+    std::printf("chain delay %d frames (%.2f ms)%s\n", r.latencyFrames, 1e3 * r.latencyFrames / r.sampleRate,
+                opt.compensateLatency ? ", removed" : "");
+    if (!opt.logMelPath.empty()) {
+        std::printf("log-mel: %lld frames to %s\n", (long long)r.logMelFrames, opt.logMelPath.c_str());
+    }
+    if (!trace.empty()) {
+        std::printf("trace: %zu events (%zu dropped) to %s\n", tracing::capturedEvents(),
+                    tracing::droppedEvents(), trace.c_str());
+    }
+    std::printf("wall %.3f s (engine %.3f s), real-time factor %.4f (%.1fx real time), peak RSS %ld KiB\n",
+                r.wallSeconds, r.processSeconds, r.realTimeFactor(),
+                r.wallSeconds > 0.0 ? r.audioSeconds() / r.wallSeconds : 0.0, ru.ru_maxrss);
+    return 0;
+}
@@ -0,0 +1,305 @@
+// EngineSim.cpp
+//
+// Runs FullDuplexEngine against an audio::SimulatedDevice for a given span
+// of device time and reports glitches and latency. With the default virtual
+// clock a run takes as long as the processing does, and the same options
+// give the same report (and output digest) every time. Pipelined mode runs on
+// the real-time clock unless --virtual is given: its STFT worker is woken by
+// the io thread, not stepped by the device, so under a virtual clock it falls
+// behind whenever the scheduler runs it late and the glitch counts say
+// nothing about the engine. Such a run still reports latency, but its
+// underflow/overflow lines are marked as no verdict.
+//
+// With --max-underflow-frames N the run fails (exit status 1) if the engine
+// played more than N frames of underflow silence, for regression runs.
+//
+// With --trace FILE the stage spans of the run are written to FILE as Chrome
+// trace JSON (chrome://tracing, ui.perfetto.dev).
+//
+// Latency is measured end to end: the input is a quiet tone with a short
+// full-scale pulse every --pulse-ms, and each pulse found in the output is
+// timed against when it was captured, in device time.
+//
+//   engineSim --seconds 3600 --mode threaded --jitter normal --jitter-us 300
+//             --drift-ppm 50 --late-prob 0.001 --late-us 8000 --partial-prob 0.05
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "FullDuplexEngine.h"
+#include "Metrics.h"
+#include "SimulatedDevice.h"
+#include "TraceSpan.h"
+
+namespace {
+
+struct Options {
+    double      seconds = 600.0;
+    std::string mode = "threaded";     // threaded | pipelined | callback
+    std::string stft = "16k";          // 16k | native
+    double      targetMs = 0.0;
+    double      pulseMs = 500.0;
+    double      reportEvery = 0.0;     // progress line every N device seconds (0 = off)
+    bool        clockSet = false;      // --realtime or --virtual given
+    std::string tracePath;             // Chrome trace JSON (empty = no capture)
+    int64_t     maxUnderflowFrames = -1; // fail above this (-1 = no limit)
+    audio::SimulatedDevice::Config device;
+};
+
+bool parseJitter(const std::string& s, audio::SimulatedDevice::JitterShape& out) {
+    if (s == "none")    { out = audio::SimulatedDevice::JitterShape::None;    return true; }
+    if (s == "uniform") { out = audio::SimulatedDevice::JitterShape::Uniform; return true; }
+    if (s == "normal")  { out = audio::SimulatedDevice::JitterShape::Normal;  return true; }
+    return false;
+}
+
+void usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s [--seconds S] [--mode threaded|pipelined|callback] [--stft 16k|native]\n"
+                 "          [--target-ms MS] [--rate HZ] [--burst FRAMES] [--in-ch N] [--out-ch N]\n"
+                 "          [--jitter none|uniform|normal] [--jitter-us US] [--drift-ppm PPM]\n"
+                 "          [--late-prob P] [--late-us US] [--partial-prob P] [--input-bursts N]\n"
+                 "          [--seed N] [--realtime | --virtual] [--pulse-ms MS] [--report-every S]\n"
+                 "          [--trace FILE] [--max-underflow-frames N]\n"
+                 "pipelined mode defaults to --realtime\n",
+                 argv0);
+}
+
+bool parse(int argc, char** argv, Options& opt) {
+    audio::SimulatedDevice::Config& d = opt.device;
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        if (a == "--realtime" || a == "--virtual") {
+            d.clock = a == "--realtime" ? audio::SimulatedDevice::ClockMode::RealTime
+                                        : audio::SimulatedDevice::ClockMode::Virtual;
+            opt.clockSet = true;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const std::string v = argv[++i];
+        if (a == "--seconds")           opt.seconds = std::atof(v.c_str());
+        else if (a == "--mode")         opt.mode = v;
+        else if (a == "--stft")         opt.stft = v;
+        else if (a == "--target-ms")    opt.targetMs = std::atof(v.c_str());
+        else if (a == "--pulse-ms")     opt.pulseMs = std::max(50.0, std::atof(v.c_str()));
+        else if (a == "--report-every") opt.reportEvery = std::atof(v.c_str());
+        else if (a == "--trace")        opt.tracePath = v;
+        else if (a == "--max-underflow-frames") opt.maxUnderflowFrames = std::atoll(v.c_str());
+        else if (a == "--rate")         d.sampleRate = std::atoi(v.c_str());
+        else if (a == "--burst")        d.framesPerBurst = std::atoi(v.c_str());
+        else if (a == "--in-ch")        d.inputChannels = std::atoi(v.c_str());
+        else if (a == "--out-ch")       d.outputChannels = std::atoi(v.c_str());
+        else if (a == "--jitter-us")    d.jitterMicros = std::atof(v.c_str());
+        else if (a == "--drift-ppm")    d.driftPpm = std::atof(v.c_str());
+        else if (a == "--late-prob")    d.lateProbability = std::atof(v.c_str());
+        else if (a == "--late-us")      d.lateMicros = std::atof(v.c_str());
+        else if (a == "--partial-prob") d.partialReadProbability = std::atof(v.c_str());
+        else if (a == "--input-bursts") d.inputBufferBursts = std::max(1, std::atoi(v.c_str()));
+        else if (a == "--seed")         d.seed = std::strtoull(v.c_str(), nullptr, 10);
+        else if (a == "--jitter") {
+            if (!parseJitter(v, d.jitter)) return false;
+        } else {
+            return false;
+        }
+    }
+    return opt.seconds > 0.0 && d.sampleRate > 0 && d.framesPerBurst > 0 &&
+           (opt.mode == "threaded" || opt.mode == "pipelined" || opt.mode == "callback") &&
+           (opt.stft == "16k" || opt.stft == "native");
+}
+
+// Finds the pulses in the output and times them against their capture
+class PulseMeter {
+public:
+    PulseMeter(int32_t sampleRate, double driftPpm, int64_t periodFrames, int32_t channels)
+            : mRate(sampleRate), mInPerOut(1.0 + driftPpm * 1e-6), mPeriod(periodFrames),
+              mChannels(channels) {}
+
+    void onOutput(int64_t first, const float* data, int32_t frames) {
+        for (int32_t i = 0; i < frames; ++i) {
+            const int64_t j = first + i;
+            const float v = data[static_cast<size_t>(i) * mChannels];
+            mDigest = (mDigest ^ bits(v)) * 1099511628211ULL;
+            if (std::fabs(v) < kThreshold || j < mHoldUntil) continue;
+            mHoldUntil = j + mPeriod / 2;
+            // Latest pulse captured before this frame played (latency < one period)
+            const int64_t k = static_cast<int64_t>(std::floor(double(j) * mInPerOut / double(mPeriod)));
+            if (k <= mLastPulse) continue; // a second peak of the same pulse
+            mLastPulse = k;
+            const double capturedSec = double(k * mPeriod) / (double(mRate) * mInPerOut);
+            mLatencyMs.push_back((double(j) / mRate - capturedSec) * 1e3);
+        }
+    }
+
+    const std::vector<double>& latencies() const { return mLatencyMs; }
+    uint64_t digest() const { return mDigest; }
+
+private:
+    static constexpr float kThreshold = 0.45f;
+    static uint64_t bits(float v) {
+        uint32_t u;
+        std::memcpy(&u, &v, sizeof(u));
+        return u;
+    }
+
+    int32_t mRate;
+    double  mInPerOut;
+    int64_t mPeriod;
+    int32_t mChannels;
+    int64_t mHoldUntil = 0;
+    int64_t mLastPulse = -1;
+    uint64_t mDigest = 1469598103934665603ULL;
+    std::vector<double> mLatencyMs;
+};
+
+double percentile(std::vector<double> v, double q) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, static_cast<size_t>(q * double(v.size())))];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parse(argc, argv, opt)) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (opt.mode == "pipelined" && !opt.clockSet) {
+        opt.device.clock = audio::SimulatedDevice::ClockMode::RealTime;
+    }
+    const audio::SimulatedDevice::Config& dc = opt.device;
+    const bool virtualClock = dc.clock == audio::SimulatedDevice::ClockMode::Virtual;
+    // See the top of the file
+    const bool glitchVerdict = !(opt.mode == "pipelined" && virtualClock);
+    const char* noVerdict = glitchVerdict ? "" : " (no verdict: pipelined on the virtual clock)";
+    if (!glitchVerdict) {
+        std::fprintf(stderr, "note: the pipelined STFT worker is not in lockstep with the virtual clock; "
+                             "underflow and overflow counts are not a verdict on the engine\n");
+    }
+
+    audio::SimulatedDevice device(dc);
+    const int64_t period = static_cast<int64_t>(opt.pulseMs * 1e-3 * dc.sampleRate);
+    const int32_t pulseWidth = 6; // two whole decimator groups whatever the phase
+    device.setSource([&](int64_t frame, float* data, int32_t frames) {
+        for (int32_t i = 0; i < frames; ++i) {
+            const int64_t n = frame + i;
+            float v = 0.05f * std::sin(2.0 * M_PI * 440.0 * double(n % dc.sampleRate) / dc.sampleRate);
+            if (n % period < pulseWidth) v = 0.9f;
+            for (int32_t c = 0; c < dc.inputChannels; ++c) data[static_cast<size_t>(i) * dc.inputChannels + c] = v;
+        }
+    });
+    PulseMeter meter(dc.sampleRate, dc.driftPpm, period, dc.outputChannels);
+    device.setSink([&](int64_t first, const float* data, int32_t frames) { meter.onOutput(first, data, frames); });
+
+    int64_t achievedSum = 0, achievedMax = 0, achievedN = 0;
+    {
+        FullDuplexEngine engine;
+        // Looked up after the engine registered them (with its bucket bounds)
+        metrics::Registry& reg = metrics::registry();
+        metrics::Counter& underflows = reg.counter("engine.underflow_frames");
+        metrics::Counter& overflows = reg.counter("engine.overflow_frames");
+        metrics::Histogram& underflowBursts = reg.histogram("engine.underflow_burst_frames", {});
+        const int64_t underflow0 = underflows.value();
+        const int64_t overflow0 = overflows.value();
+        const uint64_t underflowEvents0 = underflowBursts.snapshot().count;
+        engine.setSharedInputStream(device.inputStream());
+        engine.setSharedOutputStream(device.outputStream());
+        engine.setDuplexDriver(device.duplexDriver());
+        engine.setIoMode(opt.mode == "callback" ? FullDuplexEngine::IoMode::Callback
+                                                : FullDuplexEngine::IoMode::Threaded);
+        engine.setPipelined(opt.mode == "pipelined");
+        if (opt.stft == "native") engine.setStftRate(FullDuplexEngine::StftRate::Native);
+        engine.setTargetLatencyFrames(static_cast<int32_t>(opt.targetMs * 1e-3 * dc.sampleRate));
+        device.setPull([&](float* data, int32_t frames) {
+            engine.pullTo(data, frames);
+            const int64_t a = engine.achievedLatencyFrames();
+            achievedSum += a;
+            achievedMax = std::max(achievedMax, a);
+            ++achievedN;
+        });
+        if (!opt.tracePath.empty()) {
+            tracing::setThreadName("sim.device");
+            (void)tracing::startCapture();
+        }
+        if (!engine.start()) {
+            std::fprintf(stderr, "engine failed to start\n");
+            return 1;
+        }
+
+        const auto wall0 = std::chrono::steady_clock::now();
+        const double step = opt.reportEvery > 0.0 ? opt.reportEvery : opt.seconds;
+        for (double done = 0.0; done < opt.seconds; done += step) {
+            device.run(std::min(step, opt.seconds - done));
+            if (opt.reportEvery > 0.0) {
+                const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+                std::fprintf(stderr, "t=%.0fs underflow frames %lld overflow frames %lld (%.1fx real time)%s\n",
+                             device.nowSeconds(), (long long)(underflows.value() - underflow0),
+                             (long long)(overflows.value() - overflow0), device.nowSeconds() / std::max(wall, 1e-9),
+                             noVerdict);
+            }
+        }
+        const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+        device.close();
+        engine.stop();
+        if (!opt.tracePath.empty()) {
+            tracing::stopCapture();
+            if (!tracing::writeChromeJson(opt.tracePath)) {
+                std::fprintf(stderr, "cannot write %s\n", opt.tracePath.c_str());
+                return 1;
+            }
+        }
+
+        const audio::SimulatedDevice::Stats s = device.stats();
+        const std::vector<double>& lat = meter.latencies();
+        double mean = 0.0;
+        for (double v : lat) mean += v;
+        mean = lat.empty() ? 0.0 : mean / double(lat.size());
+        const int64_t pulses = s.inputFramesRead > 0 ? (s.inputFramesRead - 1) / period + 1 : 0;
+        const double msPerFrame = 1e3 / dc.sampleRate;
+
+        std::printf("simulated %.1f s (%s clock) in %.1f s wall, %.1fx real time\n", device.nowSeconds(),
+                    virtualClock ? "virtual" : "real-time", wall, device.nowSeconds() / std::max(wall, 1e-9));
+        std::printf("config: %s mode, %s STFT, %d Hz, burst %d, %d -> %d ch, jitter %s %.0f us, drift %.1f ppm, "
+                    "late %.4f x %.0f us, partial reads %.3f, seed %llu\n",
+                    opt.mode.c_str(), opt.stft.c_str(), dc.sampleRate, dc.framesPerBurst, dc.inputChannels,
+                    dc.outputChannels,
+                    dc.jitter == audio::SimulatedDevice::JitterShape::None ? "none"
+                    : dc.jitter == audio::SimulatedDevice::JitterShape::Uniform ? "uniform" : "normal",
+                    dc.jitterMicros, dc.driftPpm, dc.lateProbability, dc.lateMicros, dc.partialReadProbability,
+                    (unsigned long long)dc.seed);
+        std::printf("device: %lld callbacks (%lld late), %lld input bursts (%lld late), %lld partial reads, "
+                    "%lld input frames lost\n",
+                    (long long)s.outputCallbacks, (long long)s.lateCallbacks, (long long)s.inputBursts,
+                    (long long)s.lateInputBursts, (long long)s.partialReads, (long long)s.inputFramesLost);
+        std::printf("engine: underflow %lld frames in %llu events, overflow %lld frames%s\n",
+                    (long long)(underflows.value() - underflow0),
+                    (unsigned long long)(underflowBursts.snapshot().count - underflowEvents0),
+                    (long long)(overflows.value() - overflow0), noVerdict);
+        std::printf("latency: %zu of ~%lld pulses, min %.2f / mean %.2f / p50 %.2f / p99 %.2f / max %.2f ms\n",
+                    lat.size(), (long long)pulses, lat.empty() ? 0.0 : *std::min_element(lat.begin(), lat.end()),
+                    mean, percentile(lat, 0.50), percentile(lat, 0.99),
+                    lat.empty() ? 0.0 : *std::max_element(lat.begin(), lat.end()));
+        if (achievedN > 0) {
+            std::printf("engine estimate (algorithmic + buffered): mean %.2f / max %.2f ms\n",
+                        double(achievedSum) / double(achievedN) * msPerFrame, double(achievedMax) * msPerFrame);
+        }
+        if (!opt.tracePath.empty()) {
+            std::printf("trace: %zu events (%zu dropped) to %s\n", tracing::capturedEvents(),
+                        tracing::droppedEvents(), opt.tracePath.c_str());
+        }
+        std::printf("output digest %016llx\n", (unsigned long long)meter.digest());
+        const int64_t underflowFrames = underflows.value() - underflow0;
+        if (opt.maxUnderflowFrames >= 0 && underflowFrames > opt.maxUnderflowFrames) {
+            std::fprintf(stderr, "FAIL: underflow %lld frames, limit %lld\n", (long long)underflowFrames,
+                         (long long)opt.maxUnderflowFrames);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,45 @@
+// OfflineArgs.h
+//
+// Command-line options of offline::Options, shared by engineOffline and
+// engineBatch.
+#pragma once
+#include <cstdlib>
+#include <string>
+#include "OfflineDriver.h"
+
+#define OFFLINE_ARGS_USAGE                                                                 \
+    "          [--burst FRAMES] [--out-ch N] [--stft 16k|native] [--stereo] [--low-latency]\n" \
+    "          [--no-aligned-hop] [--mask MODEL] [--mask-float] [--mask-budget-us US]\n"      \
+    "          [--no-compensate] [--block-bursts N] [--raw-ch N --raw-rate HZ]\n"
+
+// Consumes argv[i] (and its value, advancing i) if it is one of the above.
+// Returns false if it is not, or its value is missing or invalid ('bad').
+inline bool parseOfflineArg(int argc, char** argv, int& i, offline::Options& opt, bool& bad) {
+    const std::string a = argv[i];
+    bad = false;
+    if (a == "--stereo")              { opt.stereoStft = true;         return true; }
+    if (a == "--low-latency")         { opt.lowLatencyStft = true;     return true; }
+    if (a == "--no-aligned-hop")      { opt.burstAlignedHop = false;   return true; }
+    if (a == "--mask-float")          { opt.maskQuantized = false;     return true; }
+    if (a == "--no-compensate")       { opt.compensateLatency = false; return true; }
+    if (a != "--burst" && a != "--out-ch" && a != "--mask" && a != "--mask-budget-us" &&
+        a != "--block-bursts" && a != "--raw-ch" && a != "--raw-rate" && a != "--stft") {
+        return false;
+    }
+    if (i + 1 >= argc) {
+        bad = true;
+        return false;
+    }
+    const std::string v = argv[++i];
+    if (a == "--burst")               opt.framesPerBurst = std::atoi(v.c_str());
+    else if (a == "--out-ch")         opt.outputChannels = std::atoi(v.c_str());
+    else if (a == "--mask")           opt.maskModel = v;
+    else if (a == "--mask-budget-us") opt.maskBudgetMicros = std::atoi(v.c_str());
+    else if (a == "--block-bursts")   opt.blockBursts = std::atoi(v.c_str());
+    else if (a == "--raw-ch")         opt.rawFormat.channels = std::atoi(v.c_str());
+    else if (a == "--raw-rate")       opt.rawFormat.sampleRate = std::atoi(v.c_str());
+    else if (v == "16k")              opt.stftRate = FullDuplexEngine::StftRate::Resampled16k;
+    else if (v == "native")           opt.stftRate = FullDuplexEngine::StftRate::Native;
+    else                              bad = true;
+    return !bad;
+}
@@ -0,0 +1,82 @@
+// RtJitter.cpp
+//
+// Wake-up jitter of a periodic thread under each scheduling policy
+// (rt::measureWakeupJitter), host builds only:
+//
+//   rtJitter [--period-us N] [--iterations N] [--priority N] [--big-cores]
+//
+// Runs SCHED_OTHER (plain CFS, no nice boost), SCHED_FIFO and SCHED_RR in
+// turn and prints how late the thread woke (p50 .. max, microseconds) next
+// to the policy the kernel actually granted: without CAP_SYS_NICE or an
+// rtprio limit the RT requests fall back, and the row says so.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "RtThread.h"
+
+namespace {
+
+struct Args {
+    int32_t periodMicros = 2000; // 96 frames at 48 kHz is 2 ms
+    int32_t iterations = 5000;
+    int priority = 2;
+    bool bigCores = false;
+};
+
+void usage(const char* argv0) {
+    std::fprintf(stderr, "usage: %s [--period-us N] [--iterations N] [--priority N] [--big-cores]\n", argv0);
+}
+
+bool parse(int argc, char** argv, Args& args) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (a == "--period-us" && hasValue) {
+            args.periodMicros = std::atoi(argv[++i]);
+        } else if (a == "--iterations" && hasValue) {
+            args.iterations = std::atoi(argv[++i]);
+        } else if (a == "--priority" && hasValue) {
+            args.priority = std::atoi(argv[++i]);
+        } else if (a == "--big-cores") {
+            args.bigCores = true;
+        } else {
+            return false;
+        }
+    }
+    return args.periodMicros > 0 && args.iterations > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Args args;
+    if (!parse(argc, argv, args)) {
+        usage(argv[0]);
+        return 2;
+    }
+    std::printf("period %d us, %d wake-ups per policy\n", args.periodMicros, args.iterations);
+    std::printf("%-12s %-12s %9s %9s %9s %9s %9s  %s\n", "requested", "obtained", "p50_us", "p90_us",
+                "p99_us", "p99.9_us", "max_us", "thread");
+
+    bool allGranted = true;
+    for (rt::Policy policy : {rt::Policy::Normal, rt::Policy::Fifo, rt::Policy::RoundRobin}) {
+        rt::ThreadConfig cfg;
+        cfg.policy = policy;
+        cfg.priority = args.priority;
+        cfg.fallbackNice = 0; // a refused RT request measures plain CFS, not a boosted one
+        cfg.affinity = args.bigCores ? rt::Affinity::BigCores : rt::Affinity::None;
+
+        const rt::JitterStats s = rt::measureWakeupJitter(cfg, args.periodMicros, args.iterations);
+        const bool granted = s.report.policy == policy;
+        allGranted = allGranted && granted;
+        std::printf("%-12s %-12s %9.1f %9.1f %9.1f %9.1f %9.1f  %s\n", rt::policyName(policy),
+                    rt::policyName(s.report.policy), s.p50Us, s.p90Us, s.p99Us, s.p999Us, s.maxUs,
+                    s.report.describe().c_str());
+    }
+    if (!allGranted) {
+        std::printf("note: a real-time policy was refused (needs CAP_SYS_NICE or an rtprio limit); "
+                    "that row ran on SCHED_OTHER\n");
+    }
+    return 0;
+}
@@ -17,6 +17,7 @@
 #include <jni.h>
 #include <logging_macros.h>
 #include "LiveEffectEngine.h"
+#include "Metrics.h"
 
 static const int kOboeApiAAudio = 0;
 static const int kOboeApiOpenSLES = 1;
@@ -84,6 +85,73 @@ Java_com_google_oboe_samples_liveEffect_LiveEffectEngine_setPlaybackDeviceId(
     engine->setPlaybackDeviceId(deviceId);
 }
 
+JNIEXPORT jboolean JNICALL
+Java_com_google_oboe_samples_liveEffect_LiveEffectEngine_setCallbackMode(
+    JNIEnv *env, jclass, jboolean enabled) {
+    if (engine == nullptr) {
+        LOGE(
+            "Engine is null, you must call createEngine before calling this "
+            "method");
+        return JNI_FALSE;
+    }
+    return engine->setCallbackMode(enabled) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_google_oboe_samples_liveEffect_LiveEffectEngine_setChannelCounts(
+    JNIEnv *env, jclass, jint inputChannels, jint outputChannels) {
+    if (engine == nullptr) {
+        LOGE(
+            "Engine is null, you must call createEngine before calling this "
+            "method");
+        return JNI_FALSE;
+    }
+    return engine->setChannelCounts(inputChannels, outputChannels) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL
+Java_com_google_oboe_samples_liveEffect_LiveEffectEngine_setTargetLatencyMillis(
+    JNIEnv *env, jclass, jfloat millis) {
+    if (engine == nullptr) {
+        LOGE(
+            "Engine is null, you must call createEngine before calling this "
+            "method");
+        return;
+    }
+    engine->setTargetLatencyMillis(millis);
+}
+
+JNIEXPORT jdouble JNICALL
+Java_com_google_oboe_samples_liveEffect_LiveEffectEngine_getAchievedLatencyMillis(
+    JNIEnv *env, jclass) {
+    if (engine == nullptr) {
+        LOGE(
+            "Engine is null, you must call createEngine before calling this "
+            "method");
+        return -1.0;
+    }
+    return engine->getAchievedLatencyMillis();
+}
+
+JNIEXPORT void JNICALL
+Java_com_google_oboe_samples_liveEffect_LiveEffectEngine_setMaskModelPath(
+    JNIEnv *env, jclass, jstring path) {
+    if (engine == nullptr) {
+        LOGE(
+            "Engine is null, you must call createEngine before calling this "
+            "method");
+        return;
+    }
+    if (path == nullptr) {
+        engine->setMaskModelPath(std::string());
+        return;
+    }
+    const char *chars = env->GetStringUTFChars(path, nullptr);
+    if (chars == nullptr) return;
+    engine->setMaskModelPath(std::string(chars));
+    env->ReleaseStringUTFChars(path, chars);
+}
+
 JNIEXPORT jboolean JNICALL
 Java_com_google_oboe_samples_liveEffect_LiveEffectEngine_setAPI(JNIEnv *env,
                                                                jclass type,
@@ -123,6 +191,22 @@ Java_com_google_oboe_samples_liveEffect_LiveEffectEngine_isAAudioRecommended(
     return engine->isAAudioRecommended() ? JNI_TRUE : JNI_FALSE;
 }
 
+// Writes every registered metric into a direct ByteBuffer (metrics::Registry
+// layout, little endian). Works without an engine. Returns the bytes
+// written, the negated size needed if the buffer is too small, or 0 if it is
+// not a direct buffer.
+JNIEXPORT jint JNICALL
+Java_com_google_oboe_samples_liveEffect_LiveEffectEngine_dumpMetrics(
+    JNIEnv *env, jclass, jobject buffer) {
+    auto *data = buffer ? static_cast<uint8_t *>(env->GetDirectBufferAddress(buffer)) : nullptr;
+    const jlong capacity = buffer ? env->GetDirectBufferCapacity(buffer) : -1;
+    if (data == nullptr || capacity < 0) {
+        LOGE("dumpMetrics needs a direct ByteBuffer");
+        return 0;
+    }
+    return static_cast<jint>(metrics::registry().serialize(data, static_cast<size_t>(capacity)));
+}
+
 JNIEXPORT void JNICALL
 Java_com_google_oboe_samples_liveEffect_LiveEffectEngine_native_1setDefaultStreamValues(JNIEnv *env,
                                                jclass type,
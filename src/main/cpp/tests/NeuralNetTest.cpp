@@ -0,0 +1,177 @@
+// NeuralNetTest.cpp
+//
+// NNW1 loader and the Dense / GRU / Conv1d forward pass against reference
+// outputs, through NeuralNet directly and through NeuralMaskProcessor on a
+// spectral frame. The model is small and fixed (8 -> Conv1d 6 k3 relu ->
+// GRU 5 -> Dense 8 sigmoid, parameter i = 0.5 sin(0.37 i + 0.11)); the
+// references come from an independent double-precision implementation of
+// the PyTorch semantics. The tolerances cover float rounding (the library
+// builds with -Ofast) and the log-power approximation of the mask features.
+// Also checks that the NNWM container runs exactly like the copied file and
+// that the int8 path stays close to float.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "NeuralMaskProcessor.h"
+#include "NeuralNet.h"
+#include "TestCheck.h"
+
+namespace {
+
+constexpr int kIn = 8;
+constexpr int kOut = 8;
+
+// type, activation, outputSize, kernel
+const uint32_t kLayers[][4] = {{2, 1, 6, 3}, {1, 0, 5, 0}, {0, 2, 8, 0}};
+
+// NeuralNet::step() for input x[k] = 0.8 cos(0.5 t + 0.9 k), hops t = 0..5
+const float kStepRef[6][kOut] = {
+    {0.438724600f, 0.285842991f, 0.387747624f, 0.508974501f, 0.385778740f, 0.418213354f, 0.627739653f, 0.589159754f},
+    {0.425075097f, 0.338191924f, 0.369163171f, 0.458882374f, 0.431575481f, 0.441788376f, 0.569507161f, 0.598220211f},
+    {0.347123996f, 0.461324585f, 0.379733543f, 0.330468287f, 0.494439591f, 0.541843913f, 0.451468670f, 0.564134332f},
+    {0.331761799f, 0.470052423f, 0.391385737f, 0.316856294f, 0.490712707f, 0.559264032f, 0.445557979f, 0.550012672f},
+    {0.402410799f, 0.373475051f, 0.371159131f, 0.419802021f, 0.451034690f, 0.470366953f, 0.534293517f, 0.589363570f},
+    {0.442510710f, 0.311964540f, 0.367980937f, 0.489388095f, 0.416342893f, 0.420209318f, 0.596457646f, 0.604665589f},
+};
+
+// Mask for re[k] = 0.1 (1 + k) cos(0.3 t + k), im[k] = 0.05 (2 + k) sin(0.7 t - k), hops t = 0..3
+const float kMaskRef[4][kOut] = {
+    {0.427863332f, 0.311437269f, 0.382266675f, 0.481610593f, 0.405742859f, 0.433731601f, 0.599660329f, 0.589603886f},
+    {0.407454046f, 0.399436125f, 0.352391470f, 0.404126741f, 0.480128989f, 0.470427842f, 0.505072325f, 0.604830565f},
+    {0.334297290f, 0.491405407f, 0.377526411f, 0.305439705f, 0.512691617f, 0.560447801f, 0.423306725f, 0.561153097f},
+    {0.327726125f, 0.491598086f, 0.384424412f, 0.301867736f, 0.507708983f, 0.567304672f, 0.424422838f, 0.553652888f},
+};
+
+size_t paramCount(uint32_t type, uint32_t in, uint32_t out, uint32_t kernel) {
+    if (type == 2) return size_t(out) * in * kernel + out;
+    if (type == 1) return 3 * size_t(out) * in + 3 * size_t(out) * out + 6 * size_t(out);
+    return size_t(out) * in + out;
+}
+
+std::string tempPath(const char* suffix) {
+    std::string path = std::string("/tmp/nntestXXXXXX") + suffix;
+    const int fd = mkstemps(&path[0], static_cast<int>(std::strlen(suffix)));
+    if (fd >= 0) close(fd);
+    return path;
+}
+
+bool writeModel(const std::string& path) {
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    const uint32_t header[2] = {3, kIn};
+    bool ok = std::fwrite("NNW1", 1, 4, f) == 4 && std::fwrite(header, 4, 2, f) == 2;
+    uint32_t in = kIn;
+    size_t index = 0;
+    for (const auto& l : kLayers) {
+        ok = ok && std::fwrite(l, 4, 4, f) == 4;
+        for (size_t j = paramCount(l[0], in, l[2], l[3]); j > 0; --j, ++index) {
+            const float w = float(0.5 * std::sin(0.37 * double(index) + 0.11));
+            ok = ok && std::fwrite(&w, 4, 1, f) == 1;
+        }
+        in = l[2];
+    }
+    return (std::fclose(f) == 0) && ok;
+}
+
+// Runs the six reference hops; returns the largest deviation from kStepRef
+float stepError(NeuralNet& net) {
+    net.resetState();
+    float maxErr = 0.0f;
+    float x[kIn];
+    for (int t = 0; t < 6; ++t) {
+        for (int k = 0; k < kIn; ++k) x[k] = float(0.8 * std::cos(0.5 * t + 0.9 * k));
+        const float* y = net.step(x);
+        for (int k = 0; k < kOut; ++k) maxErr = std::max(maxErr, std::fabs(y[k] - kStepRef[t][k]));
+    }
+    return maxErr;
+}
+
+void testNet(const std::string& model) {
+    NeuralNet net;
+    CHECK(net.load(model), "load %s", model.c_str());
+    if (!net.isLoaded()) return;
+    CHECK(net.numLayers() == 3 && net.inputSize() == kIn && net.outputSize() == kOut,
+          "shape %d layers, %d -> %d", net.numLayers(), net.inputSize(), net.outputSize());
+    CHECK(net.layer(0).type == NeuralNet::LayerType::Conv1d && net.layer(0).kernel == 3, "layer 0");
+    CHECK(net.layer(1).type == NeuralNet::LayerType::Gru && net.layer(1).in == 6, "layer 1");
+    CHECK(net.layer(2).type == NeuralNet::LayerType::Dense && net.layer(2).in == 5, "layer 2");
+
+    const float floatErr = stepError(net);
+    CHECK(floatErr < 2e-6f, "float forward pass off by %g", floatErr);
+
+    // Same network from an NNWM container, run in place: identical arithmetic
+    const std::string mapped = tempPath(".nnwm");
+    CHECK(net.save(mapped, quant::packingOf(quant::Kernel::Scalar)), "save %s", mapped.c_str());
+    NeuralNet mappedNet;
+    CHECK(mappedNet.loadMapped(mapped, true), "loadMapped %s", mapped.c_str());
+    if (mappedNet.isLoaded()) {
+        const float mappedErr = stepError(mappedNet);
+        CHECK(mappedErr == floatErr, "mapped %g vs copied %g", mappedErr, floatErr);
+    }
+    std::remove(mapped.c_str());
+
+    // Int8 matrices: per-row and per-vector scales, a few LSBs of a sigmoid
+    CHECK(net.quantize(quant::detectBest()), "quantize");
+    const float quantErr = stepError(net);
+    CHECK(quantErr < 2e-2f, "int8 forward pass off by %g", quantErr);
+    std::printf("step: float %.2e, int8 (%s) %.2e\n", floatErr, quant::kernelName(quant::detectBest()),
+                quantErr);
+
+    // A truncated file is rejected
+    const std::string truncated = tempPath(".nnw");
+    std::FILE* in = std::fopen(model.c_str(), "rb");
+    std::FILE* out = std::fopen(truncated.c_str(), "wb");
+    std::vector<char> bytes(200);
+    const size_t n = in ? std::fread(bytes.data(), 1, bytes.size(), in) : 0;
+    if (out) (void)std::fwrite(bytes.data(), 1, n, out);
+    if (in) std::fclose(in);
+    if (out) std::fclose(out);
+    NeuralNet bad;
+    CHECK(!bad.load(truncated), "truncated file loaded");
+    std::remove(truncated.c_str());
+}
+
+void testMask(const std::string& model) {
+    NeuralMaskProcessor mask;
+    CHECK(mask.load(model), "mask load");
+    if (!mask.isLoaded()) return;
+    float re[kOut], im[kOut], re0[kOut], im0[kOut];
+    SpectralViewCache cache;
+    cache.resize(kOut, 1);
+    float maxErr = 0.0f;
+    for (int t = 0; t < 4; ++t) {
+        for (int k = 0; k < kOut; ++k) {
+            re[k] = re0[k] = float(0.1 * (1 + k) * std::cos(0.3 * t + k));
+            im[k] = im0[k] = float(0.05 * (2 + k) * std::sin(0.7 * t - k));
+        }
+        SpectralFrame frame(re, im, kOut, 1, &cache);
+        frame.invalidateViews();
+        mask.processHop(frame, SpectralHopInfo{});
+        for (int k = 0; k < kOut; ++k) {
+            // Every bin scaled by the same gain on both planes
+            maxErr = std::max(maxErr, std::fabs(re[k] - re0[k] * kMaskRef[t][k]));
+            maxErr = std::max(maxErr, std::fabs(im[k] - im0[k] * kMaskRef[t][k]));
+        }
+    }
+    CHECK(mask.hopsRun() == 4 && mask.hopsBypassed() == 0, "%llu run, %llu bypassed",
+          (unsigned long long)mask.hopsRun(), (unsigned long long)mask.hopsBypassed());
+    CHECK(maxErr < 1e-5f, "masked spectrum off by %g", maxErr);
+    std::printf("mask: %.2e\n", maxErr);
+}
+
+} // namespace
+
+int main() {
+    const std::string model = tempPath(".nnw");
+    CHECK(writeModel(model), "write %s", model.c_str());
+    testNet(model);
+    testMask(model);
+    std::remove(model.c_str());
+    return test::testResult();
+}
@@ -0,0 +1,124 @@
+// QuantKernelsTest.cpp
+//
+// Int8 kernels against the scalar row-major reference. Accumulation is
+// int32, so every kernel and packing must produce the same integer dot
+// products; only the float scaling after them may differ in the last bits
+// (-Ofast versions and reassociates that loop), so outputs are compared in
+// steps of the accumulator (row scale * vector scale) and must agree to well
+// under half a step (0.25). gemvF32 sums floats and gets an absolute bound. The
+// Tile4x4 packing (NeonDot) is checked byte by byte against its definition
+// and through gemvInt8: on arm64 with dot-product support this runs the
+// sdot kernel, elsewhere the scalar loop over the same tiles. Shapes cover
+// row and column padding and more rows than one accumulator chunk.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "QuantKernels.h"
+#include "TestCheck.h"
+
+namespace {
+
+using quant::Kernel;
+
+std::vector<float> noise(size_t n, uint32_t seed) {
+    std::vector<float> v(n);
+    for (auto& x : v) {
+        seed = seed * 1664525u + 1013904223u;
+        x = float(int32_t(seed) >> 8) * (1.0f / 8388608.0f);
+    }
+    return v;
+}
+
+float maxDiff(const std::vector<float>& a, const std::vector<float>& b) {
+    float d = 0.0f;
+    for (size_t i = 0; i < a.size(); ++i) d = std::max(d, std::fabs(a[i] - b[i]));
+    return d;
+}
+
+// Largest |a - b| in units of one accumulator step of each row
+float maxSteps(const std::vector<float>& a, const std::vector<float>& b, const quant::QMatrix& A, float xs) {
+    float d = 0.0f;
+    for (size_t i = 0; i < a.size(); ++i) d = std::max(d, std::fabs(a[i] - b[i]) / (A.scales[i] * xs));
+    return d;
+}
+
+void testShape(int32_t rows, int32_t cols) {
+    const std::vector<float> W = noise(static_cast<size_t>(rows) * cols, uint32_t(rows * 131 + cols));
+    const std::vector<float> x = noise(static_cast<size_t>(cols), uint32_t(cols));
+    const std::vector<float> bias = noise(static_cast<size_t>(rows), 7u);
+
+    quant::QMatrix ref;
+    quant::quantize(W.data(), rows, cols, ref, Kernel::Scalar);
+    std::vector<int8_t> xq(ref.colsPadded);
+    const float xs = quant::quantizeVector(x.data(), cols, xq.data(), ref.colsPadded);
+
+    // Reference: the integer dot products written out, from the row-major bytes
+    std::vector<float> written(rows), yRef(rows), y(rows);
+    for (int32_t r = 0; r < rows; ++r) {
+        int32_t acc = 0;
+        for (int32_t c = 0; c < cols; ++c) acc += int32_t(ref.data[size_t(r) * ref.colsPadded + c]) * xq[c];
+        written[r] = ref.scales[r] * xs * float(acc) + bias[r];
+    }
+    quant::gemvInt8(ref, xq.data(), xs, bias.data(), yRef.data());
+    CHECK(maxSteps(yRef, written, ref, xs) < 0.25f, "%dx%d: scalar gemvInt8 off the reference by %g steps",
+          rows, cols, maxSteps(yRef, written, ref, xs));
+
+    // Tile4x4 holds the same bytes as the row-major copy, 4x4 tiles in row-major tile order
+    quant::QMatrix tiled;
+    quant::quantize(W.data(), rows, cols, tiled, Kernel::NeonDot);
+    CHECK(tiled.rowsPadded == ref.rowsPadded && tiled.colsPadded == ref.colsPadded, "%dx%d: padding", rows, cols);
+    CHECK(tiled.scales == ref.scales, "%dx%d: tiled row scales differ", rows, cols);
+    int32_t misplaced = 0;
+    for (int32_t r = 0; r < ref.rowsPadded; ++r) {
+        for (int32_t c = 0; c < ref.colsPadded; ++c) {
+            const size_t tile = size_t(r / 4) * (ref.colsPadded / 4) + c / 4;
+            if (tiled.data[tile * 16 + (r % 4) * 4 + c % 4] != ref.data[size_t(r) * ref.colsPadded + c]) ++misplaced;
+        }
+    }
+    CHECK(misplaced == 0, "%dx%d: %d bytes out of place in the Tile4x4 packing", rows, cols, misplaced);
+
+    // Every kernel (its SIMD path where supported, the scalar loop over its packing elsewhere)
+    for (Kernel k : {Kernel::Avx2, Kernel::Avx512Vnni, Kernel::AvxVnni, Kernel::NeonDot}) {
+        quant::QMatrix A;
+        quant::quantize(W.data(), rows, cols, A, k);
+        std::fill(y.begin(), y.end(), 0.0f);
+        quant::gemvInt8(A, xq.data(), xs, bias.data(), y.data());
+        CHECK(maxSteps(y, yRef, ref, xs) < 0.25f, "%dx%d: %s%s gemvInt8 off scalar by %g steps", rows, cols,
+              quant::kernelName(k), quant::isSupported(k) ? "" : " (scalar fallback)", maxSteps(y, yRef, ref, xs));
+
+        // Same bytes borrowed, as from a mapped weight file
+        quant::QMatrix wrapped;
+        CHECK(quant::wrap(A.data.data(), A.scales.data(), rows, cols, quant::packingOf(k), k, wrapped),
+              "%dx%d: wrap %s", rows, cols, quant::kernelName(k));
+        std::fill(y.begin(), y.end(), 0.0f);
+        quant::gemvInt8(wrapped, xq.data(), xs, bias.data(), y.data());
+        CHECK(maxSteps(y, yRef, ref, xs) < 0.25f, "%dx%d: wrapped %s gemvInt8 off scalar by %g steps", rows,
+              cols, quant::kernelName(k), maxSteps(y, yRef, ref, xs));
+
+        // Float activations walk the packing in the same order
+        std::vector<float> f(rows), fRef(rows);
+        quant::gemvF32(ref, x.data(), bias.data(), fRef.data());
+        quant::gemvF32(A, x.data(), bias.data(), f.data());
+        CHECK(maxDiff(f, fRef) < 1e-4f, "%dx%d: %s gemvF32 off scalar by %g", rows, cols, quant::kernelName(k),
+              maxDiff(f, fRef));
+    }
+
+    quant::QMatrix mismatched;
+    CHECK(!quant::wrap(tiled.data.data(), tiled.scales.data(), rows, cols, quant::Packing::RowMajor,
+                       Kernel::NeonDot, mismatched), "%dx%d: wrap accepted the wrong packing", rows, cols);
+}
+
+} // namespace
+
+int main() {
+    std::printf("kernels:");
+    for (Kernel k : {Kernel::Scalar, Kernel::Avx2, Kernel::Avx512Vnni, Kernel::AvxVnni, Kernel::NeonDot}) {
+        std::printf(" %s%s", quant::kernelName(k), quant::isSupported(k) ? "" : " (fallback)");
+    }
+    std::printf("\n");
+    const int32_t shapes[][2] = {{1, 1}, {4, 32}, {5, 33}, {13, 70}, {64, 64}, {192, 64}, {257, 100}, {600, 257}};
+    for (const auto& s : shapes) testShape(s[0], s[1]);
+    return test::testResult();
+}
@@ -0,0 +1,112 @@
+// StftReconstructionTest.cpp
+//
+// Identity reconstruction through StftProcessor: with nothing (or a
+// pass-through processor) between the transforms, out[n] must equal
+// in[n - algorithmicDelayFrames()]. Covers both window modes, the single-hop
+// and the batch path, and mono and packed stereo.
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "StftProcessor.h"
+#include "TestCheck.h"
+
+namespace {
+
+// Touches nothing, but makes the stereo path split and merge the spectra
+class PassThrough : public SpectralProcessor {
+public:
+    void processHop(SpectralFrame&, const SpectralHopInfo&) override {}
+};
+
+std::vector<float> noise(size_t n, uint32_t seed) {
+    std::vector<float> v(n);
+    for (auto& x : v) {
+        seed = seed * 1664525u + 1013904223u;
+        x = float(int32_t(seed) >> 8) * (0.5f / 8388608.0f);
+    }
+    return v;
+}
+
+struct Case {
+    const char* name;
+    StftProcessor::WindowMode mode;
+    bool batch;        // hop-aligned pushes of several hops (processHopBatch)
+    bool stereo;
+    bool processor;    // a pass-through spectral processor attached
+};
+
+void run(const Case& c, const StftProcessor::Config& cfg) {
+    PassThrough pass;
+    StftProcessor stft;
+    stft.setWindowMode(c.mode);
+    CHECK(stft.configure(cfg), "%s: configure", c.name);
+    stft.setChannelCount(c.stereo ? 2 : 1);
+    if (c.processor) CHECK(stft.addSpectralProcessor(&pass), "%s: add processor", c.name);
+    stft.setMaxBatchHops(c.batch ? StftProcessor::kMaxBatchHops : 1);
+
+    const int H = cfg.hopSize;
+    const int total = 64 * H;
+    const std::vector<float> inL = noise(total, 1), inR = noise(total, 2);
+    std::vector<float> outL, outR;
+    std::vector<float> popL(total), popR(total);
+
+    // Batch: 4 whole hops per push. Single hop: an odd size that never lines up.
+    const int chunk = c.batch ? 4 * H : 37;
+    for (int pos = 0; pos < total; pos += chunk) {
+        const int n = std::min(chunk, total - pos);
+        int got;
+        if (c.stereo) {
+            stft.pushTimeDomainStereo(inL.data() + pos, inR.data() + pos, n);
+            got = stft.popTimeDomainStereo(popL.data(), popR.data(), total);
+        } else {
+            stft.pushTimeDomain(inL.data() + pos, n);
+            got = stft.popTimeDomain(popL.data(), total);
+        }
+        outL.insert(outL.end(), popL.begin(), popL.begin() + got);
+        outR.insert(outR.end(), popR.begin(), popR.begin() + got);
+    }
+    CHECK(int(outL.size()) == total, "%s: popped %zu of %d", c.name, outL.size(), total);
+    CHECK(c.batch == (stft.batchesProcessed() > 0), "%s: %llu batches", c.name,
+          (unsigned long long)stft.batchesProcessed());
+
+    // Compare everything past the first full frame (the start ramps in)
+    const int delay = stft.algorithmicDelayFrames();
+    const int start = delay + cfg.fftSize;
+    double sig = 0.0, err = 0.0, maxErr = 0.0;
+    for (int ch = 0; ch < (c.stereo ? 2 : 1); ++ch) {
+        const std::vector<float>& in = ch ? inR : inL;
+        const std::vector<float>& out = ch ? outR : outL;
+        for (int n = start; n < int(out.size()); ++n) {
+            const double d = double(out[n]) - double(in[n - delay]);
+            sig += double(in[n - delay]) * in[n - delay];
+            err += d * d;
+            maxErr = std::max(maxErr, std::fabs(d));
+        }
+    }
+    const double snr = 10.0 * std::log10(sig / std::max(err, 1e-30));
+    CHECK(snr > 90.0, "%s: SNR %.1f dB", c.name, snr);
+    CHECK(maxErr < 1e-4, "%s: max error %g at delay %d", c.name, maxErr, delay);
+    std::printf("%-40s delay %4d  SNR %6.1f dB  max error %.2e\n", c.name, delay, snr, maxErr);
+}
+
+} // namespace
+
+int main() {
+    using Mode = StftProcessor::WindowMode;
+    const Case cases[] = {
+        {"symmetric mono single-hop",          Mode::Symmetric, false, false, false},
+        {"symmetric mono batch",               Mode::Symmetric, true,  false, false},
+        {"symmetric stereo single-hop",        Mode::Symmetric, false, true,  true},
+        {"symmetric stereo batch",             Mode::Symmetric, true,  true,  true},
+        {"symmetric stereo batch, no chain",   Mode::Symmetric, true,  true,  false},
+        {"low-delay mono single-hop",          Mode::LowDelay,  false, false, false},
+        {"low-delay mono batch",               Mode::LowDelay,  true,  false, true},
+        {"low-delay stereo single-hop",        Mode::LowDelay,  false, true,  true},
+        {"low-delay stereo batch",             Mode::LowDelay,  true,  true,  true},
+    };
+    for (const StftProcessor::Config& cfg : {StftProcessor::Config::mid16k(), StftProcessor::Config::native48k()}) {
+        std::printf("fft %d, frame %d, hop %d\n", cfg.fftSize, cfg.frameSize, cfg.hopSize);
+        for (const Case& c : cases) run(c, cfg);
+    }
+    return test::testResult();
+}
@@ -0,0 +1,31 @@
+// TestCheck.h
+//
+// Minimal checks for the host tests (ctest): CHECK records a failure with
+// its location and a printf-style message and carries on, so one run
+// reports every failing case; testResult() is main()'s return value.
+#pragma once
+#include <cstdio>
+
+namespace test {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+inline int testResult() {
+    if (failures() > 0) std::fprintf(stderr, "%d check(s) failed\n", failures());
+    return failures() > 0 ? 1 : 0;
+}
+
+} // namespace test
+
+#define CHECK(cond, ...)                                                             \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            ++test::failures();                                                      \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed: ", __FILE__, __LINE__, #cond); \
+            std::fprintf(stderr, __VA_ARGS__);                                       \
+            std::fputc('\n', stderr);                                                \
+        }                                                                            \
+    } while (0)
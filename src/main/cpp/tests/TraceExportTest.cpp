@@ -0,0 +1,241 @@
+// TraceExportTest.cpp
+//
+// Loads Chrome trace JSON written by tracing::writeChromeJson() and checks
+// it: the whole file parses as JSON, every event has the fields its phase
+// needs, spans close in order on each thread, and the expected span names
+// and thread names are there.
+//
+//   TraceExportTest                      spans from two named threads, written
+//                                        to a temporary file and loaded back
+//   TraceExportTest FILE [span ...]      an existing export (engineSim --trace),
+//                                        which must contain each named span
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "TestCheck.h"
+#include "TraceSpan.h"
+
+namespace {
+
+// Just enough JSON for the export: objects, arrays, strings, numbers
+struct Value {
+    enum class Kind { Null, Bool, Number, String, Array, Object } kind = Kind::Null;
+    double number = 0.0;
+    std::string text;
+    std::vector<Value> items;
+    std::map<std::string, Value> fields;
+
+    const Value* get(const char* key) const {
+        auto it = fields.find(key);
+        return it == fields.end() ? nullptr : &it->second;
+    }
+};
+
+class Parser {
+public:
+    explicit Parser(const std::string& s) : mS(s) {}
+
+    bool parse(Value& out) {
+        if (!value(out)) return false;
+        skip();
+        return mPos == mS.size();
+    }
+
+private:
+    void skip() {
+        while (mPos < mS.size() && std::isspace(static_cast<unsigned char>(mS[mPos]))) ++mPos;
+    }
+    bool eat(char c) {
+        skip();
+        if (mPos < mS.size() && mS[mPos] == c) {
+            ++mPos;
+            return true;
+        }
+        return false;
+    }
+    bool string(std::string& out) {
+        if (!eat('"')) return false;
+        while (mPos < mS.size() && mS[mPos] != '"') {
+            if (mS[mPos] == '\\' && ++mPos >= mS.size()) return false;
+            out += mS[mPos++];
+        }
+        return eat('"');
+    }
+    bool value(Value& v) {
+        skip();
+        if (mPos >= mS.size()) return false;
+        const char c = mS[mPos];
+        if (c == '{') {
+            v.kind = Value::Kind::Object;
+            ++mPos;
+            if (eat('}')) return true;
+            do {
+                std::string key;
+                if (!string(key) || !eat(':') || !value(v.fields[key])) return false;
+            } while (eat(','));
+            return eat('}');
+        }
+        if (c == '[') {
+            v.kind = Value::Kind::Array;
+            ++mPos;
+            if (eat(']')) return true;
+            do {
+                v.items.emplace_back();
+                if (!value(v.items.back())) return false;
+            } while (eat(','));
+            return eat(']');
+        }
+        if (c == '"') {
+            v.kind = Value::Kind::String;
+            return string(v.text);
+        }
+        for (const char* word : {"true", "false", "null"}) {
+            if (mS.compare(mPos, std::strlen(word), word) == 0) {
+                v.kind = word[0] == 'n' ? Value::Kind::Null : Value::Kind::Bool;
+                mPos += std::strlen(word);
+                return true;
+            }
+        }
+        char* end = nullptr;
+        v.kind = Value::Kind::Number;
+        v.number = std::strtod(mS.c_str() + mPos, &end);
+        if (end == mS.c_str() + mPos) return false;
+        mPos = static_cast<size_t>(end - mS.c_str());
+        return true;
+    }
+
+    const std::string& mS;
+    size_t mPos = 0;
+};
+
+struct Loaded {
+    std::set<std::string> spans;        // names of 'B' events
+    std::set<std::string> threads;      // thread_name metadata
+    std::set<std::string> counters;     // names of 'C' events
+    size_t events = 0;
+};
+
+bool load(const std::string& path, Loaded& out) {
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    CHECK(f != nullptr, "open %s", path.c_str());
+    if (f == nullptr) return false;
+    std::string text;
+    char buf[65536];
+    for (size_t n; (n = std::fread(buf, 1, sizeof(buf), f)) > 0;) text.append(buf, n);
+    std::fclose(f);
+
+    Value root;
+    CHECK(Parser(text).parse(root), "%s is not valid JSON", path.c_str());
+    const Value* events = root.get("traceEvents");
+    CHECK(events != nullptr && events->kind == Value::Kind::Array, "%s: no traceEvents array", path.c_str());
+    if (events == nullptr) return false;
+
+    // Open spans per thread: an 'E' must close one, and none may be left open
+    std::map<int, int> open;
+    int malformed = 0, unbalanced = 0;
+    for (const Value& e : events->items) {
+        const Value* ph = e.get("ph");
+        const Value* tid = e.get("tid");
+        if (ph == nullptr || ph->text.size() != 1 || tid == nullptr || e.get("pid") == nullptr) {
+            ++malformed;
+            continue;
+        }
+        const char phase = ph->text[0];
+        const Value* name = e.get("name");
+        if (phase == 'M') {
+            const Value* args = e.get("args");
+            const Value* label = args ? args->get("name") : nullptr;
+            if (label == nullptr) ++malformed;
+            else out.threads.insert(label->text);
+            continue;
+        }
+        ++out.events;
+        if (e.get("ts") == nullptr) ++malformed;
+        const int t = static_cast<int>(tid->number);
+        if (phase == 'B') {
+            if (name == nullptr) ++malformed;
+            else out.spans.insert(name->text);
+            ++open[t];
+        } else if (phase == 'E') {
+            if (--open[t] < 0) ++unbalanced;
+        } else if (phase == 'C') {
+            const Value* args = e.get("args");
+            if (name == nullptr || args == nullptr || args->get("value") == nullptr) ++malformed;
+            else out.counters.insert(name->text);
+        } else {
+            ++malformed;
+        }
+    }
+    for (const auto& t : open) {
+        if (t.second != 0) ++unbalanced;
+    }
+    CHECK(malformed == 0, "%s: %d malformed events", path.c_str(), malformed);
+    CHECK(unbalanced == 0, "%s: %d threads with unbalanced spans", path.c_str(), unbalanced);
+    return true;
+}
+
+void testRoundTrip() {
+    char path[] = "/tmp/tracetestXXXXXX.json";
+    const int fd = mkstemps(path, 5);
+    if (fd >= 0) close(fd);
+
+    CHECK(tracing::startCapture(1024), "startCapture");
+    CHECK(!tracing::startCapture(1024), "second startCapture accepted");
+    auto work = [](const char* thread) {
+        tracing::setThreadName(thread);
+        for (int i = 0; i < 10; ++i) {
+            tracing::ScopedSpan outer("outer");
+            tracing::ScopedSpan inner("inner \"quoted\"");
+            tracing::counter("fill", i);
+        }
+    };
+    std::thread a(work, "worker.a"), b(work, "worker.b");
+    a.join();
+    b.join();
+    tracing::stopCapture();
+    {
+        TRACE_SPAN("after stop"); // not recorded
+    }
+    CHECK(tracing::capturedEvents() == 100, "%zu events", tracing::capturedEvents());
+    CHECK(tracing::droppedEvents() == 0, "%zu dropped", tracing::droppedEvents());
+    CHECK(tracing::writeChromeJson(path), "write %s", path);
+
+    Loaded l;
+    if (load(path, l)) {
+        CHECK(l.events == 100, "loaded %zu events", l.events);
+        CHECK(l.spans == std::set<std::string>({"outer", "inner \"quoted\""}), "%zu span names", l.spans.size());
+        CHECK(l.threads.count("worker.a") && l.threads.count("worker.b"), "thread names");
+        CHECK(l.counters.count("fill") == 1, "counter track");
+    }
+    std::remove(path);
+
+    // A buffer too small for the run keeps the first events and counts the rest
+    CHECK(tracing::startCapture(5), "startCapture(5)");
+    for (int i = 0; i < 4; ++i) TRACE_SPAN("s");
+    tracing::stopCapture();
+    CHECK(tracing::capturedEvents() == 5 && tracing::droppedEvents() == 3, "%zu captured, %zu dropped",
+          tracing::capturedEvents(), tracing::droppedEvents());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        testRoundTrip();
+        return test::testResult();
+    }
+    Loaded l;
+    if (load(argv[1], l)) {
+        for (int i = 2; i < argc; ++i) CHECK(l.spans.count(argv[i]) == 1, "%s: no \"%s\" span", argv[1], argv[i]);
+        std::printf("%s: %zu events, %zu span names, %zu threads\n", argv[1], l.events, l.spans.size(),
+                    l.threads.size());
+    }
+    return test::testResult();
+}
@@ -19,6 +19,8 @@ import android.content.Context;
 import android.media.AudioManager;
 import android.os.Build;
 
+import java.nio.ByteBuffer;
+
 public enum LiveEffectEngine {
 
     INSTANCE;
@@ -35,6 +37,14 @@ public enum LiveEffectEngine {
     static native boolean setEffectOn(boolean isEffectOn);
     static native void setRecordingDeviceId(int deviceId);
     static native void setPlaybackDeviceId(int deviceId);
+    static native void setMaskModelPath(String path);
+    static native boolean setCallbackMode(boolean enabled);
+    static native boolean setChannelCounts(int inputChannels, int outputChannels);
+    static native void setTargetLatencyMillis(float millis);
+    static native double getAchievedLatencyMillis();
+    // Fills a direct buffer with every metric (little endian: read it with
+    // ByteOrder.LITTLE_ENDIAN); returns the bytes written, or minus the size needed if the buffer is too small
+    static native int dumpMetrics(ByteBuffer buffer);
     static native void delete();
     static native void native_setDefaultStreamValues(int defaultSampleRate, int defaultFramesPerBurst);
 